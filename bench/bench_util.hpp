@@ -0,0 +1,33 @@
+#ifndef MINI_ASYNC_SIMPLE_BENCH_BENCH_UTIL_HPP_
+#define MINI_ASYNC_SIMPLE_BENCH_BENCH_UTIL_HPP_
+
+#include <async_simple/util/frame_pool.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include "alloc_counter.hpp"
+
+namespace async_simple::bench {
+
+/// 记录迭代开始前的分配次数，结束时报告平均每次迭代的
+/// - allocs_per_iter: 调用全局operator new的次数，从内存池缓存中拿到的不算
+/// - pool_allocs_per_iter: 从FramePool分配的次数(协程帧、FutureState等)
+class AllocReporter {
+ public:
+  AllocReporter() : allocs_(AllocCount()), pool_allocs_(util::FramePool::GetStats().allocs) {}
+
+  void Report(benchmark::State &state) const {
+    auto iterations = static_cast<double>(state.iterations());
+    state.counters["allocs_per_iter"] = static_cast<double>(AllocCount() - allocs_) / iterations;
+    state.counters["pool_allocs_per_iter"] =
+        static_cast<double>(util::FramePool::GetStats().allocs - pool_allocs_) / iterations;
+  }
+
+ private:
+  std::size_t allocs_;
+  uint64_t pool_allocs_;
+};
+
+} // namespace async_simple::bench
+
+#endif //MINI_ASYNC_SIMPLE_BENCH_BENCH_UTIL_HPP_
@@ -0,0 +1,73 @@
+#include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <vector>
+
+namespace async_simple::coro {
+
+namespace {
+
+Lazy<int> Value(int v) { co_return v; }
+
+std::vector<Lazy<int>> MakeInputs(int n) {
+  std::vector<Lazy<int>> input;
+  input.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    input.push_back(Value(i));
+  }
+  return input;
+}
+
+void CollectArgs(benchmark::internal::Benchmark *bench) {
+  bench->RangeMultiplier(10)->Range(1, 100000)->Unit(benchmark::kMicrosecond)->UseRealTime();
+}
+
+} // namespace
+
+/// 在调用方线程依次执行所有Lazy
+void BM_CollectAll(benchmark::State &state) {
+  auto n = static_cast<int>(state.range(0));
+  executors::SimpleExecutor executor(1);
+  for (auto _ : state) {
+    auto test = [n]() -> Lazy<std::size_t> {
+      co_return (co_await CollectAll(MakeInputs(n))).size();
+    };
+    benchmark::DoNotOptimize(SyncAwait(test().Via(&executor)));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_CollectAll)->Apply(CollectArgs);
+
+/// 每个Lazy都调度到Executor上并行执行
+void BM_CollectAllPara(benchmark::State &state) {
+  auto n = static_cast<int>(state.range(0));
+  executors::SimpleExecutor executor(std::thread::hardware_concurrency(), true);
+  for (auto _ : state) {
+    auto test = [n]() -> Lazy<std::size_t> {
+      co_return (co_await CollectAllPara(MakeInputs(n))).size();
+    };
+    benchmark::DoNotOptimize(SyncAwait(test().Via(&executor)));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_CollectAllPara)->Apply(CollectArgs);
+
+/// 第一个完成之后通过stop_source取消其余的Lazy
+void BM_CollectAny(benchmark::State &state) {
+  auto n = static_cast<int>(state.range(0));
+  executors::SimpleExecutor executor(1);
+  for (auto _ : state) {
+    auto test = [n]() -> Lazy<std::size_t> {
+      co_return (co_await CollectAny(MakeInputs(n))).index;
+    };
+    benchmark::DoNotOptimize(SyncAwait(test().Via(&executor)));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_CollectAny)->Apply(CollectArgs);
+
+} // namespace async_simple::coro
@@ -0,0 +1,160 @@
+#include <async_simple/sync/future.hpp>
+#include <async_simple/sync/future_helper.hpp>
+#include <async_simple/sync/promise.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_util.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace async_simple {
+
+/// 在还没有结果的Future上挂n个ThenValue，再设置结果
+void BM_FutureThenValueChain(benchmark::State &state) {
+  auto n = static_cast<int>(state.range(0));
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    Promise<int> promise;
+    auto future = promise.GetFuture();
+    for (int i = 0; i < n; ++i) {
+      future = std::move(future).ThenValue([](int v) { return v + 1; });
+    }
+    promise.SetValue(0);
+    benchmark::DoNotOptimize(std::move(future).Get());
+  }
+  allocs.Report(state);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_FutureThenValueChain)->Arg(1)->Arg(10)->Arg(100);
+
+/// 绑定在executor上的ThenValue链，结果由调用方线程设置，所有阶段都在executor中执行
+void BM_FutureThenValueChainVia(benchmark::State &state) {
+  auto n = static_cast<int>(state.range(0));
+  executors::SimpleExecutor executor(1);
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    Promise<int> promise;
+    auto future = promise.GetFuture().Via(&executor);
+    for (int i = 0; i < n; ++i) {
+      future = std::move(future).ThenValue([](int v) { return v + 1; });
+    }
+    promise.SetValue(0);
+    benchmark::DoNotOptimize(std::move(future).Get());
+  }
+  allocs.Report(state);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_FutureThenValueChainVia)->Arg(1)->Arg(10)->Arg(100)->UseRealTime();
+
+/// 已经有结果的Future上的ThenValue链，只使用LocalState
+void BM_ReadyFutureThenValueChain(benchmark::State &state) {
+  auto n = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    auto future = MakeReadyFuture(0);
+    for (int i = 0; i < n; ++i) {
+      future = std::move(future).ThenValue([](int v) { return v + 1; });
+    }
+    benchmark::DoNotOptimize(std::move(future).Get());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_ReadyFutureThenValueChain)->Arg(1)->Arg(10)->Arg(100);
+
+/// 同一个线程中Promise设置结果、Future取出结果
+void BM_PromiseFutureRoundTrip(benchmark::State &state) {
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    Promise<int> promise;
+    auto future = promise.GetFuture();
+    promise.SetValue(1);
+    benchmark::DoNotOptimize(std::move(future).Get());
+  }
+  allocs.Report(state);
+}
+BENCHMARK(BM_PromiseFutureRoundTrip);
+
+/// Promise在线程池中设置结果，调用方线程阻塞在Get上
+void BM_PromiseFutureCrossThread(benchmark::State &state) {
+  executors::SimpleExecutor executor(1);
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    Promise<int> promise;
+    auto future = promise.GetFuture();
+    executor.Schedule([p = std::move(promise)]() mutable { p.SetValue(1); });
+    benchmark::DoNotOptimize(std::move(future).Get());
+  }
+  allocs.Report(state);
+}
+BENCHMARK(BM_PromiseFutureCrossThread)->UseRealTime();
+
+/// 扇出n个还没有结果的Future，用CollectAll汇总之后再逐个设置结果
+void BM_FutureCollectAll(benchmark::State &state) {
+  auto n = static_cast<std::size_t>(state.range(0));
+  std::vector<Promise<int>> promises(n);
+  std::vector<Future<int>> futures;
+  futures.reserve(n);
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    futures.clear();
+    for (auto &promise : promises) {
+      promise = Promise<int>();
+      futures.push_back(promise.GetFuture());
+    }
+    auto all = CollectAll(futures.begin(), futures.end());
+    for (auto &promise : promises) {
+      promise.SetValue(1);
+    }
+    benchmark::DoNotOptimize(std::move(all).Get());
+  }
+  allocs.Report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FutureCollectAll)->Arg(1)->Arg(10)->Arg(100);
+
+/// 扇出n个Future，第一个完成之后其余的只减少计数
+void BM_FutureCollectAny(benchmark::State &state) {
+  auto n = static_cast<std::size_t>(state.range(0));
+  std::vector<Promise<int>> promises(n);
+  std::vector<Future<int>> futures;
+  futures.reserve(n);
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    futures.clear();
+    for (auto &promise : promises) {
+      promise = Promise<int>();
+      futures.push_back(promise.GetFuture());
+    }
+    auto any = CollectAny(futures.begin(), futures.end());
+    for (auto &promise : promises) {
+      promise.SetValue(1);
+    }
+    benchmark::DoNotOptimize(std::move(any).Get());
+  }
+  allocs.Report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FutureCollectAny)->Arg(1)->Arg(10)->Arg(100);
+
+/// 同时最多8个请求在线程池中执行
+void BM_FutureCollectAllWindowed(benchmark::State &state) {
+  auto n = static_cast<std::size_t>(state.range(0));
+  executors::SimpleExecutor executor(2);
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    auto all = CollectAllWindowed(8, n, [&executor](std::size_t i) {
+      Promise<int> promise;
+      auto future = promise.GetFuture();
+      executor.Schedule([p = std::move(promise), i]() mutable { p.SetValue(static_cast<int>(i)); });
+      return future;
+    });
+    benchmark::DoNotOptimize(std::move(all).Get());
+  }
+  allocs.Report(state);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FutureCollectAllWindowed)->Arg(10)->Arg(1000)->UseRealTime();
+
+} // namespace async_simple
@@ -0,0 +1,73 @@
+#include <async_simple/coro/future_awaiter.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_util.hpp"
+
+namespace async_simple::coro {
+
+namespace {
+
+Lazy<int> Leaf(int v) { co_return v; }
+
+/// 深度为depth的co_await调用链
+Lazy<int> Chain(int depth) {
+  if (depth == 0) {
+    co_return co_await Leaf(1);
+  }
+  co_return co_await Chain(depth - 1) + 1;
+}
+
+} // namespace
+
+/// 嵌套co_await的开销，每层一次协程帧的分配和对称转移
+void BM_LazyChain(benchmark::State &state) {
+  auto depth = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SyncAwait(Chain(depth)));
+  }
+  state.SetItemsProcessed(state.iterations() * (depth + 1));
+}
+BENCHMARK(BM_LazyChain)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+/// 没有Executor时SyncAwait一个立即完成的Lazy
+void BM_SyncAwaitInline(benchmark::State &state) {
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SyncAwait(Leaf(1)));
+  }
+  allocs.Report(state);
+}
+BENCHMARK(BM_SyncAwaitInline);
+
+/// 从外部线程SyncAwait一个调度到线程池上的Lazy，包括提交、唤醒工作线程和通知等待方
+void BM_SyncAwaitVia(benchmark::State &state) {
+  executors::SimpleExecutor executor(static_cast<std::size_t>(state.range(0)));
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SyncAwait(Leaf(1).Via(&executor)));
+  }
+  allocs.Report(state);
+}
+BENCHMARK(BM_SyncAwaitVia)->Arg(1)->Arg(4)->UseRealTime();
+
+/// Lazy在调用方线程开始执行，等待的Future由线程池设置结果，Lazy在工作线程上结束
+void BM_SyncAwaitCrossThread(benchmark::State &state) {
+  executors::SimpleExecutor executor(1);
+  auto wait = [&executor]() -> Lazy<int> {
+    Promise<int> promise;
+    auto future = promise.GetFuture();
+    executor.Schedule([p = std::move(promise)]() mutable { p.SetValue(1); });
+    co_return co_await std::move(future);
+  };
+  bench::AllocReporter allocs;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SyncAwait(wait()));
+  }
+  allocs.Report(state);
+}
+BENCHMARK(BM_SyncAwaitCrossThread)->UseRealTime();
+
+} // namespace async_simple::coro
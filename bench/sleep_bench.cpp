@@ -0,0 +1,38 @@
+#include <async_simple/coro/sleep.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <semaphore>
+
+namespace async_simple::coro {
+
+using namespace std::chrono_literals;
+
+/// n个同时处于等待状态的sleep，所有的sleep共用SimpleExecutor中的一个定时器线程
+/// sleep时间要比全部提交所需的时间长，保证所有的sleep同时处于等待状态
+void BM_ConcurrentSleep(benchmark::State &state) {
+  auto n = static_cast<int>(state.range(0));
+  executors::SimpleExecutor e1(4);
+  for (auto _ : state) {
+    std::atomic<int> count{0};
+    std::binary_semaphore sem(0);
+    for (int i = 0; i < n; ++i) {
+      sleep(5s + std::chrono::microseconds(i))
+          .Via(&e1)
+          .Start([&](Try<void> &&) {
+            if (++count == n) {
+              sem.release();
+            }
+          });
+    }
+    sem.acquire();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_ConcurrentSleep)
+    ->Arg(10000)->Arg(1000000)
+    ->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+} // namespace async_simple::coro
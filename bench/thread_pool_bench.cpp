@@ -0,0 +1,131 @@
+#include <async_simple/util/thread_pool.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace async_simple::util {
+
+namespace {
+
+constexpr int kTasks = 100000;
+
+/// 等待所有任务执行完，只在最后一个任务完成时才会返回
+void WaitDone(std::atomic<int> &done, int expected) {
+  while (done.load(std::memory_order_acquire) != expected) {
+    std::this_thread::yield();
+  }
+}
+
+} // namespace
+
+/// 采样任务排队延迟的p99，单位是纳秒
+void ReportQueueWait(benchmark::State &state, const ThreadPool &pool) {
+  auto snapshot = pool.GetLatencySnapshot();
+  state.counters["queue_wait_p50_ns"] = static_cast<double>(snapshot.queue_wait.Percentile(0.5));
+  state.counters["queue_wait_p99_ns"] = static_cast<double>(snapshot.queue_wait.Percentile(0.99));
+}
+
+/// 外部线程向线程池提交kTasks个空任务的吞吐，range(0)是线程数，range(1)表示是否开启work steal
+void BM_ThreadPoolSchedule(benchmark::State &state) {
+  ThreadPool pool(static_cast<std::size_t>(state.range(0)), state.range(1) != 0);
+  for (auto _ : state) {
+    std::atomic<int> done{0};
+    for (int i = 0; i < kTasks; ++i) {
+      pool.ScheduleById([&done]() { done.fetch_add(1, std::memory_order_release); });
+    }
+    WaitDone(done, kTasks);
+  }
+  state.SetItemsProcessed(state.iterations() * kTasks);
+  ReportQueueWait(state, pool);
+}
+BENCHMARK(BM_ThreadPoolSchedule)
+    ->ArgsProduct({{1, 4, 8}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/// 工作线程内部提交任务，开启work steal时走本地无锁队列
+void BM_ThreadPoolScheduleFromWorker(benchmark::State &state) {
+  ThreadPool pool(static_cast<std::size_t>(state.range(0)), state.range(1) != 0);
+  for (auto _ : state) {
+    std::atomic<int> done{0};
+    pool.ScheduleById([&pool, &done]() {
+      for (int i = 0; i < kTasks; ++i) {
+        pool.ScheduleById([&done]() { done.fetch_add(1, std::memory_order_release); });
+      }
+    });
+    WaitDone(done, kTasks);
+  }
+  state.SetItemsProcessed(state.iterations() * kTasks);
+  ReportQueueWait(state, pool);
+}
+BENCHMARK(BM_ThreadPoolScheduleFromWorker)
+    ->ArgsProduct({{1, 4, 8}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/// 两个工作线程来回交接一个任务，range(0)是空闲时自旋的次数，衡量唤醒一个刚空闲下来的线程的延迟
+void BM_ThreadPoolPingPong(benchmark::State &state) {
+  constexpr int kRounds = 10000;
+  ThreadPool pool(2, false, static_cast<uint32_t>(state.range(0)));
+  for (auto _ : state) {
+    std::atomic<int> done{0};
+    std::function<void(int)> bounce = [&](int n) {
+      if (n == kRounds) {
+        done.store(1, std::memory_order_release);
+        return;
+      }
+      pool.ScheduleById([&bounce, n]() { bounce(n + 1); }, (n + 1) % 2);
+    };
+    pool.ScheduleById([&bounce]() { bounce(0); }, 0);
+    WaitDone(done, 1);
+  }
+  state.SetItemsProcessed(state.iterations() * kRounds);
+}
+BENCHMARK(BM_ThreadPoolPingPong)
+    ->Arg(0)->Arg(ThreadPool::kDefaultSpinCount)->Arg(1024)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+/// 多个外部线程突发地提交长短不一的任务，每个任务有1/16的概率执行约20us，考察负载均衡
+void BM_ThreadPoolBurst(benchmark::State &state) {
+  constexpr int kSubmitters = 4;
+  constexpr int kBurst = 2000;
+  ThreadPool pool(static_cast<std::size_t>(state.range(0)), state.range(1) != 0);
+  auto task = [](std::atomic<int> &done, bool slow) {
+    if (slow) {
+      auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(20);
+      while (std::chrono::steady_clock::now() < end) {
+      }
+    }
+    done.fetch_add(1, std::memory_order_release);
+  };
+  for (auto _ : state) {
+    std::atomic<int> done{0};
+    std::vector<std::thread> submitters;
+    for (int t = 0; t < kSubmitters; ++t) {
+      submitters.emplace_back([&, t]() {
+        for (int i = 0; i < kBurst; ++i) {
+          bool slow = (i + t) % 16 == 0;
+          pool.ScheduleById([&done, &task, slow]() { task(done, slow); });
+        }
+      });
+    }
+    for (auto &submitter : submitters) {
+      submitter.join();
+    }
+    WaitDone(done, kSubmitters * kBurst);
+  }
+  state.SetItemsProcessed(state.iterations() * kSubmitters * kBurst);
+  ReportQueueWait(state, pool);
+}
+BENCHMARK(BM_ThreadPoolBurst)
+    ->ArgsProduct({{4, 8}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace async_simple::util
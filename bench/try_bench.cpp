@@ -0,0 +1,55 @@
+#include <async_simple/base/try.hpp>
+#include <async_simple/base/try_variant.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace async_simple {
+
+namespace {
+
+template<typename T>
+struct Payload;
+template<>
+struct Payload<int> {
+  static int Make() { return 42; }
+};
+template<>
+struct Payload<std::string> {
+  static std::string Make() { return std::string(64, 'x'); }
+};
+
+} // namespace
+
+/// 构造、移动两次再取值，对比Try和基于std::variant的TryV
+template<template<typename> typename TryType, typename T>
+void BM_TryMoveValue(benchmark::State &state) {
+  for (auto _ : state) {
+    TryType<T> t(Payload<T>::Make());
+    TryType<T> t2(std::move(t));
+    TryType<T> t3;
+    t3 = std::move(t2);
+    benchmark::DoNotOptimize(t3.Value());
+  }
+}
+BENCHMARK_TEMPLATE(BM_TryMoveValue, Try, int);
+BENCHMARK_TEMPLATE(BM_TryMoveValue, TryV, int);
+BENCHMARK_TEMPLATE(BM_TryMoveValue, Try, std::string);
+BENCHMARK_TEMPLATE(BM_TryMoveValue, TryV, std::string);
+
+/// 保存并检查异常，不重新抛出
+template<template<typename> typename TryType>
+void BM_TryException(benchmark::State &state) {
+  auto exception = std::make_exception_ptr(std::runtime_error("bench"));
+  for (auto _ : state) {
+    TryType<int> t(exception);
+    TryType<int> t2(std::move(t));
+    benchmark::DoNotOptimize(t2.HasException());
+  }
+}
+BENCHMARK_TEMPLATE(BM_TryException, Try);
+BENCHMARK_TEMPLATE(BM_TryException, TryV);
+
+} // namespace async_simple
@@ -0,0 +1,30 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_BASE_CANCELLATION_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_BASE_CANCELLATION_HPP_
+
+#include <exception>
+#include <stop_token>
+
+namespace async_simple {
+
+/// 协程在挂起点(Yield、sleep、Executor::Schedule等)发现已经被请求取消时抛出的异常
+class OperationCancelled : public std::exception {
+ public:
+  const char *what() const noexcept override { return "operation cancelled"; }
+};
+
+/// WithTimeout/WithDeadline的子任务没有在期限内完成时返回的异常
+class TimeoutError : public std::exception {
+ public:
+  const char *what() const noexcept override { return "operation timed out"; }
+};
+
+/// 获取当前协程的std::stop_token的Awaitable类型
+/// ```
+/// auto token = co_await CurrentStopToken{};
+/// ```
+/// stop_token会沿着co_await的Lazy链传递给子协程，子协程自己设置了stop_token时不会被覆盖
+struct CurrentStopToken {};
+
+} // namespace async_simple
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_BASE_CANCELLATION_HPP_
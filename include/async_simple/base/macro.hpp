@@ -6,4 +6,13 @@
 
 #define FORCE_INLINE __attribute__((__always_inline__)) inline
 
+/// 自旋等待时提示CPU降低功耗、让出流水线给超线程
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define CPU_RELAX() asm volatile("yield" ::: "memory")
+#else
+#define CPU_RELAX() ((void)0)
+#endif
+
 #endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_BASE_MACRO_HPP_
@@ -0,0 +1,161 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_BASE_TASK_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_BASE_TASK_HPP_
+
+#include "async_simple/base/macro.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// Task内联存储的大小，可以在编译时通过-DASYNC_SIMPLE_TASK_INLINE_SIZE=xx修改
+#ifndef ASYNC_SIMPLE_TASK_INLINE_SIZE
+#define ASYNC_SIMPLE_TASK_INLINE_SIZE 48
+#endif
+
+namespace async_simple {
+
+template<typename Signature, std::size_t InlineSize = ASYNC_SIMPLE_TASK_INLINE_SIZE>
+class BasicTask;
+
+/// 只能移动的可调用对象包装，用来代替std::function
+/// - 不要求可调用对象可复制，因此不再需要MoveWrapper
+/// - 大小不超过InlineSize、对齐不超过指针并且可以无异常移动的可调用对象直接存放在内部，不会分配内存
+/// - 可平凡复制的可调用对象（比如只捕获了coroutine_handle的lambda）移动时只需要memcpy
+/// 和std::function一样，operator()是const的，但被调用的可调用对象是非const的
+template<typename R, typename... Args, std::size_t InlineSize>
+class BasicTask<R(Args...), InlineSize> {
+  static constexpr std::size_t kAlign = alignof(void *);
+  static_assert(InlineSize >= sizeof(void *), "InlineSize is too small");
+
+  struct VTable {
+    R (*invoke)(void *storage, Args &&... args);
+    /// 为nullptr时表示可以直接memcpy
+    void (*relocate)(void *dst, void *src) noexcept;
+    /// 为nullptr时表示不需要析构
+    void (*destroy)(void *storage) noexcept;
+  };
+
+  template<typename F>
+  static constexpr bool kStoredInline = sizeof(F) <= InlineSize &&
+      alignof(F) <= kAlign &&
+      std::is_nothrow_move_constructible_v<F>;
+
+  template<typename F>
+  struct InlineOps {
+    static R Invoke(void *storage, Args &&... args) {
+      return std::invoke(*static_cast<F *>(storage), std::forward<Args>(args)...);
+    }
+    static void Relocate(void *dst, void *src) noexcept {
+      auto f = static_cast<F *>(src);
+      new(dst) F(std::move(*f));
+      f->~F();
+    }
+    static void Destroy(void *storage) noexcept {
+      static_cast<F *>(storage)->~F();
+    }
+    static constexpr bool kTrivial = std::is_trivially_copyable_v<F> &&
+        std::is_trivially_destructible_v<F>;
+    static constexpr VTable kVTable{
+        &Invoke,
+        kTrivial ? nullptr : &Relocate,
+        kTrivial ? nullptr : &Destroy,
+    };
+  };
+
+  /// 放不下的可调用对象分配在堆上，内部只存放指针
+  template<typename F>
+  struct HeapOps {
+    static R Invoke(void *storage, Args &&... args) {
+      return std::invoke(**static_cast<F **>(storage), std::forward<Args>(args)...);
+    }
+    static void Destroy(void *storage) noexcept {
+      delete *static_cast<F **>(storage);
+    }
+    static constexpr VTable kVTable{&Invoke, nullptr, &Destroy};
+  };
+
+ public:
+  static constexpr std::size_t kInlineSize = InlineSize;
+
+  BasicTask() noexcept = default;
+  BasicTask(std::nullptr_t) noexcept {}
+
+  template<typename F, typename D = std::decay_t<F>>
+  requires (!std::is_same_v<D, BasicTask>) && std::is_invocable_r_v<R, D &, Args...>
+  BasicTask(F &&f) {
+    if constexpr (std::is_pointer_v<D> || std::is_member_pointer_v<D>) {
+      if (f == nullptr) {
+        return;
+      }
+    }
+    if constexpr (kStoredInline<D>) {
+      new(storage_) D(std::forward<F>(f));
+      vtable_ = &InlineOps<D>::kVTable;
+    } else {
+      *reinterpret_cast<D **>(storage_) = new D(std::forward<F>(f));
+      vtable_ = &HeapOps<D>::kVTable;
+    }
+  }
+
+  BasicTask(BasicTask &&other) noexcept {
+    MoveFrom(other);
+  }
+  BasicTask &operator=(BasicTask &&other) noexcept {
+    if (this != &other) {
+      Reset();
+      MoveFrom(other);
+    }
+    return *this;
+  }
+  BasicTask &operator=(std::nullptr_t) noexcept {
+    Reset();
+    return *this;
+  }
+
+  BasicTask(const BasicTask &) = delete;
+  BasicTask &operator=(const BasicTask &) = delete;
+
+  ~BasicTask() { Reset(); }
+
+  R operator()(Args... args) const {
+    return vtable_->invoke(const_cast<unsigned char *>(storage_), std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept { return vtable_ != nullptr; }
+  friend bool operator==(const BasicTask &task, std::nullptr_t) noexcept {
+    return task.vtable_ == nullptr;
+  }
+
+ private:
+  FORCE_INLINE void MoveFrom(BasicTask &other) noexcept {
+    vtable_ = std::exchange(other.vtable_, nullptr);
+    if (!vtable_) {
+      return;
+    }
+    if (vtable_->relocate) {
+      vtable_->relocate(storage_, other.storage_);
+    } else {
+      std::memcpy(storage_, other.storage_, InlineSize);
+    }
+  }
+
+  FORCE_INLINE void Reset() noexcept {
+    auto vtable = std::exchange(vtable_, nullptr);
+    if (vtable && vtable->destroy) {
+      vtable->destroy(storage_);
+    }
+  }
+
+  const VTable *vtable_{nullptr};
+  alignas(kAlign) unsigned char storage_[InlineSize];
+};
+
+/// 提交给Executor的任务
+using Task = BasicTask<void()>;
+
+} // namespace async_simple
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_BASE_TASK_HPP_
@@ -1,78 +1,101 @@
 #ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CONTAINER_THREADSAFE_QUEUE_HPP_
 #define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CONTAINER_THREADSAFE_QUEUE_HPP_
 
-#include <queue>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <type_traits>
+#include <vector>
 
 namespace async_simple::container {
 
-template<typename T> requires std::is_move_assignable_v<T>
+/// 内部使用环形缓冲区，容量只会增长，稳定状态下Push/Pop不会分配内存
+/// T需要可以默认构造
+template<typename T>
+requires std::is_default_constructible_v<T> && std::is_move_assignable_v<T>
 class ThreadsafeQueue {
  public:
   ThreadsafeQueue() = default;
 
+  /// 只有在有线程阻塞在Pop中时才会notify
   void Push(T &&item) {
+    bool has_waiter;
     {
       std::lock_guard guard(mutex_);
-      queue_.push(std::move(item));
+      PushBack(std::move(item));
+      size_hint_.store(size_, std::memory_order_relaxed);
+      has_waiter = waiters_ != 0;
+    }
+    if (has_waiter) {
+      cond_.notify_one();
     }
-    cond_.notify_one();
   }
   bool TryPush(const T &item) {
+    bool has_waiter;
     {
       std::unique_lock lock(mutex_, std::try_to_lock);
       if (!lock) return false;
-      queue_.push(item);
+      PushBack(T(item));
+      size_hint_.store(size_, std::memory_order_relaxed);
+      has_waiter = waiters_ != 0;
+    }
+    if (has_waiter) {
+      cond_.notify_one();
     }
-    cond_.notify_one();
     return true;
   }
 
   bool Pop(T &item) {
     std::unique_lock lock(mutex_);
+    ++waiters_;
     cond_.wait(lock, [this]() {
-      return !queue_.empty() || stop_;
+      return size_ != 0 || stop_;
     });
-    if (queue_.empty()) {
+    --waiters_;
+    if (size_ == 0) {
       return false;
     }
-    item = std::move(queue_.front());
-    queue_.pop();
+    PopFront(item);
+    size_hint_.store(size_, std::memory_order_relaxed);
     return true;
   }
 
   bool TryPop(T &item) {
     std::unique_lock lock(mutex_, std::try_to_lock);
-    if (!lock || queue_.empty()) {
+    if (!lock || size_ == 0) {
       return false;
     }
-    item = std::move(queue_.front());
-    queue_.pop();
+    PopFront(item);
+    size_hint_.store(size_, std::memory_order_relaxed);
     return true;
   }
 
   bool TryPopIf(T &item, bool (*predict)(T &) = nullptr) {
     std::unique_lock lock(mutex_, std::try_to_lock);
-    if (!lock || queue_.empty()) {
+    if (!lock || size_ == 0) {
       return false;
     }
-    if (predict && !predict(queue_.front())) {
+    if (predict && !predict(buffer_[head_])) {
       return false;
     }
-    item = std::move(queue_.front());
-    queue_.pop();
+    PopFront(item);
+    size_hint_.store(size_, std::memory_order_relaxed);
     return true;
   }
 
   [[nodiscard]] std::size_t Size() const {
     std::lock_guard lg(mutex_);
-    return queue_.size();
+    return size_;
+  }
+
+  /// 不加锁地读取队列长度，结果可能是过时的，只能用作提示
+  [[nodiscard]] std::size_t SizeHint() const noexcept {
+    return size_hint_.load(std::memory_order_relaxed);
   }
 
   bool Empty() const {
     std::lock_guard lg(mutex_);
-    return queue_.empty();
+    return size_ == 0;
   }
 
   void Stop() {
@@ -84,10 +107,37 @@ class ThreadsafeQueue {
   }
 
  private:
-  std::queue<T> queue_;
+  void PushBack(T &&item) {
+    if (size_ == buffer_.size()) {
+      Grow();
+    }
+    buffer_[(head_ + size_) & (buffer_.size() - 1)] = std::move(item);
+    ++size_;
+  }
+  void PopFront(T &item) {
+    item = std::move(buffer_[head_]);
+    head_ = (head_ + 1) & (buffer_.size() - 1);
+    --size_;
+  }
+  void Grow() {
+    std::vector<T> buffer(buffer_.empty() ? kInitCapacity : buffer_.size() * 2);
+    for (std::size_t i = 0; i < size_; ++i) {
+      buffer[i] = std::move(buffer_[(head_ + i) & (buffer_.size() - 1)]);
+    }
+    buffer_.swap(buffer);
+    head_ = 0;
+  }
+
+  static constexpr std::size_t kInitCapacity = 16;
+
+  std::vector<T> buffer_;  ///< 容量总是2的幂
+  std::size_t head_{0};
+  std::size_t size_{0};
   mutable std::mutex mutex_;
   std::condition_variable cond_;
-  bool stop_;
+  std::atomic<std::size_t> size_hint_{0};
+  std::size_t waiters_{0};  ///< 阻塞在Pop中的线程数，由mutex_保护
+  bool stop_{false};
 };
 
 } // namespace async_simple::container
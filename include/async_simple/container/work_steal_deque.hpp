@@ -0,0 +1,142 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CONTAINER_WORK_STEAL_DEQUE_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CONTAINER_WORK_STEAL_DEQUE_HPP_
+
+#include "async_simple/base/assert.hpp"
+#include "async_simple/base/macro.hpp"
+#include "async_simple/base/noncopyable.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace async_simple::container {
+
+/// Chase-Lev无锁工作窃取双端队列
+/// 内存序参考: Correct and Efficient Work-Stealing for Weak Memory Models (Lê et al. PPoPP'13)
+/// - Push/Pop只能由拥有者线程调用，在bottom端操作，不需要加锁
+/// - Steal可以由任意线程调用，在top端通过CAS取走元素
+/// 由于窃取者会在CAS之前读取槽位，元素类型必须是可平凡复制的（通常是指针）
+template<typename T> requires std::is_trivially_copyable_v<T>
+class WorkStealDeque : noncopyable {
+  class Array {
+   public:
+    explicit Array(int64_t capacity)
+        : capacity_(capacity),
+          mask_(capacity - 1),
+          buffer_(new std::atomic<T>[capacity]) {}
+
+    [[nodiscard]] int64_t Capacity() const noexcept { return capacity_; }
+
+    void Put(int64_t index, T item) noexcept {
+      buffer_[index & mask_].store(item, std::memory_order_relaxed);
+    }
+    T Get(int64_t index) const noexcept {
+      return buffer_[index & mask_].load(std::memory_order_relaxed);
+    }
+
+    /// 扩容为原来的两倍，并拷贝[top, bottom)之间的元素
+    Array *Grow(int64_t bottom, int64_t top) const {
+      auto array = new Array(capacity_ * 2);
+      for (auto i = top; i != bottom; ++i) {
+        array->Put(i, Get(i));
+      }
+      return array;
+    }
+
+   private:
+    int64_t capacity_;
+    int64_t mask_;
+    std::unique_ptr<std::atomic<T>[]> buffer_;
+  };
+
+ public:
+  /// @param capacity 初始容量，必须是2的幂
+  explicit WorkStealDeque(int64_t capacity = 1024)
+      : top_(0), bottom_(0), array_(new Array(capacity)) {
+    ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  }
+  ~WorkStealDeque() {
+    delete array_.load(std::memory_order_relaxed);
+  }
+
+  /// 在bottom端压入元素，只能由拥有者线程调用
+  void Push(T item) {
+    auto b = bottom_.load(std::memory_order_relaxed);
+    auto t = top_.load(std::memory_order_acquire);
+    auto array = array_.load(std::memory_order_relaxed);
+    if (b - t > array->Capacity() - 1) UNLIKELY {
+      auto new_array = array->Grow(b, t);
+      // 窃取者可能还在读旧数组，旧数组需要保留到队列析构
+      garbage_.emplace_back(array);
+      array_.store(new_array, std::memory_order_release);
+      array = new_array;
+    }
+    array->Put(b, item);
+    // 和Steal中对bottom_的acquire配对，窃取者看到新的bottom_时也能看到元素的内容
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  /// 在bottom端弹出元素，只能由拥有者线程调用
+  bool Pop(T &item) {
+    auto b = bottom_.load(std::memory_order_relaxed) - 1;
+    auto array = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      // 队列为空
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+    item = array->Get(b);
+    if (t == b) {
+      // 只剩最后一个元素，需要和窃取者竞争
+      bool won = top_.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  /// 在top端窃取元素，可以由任意线程调用
+  /// @return 队列为空或者和其他线程竞争失败时返回false
+  bool Steal(T &item) {
+    auto t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return false;
+    }
+    auto array = array_.load(std::memory_order_acquire);
+    auto x = array->Get(t);
+    if (!top_.compare_exchange_strong(t, t + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return false;
+    }
+    item = x;
+    return true;
+  }
+
+  /// 返回队列元素个数的近似值
+  [[nodiscard]] std::size_t Size() const noexcept {
+    auto b = bottom_.load(std::memory_order_relaxed);
+    auto t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<std::size_t>(b - t) : 0;
+  }
+  [[nodiscard]] bool Empty() const noexcept { return Size() == 0; }
+
+ private:
+  alignas(64) std::atomic<int64_t> top_;
+  alignas(64) std::atomic<int64_t> bottom_;
+  std::atomic<Array *> array_;
+  std::vector<std::unique_ptr<Array>> garbage_;
+};
+
+} // namespace async_simple::container
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CONTAINER_WORK_STEAL_DEQUE_HPP_
@@ -0,0 +1,164 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_ASYNC_IO_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_ASYNC_IO_HPP_
+
+#include "async_simple/executor/executor.hpp"
+#include "async_simple/executor/io_executor.hpp"
+
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+#include <stop_token>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace async_simple::coro {
+
+namespace detail {
+
+/// 文件IO的Awaiter，所有状态都保存在Awaiter中，不需要额外分配内存
+/// IO完成后通过Checkin回到挂起前Checkout的context上继续执行
+/// 没有Executor或者Executor没有提供IOExecutor时，退化成同步的系统调用
+/// 协程已经被请求取消时不提交IO，直接返回-ECANCELED；已经提交的IO无法取消，
+/// 因为buffer在IO完成之前一直被内核使用
+class AsyncIOAwaiter {
+ public:
+  AsyncIOAwaiter(Executor *executor, int fd, iocb_cmd cmd, void *buffer,
+                 size_t length, off_t offset, bool vectored)
+      : executor_(executor), fd_(fd), cmd_(cmd), buffer_(buffer),
+        length_(length), offset_(offset), vectored_(vectored) {}
+
+  /// 已经请求取消时直接完成
+  void Cancel() noexcept {
+    cancelled_ = true;
+    result_ = -ECANCELED;
+  }
+
+  bool await_ready() const noexcept { return cancelled_; }
+
+  bool await_suspend(std::coroutine_handle<> continuation) {
+    IOExecutor *io = executor_ ? executor_->GetIOExecutor() : nullptr;
+    if (!io) {
+      result_ = SyncIO();
+      return false;
+    }
+    continuation_ = continuation;
+    context_ = executor_->Checkout();
+    // 回调有可能在Submit返回之前就执行了，之后不能再访问this
+    auto callback = [this](io_event_t &event) {
+      result_ = static_cast<int64_t>(event.res);
+      auto h = continuation_;
+      if (!executor_->Checkin([h]() mutable { h.resume(); }, context_)) {
+        h.resume();
+      }
+    };
+    if (vectored_) {
+      io->SubmitIOV(fd_, cmd_, static_cast<const iovec_t *>(buffer_), length_, offset_, std::move(callback));
+    } else {
+      io->SubmitIO(fd_, cmd_, buffer_, length_, offset_, std::move(callback));
+    }
+    return true;
+  }
+
+  /// 和对应的系统调用一致：成功时返回处理的字节数(fsync返回0)，失败时返回-errno
+  int64_t await_resume() const noexcept { return result_; }
+
+ private:
+  int64_t SyncIO() const {
+    ssize_t r;
+    switch (cmd_) {
+      case IOCB_CMD_PREAD:
+        r = ::pread(fd_, buffer_, length_, offset_);
+        break;
+      case IOCB_CMD_PWRITE:
+        r = ::pwrite(fd_, buffer_, length_, offset_);
+        break;
+      case IOCB_CMD_PREADV:
+        r = ::preadv(fd_, static_cast<const iovec *>(buffer_), static_cast<int>(length_), offset_);
+        break;
+      case IOCB_CMD_PWRITEV:
+        r = ::pwritev(fd_, static_cast<const iovec *>(buffer_), static_cast<int>(length_), offset_);
+        break;
+      case IOCB_CMD_FSYNC:
+        r = ::fsync(fd_);
+        break;
+      case IOCB_CMD_FDSYNC:
+        r = ::fdatasync(fd_);
+        break;
+      default:
+        return -EINVAL;
+    }
+    return r < 0 ? -errno : r;
+  }
+
+  Executor *executor_;
+  int fd_;
+  iocb_cmd cmd_;
+  void *buffer_;
+  size_t length_;
+  off_t offset_;
+  bool vectored_;
+  bool cancelled_{false};
+  Executor::Context context_{Executor::kNullContext};
+  std::coroutine_handle<> continuation_;
+  int64_t result_{0};
+};
+
+class AsyncIOAwaitable {
+ public:
+  AsyncIOAwaitable(int fd, iocb_cmd cmd, void *buffer, size_t length, off_t offset, bool vectored)
+      : fd_(fd), cmd_(cmd), buffer_(buffer), length_(length), offset_(offset), vectored_(vectored) {}
+
+  auto CoAwait(Executor *executor) {
+    return AsyncIOAwaiter(executor, fd_, cmd_, buffer_, length_, offset_, vectored_);
+  }
+
+  auto CoAwait(Executor *executor, const std::stop_token &token) {
+    auto awaiter = CoAwait(executor);
+    if (token.stop_requested()) {
+      awaiter.Cancel();
+    }
+    return awaiter;
+  }
+
+ private:
+  int fd_;
+  iocb_cmd cmd_;
+  void *buffer_;
+  size_t length_;
+  off_t offset_;
+  bool vectored_;
+};
+
+} // namespace async_simple::coro::detail
+
+/// 在Lazy中异步读写文件，使用当前Executor的IOExecutor
+/// ```
+/// int64_t n = co_await coro::AsyncRead(fd, buffer, 4096, 0);
+/// ```
+/// 返回值和pread等系统调用一致，失败时返回-errno
+inline detail::AsyncIOAwaitable AsyncRead(int fd, void *buffer, size_t length, off_t offset) {
+  return {fd, IOCB_CMD_PREAD, buffer, length, offset, false};
+}
+
+inline detail::AsyncIOAwaitable AsyncWrite(int fd, const void *buffer, size_t length, off_t offset) {
+  return {fd, IOCB_CMD_PWRITE, const_cast<void *>(buffer), length, offset, false};
+}
+
+/// iov需要在co_await返回之前一直有效
+inline detail::AsyncIOAwaitable AsyncReadV(int fd, const iovec_t *iov, size_t count, off_t offset) {
+  return {fd, IOCB_CMD_PREADV, const_cast<iovec_t *>(iov), count, offset, true};
+}
+
+inline detail::AsyncIOAwaitable AsyncWriteV(int fd, const iovec_t *iov, size_t count, off_t offset) {
+  return {fd, IOCB_CMD_PWRITEV, const_cast<iovec_t *>(iov), count, offset, true};
+}
+
+/// @param datasync 为true时只同步数据，相当于fdatasync
+inline detail::AsyncIOAwaitable AsyncFsync(int fd, bool datasync = false) {
+  return {fd, datasync ? IOCB_CMD_FDSYNC : IOCB_CMD_FSYNC, nullptr, 0, 0, false};
+}
+
+} // namespace async_simple::coro
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_ASYNC_IO_HPP_
@@ -0,0 +1,360 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_CHANNEL_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_CHANNEL_HPP_
+
+#include "async_simple/base/assert.hpp"
+#include "async_simple/base/noncopyable.hpp"
+#include "async_simple/coro/waiter.hpp"
+#include "async_simple/util/spin_lock.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace async_simple::coro {
+
+/// 有界多生产者多消费者通道，用于在Lazy之间传递数据
+/// ```
+/// Channel<int> ch(128);
+/// co_await ch.Send(1);          // 满了挂起，通道关闭返回false
+/// auto v = co_await ch.Recv();  // 空了挂起，通道关闭且取完之后返回std::nullopt
+/// ```
+/// - 缓冲区是固定容量的无锁环形队列(每个槽位带序号)，TrySend/TryRecv在没有等待者时不加锁
+/// - 等待者放在自旋锁保护的队列中，对端操作缓冲区之后代替等待者完成发送/接收再唤醒它，
+///   被唤醒的协程不需要再和其他协程竞争
+/// - Close之后发送都会失败，接收者仍然可以取出缓冲区中剩余的元素
+/// - 唤醒路径都是noexcept的，T的移动构造不能抛出异常
+template<typename T> requires std::is_move_constructible_v<T>
+class Channel : noncopyable {
+ public:
+  class SendAwaiter : public detail::Waiter {
+   public:
+    SendAwaiter(Channel &channel, T &&value, Executor *ex) : channel_(channel), value_(std::move(value)) {
+      executor = ex;
+    }
+
+    bool await_ready() noexcept {
+      if (channel_.closed_.load(std::memory_order_relaxed)) {
+        return true;
+      }
+      ok_ = channel_.TrySend(std::move(value_));
+      return ok_;
+    }
+    bool await_suspend(std::coroutine_handle<> continuation) noexcept {
+      Prepare(continuation);
+      return channel_.SendOrEnqueue(this);
+    }
+    /// 通道已经关闭时返回false
+    bool await_resume() noexcept { return ok_; }
+
+   private:
+    friend class Channel;
+
+    Channel &channel_;
+    T value_;
+    bool ok_{false};
+  };
+
+  class RecvAwaiter : public detail::Waiter {
+   public:
+    RecvAwaiter(Channel &channel, Executor *ex) : channel_(channel) { executor = ex; }
+
+    bool await_ready() noexcept {
+      value_ = channel_.TryRecv();
+      if (value_) {
+        return true;
+      }
+      // Close之前发送的元素对acquire之后的TryPop可见
+      if (channel_.closed_.load(std::memory_order_acquire)) {
+        value_ = channel_.TryRecv();
+        return true;
+      }
+      return false;
+    }
+    bool await_suspend(std::coroutine_handle<> continuation) noexcept {
+      Prepare(continuation);
+      return channel_.RecvOrEnqueue(this);
+    }
+    /// 通道已经关闭并且没有剩余元素时返回std::nullopt
+    std::optional<T> await_resume() noexcept { return std::move(value_); }
+
+   private:
+    friend class Channel;
+
+    Channel &channel_;
+    std::optional<T> value_;
+  };
+
+  class SendAwaitable {
+   public:
+    SendAwaitable(Channel &channel, T &&value) : channel_(channel), value_(std::move(value)) {}
+    SendAwaiter CoAwait(Executor *executor) { return {channel_, std::move(value_), executor}; }
+
+   private:
+    Channel &channel_;
+    T value_;
+  };
+
+  class RecvAwaitable {
+   public:
+    explicit RecvAwaitable(Channel &channel) : channel_(channel) {}
+    RecvAwaiter CoAwait(Executor *executor) { return {channel_, executor}; }
+
+   private:
+    Channel &channel_;
+  };
+
+  explicit Channel(std::size_t capacity) : capacity_(capacity), slots_(new Slot[capacity]) {
+    ASSERT(capacity > 0);
+    for (std::size_t i = 0; i < capacity; ++i) {
+      slots_[i].seq.store(2 * i, std::memory_order_relaxed);
+    }
+  }
+  ~Channel() {
+    ASSERT(recv_waiters_.Empty() && send_waiters_.Empty());
+    std::optional<T> value;
+    while (TryPop(value)) {}
+  }
+
+  [[nodiscard]] std::size_t Capacity() const noexcept { return capacity_; }
+
+  /// 不加锁地读取元素个数，结果可能是过时的，只能用作提示
+  [[nodiscard]] std::size_t SizeHint() const noexcept {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    auto head = head_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  [[nodiscard]] bool IsClosed() const noexcept { return closed_.load(std::memory_order_acquire); }
+
+  /// 缓冲区满了或者通道已经关闭时返回false，此时value不会被移动
+  bool TrySend(const T &value) { return TrySendImpl(value); }
+  bool TrySend(T &&value) { return TrySendImpl(std::move(value)); }
+
+  /// 缓冲区为空时返回std::nullopt
+  std::optional<T> TryRecv() noexcept {
+    std::optional<T> value;
+    if (TryPop(value)) {
+      WakeWaiters(false);
+    }
+    return value;
+  }
+
+  /// co_await channel.Send(value)，返回是否发送成功
+  SendAwaitable Send(T value) { return {*this, std::move(value)}; }
+
+  /// co_await channel.Recv()，返回std::optional<T>
+  RecvAwaitable Recv() noexcept { return RecvAwaitable(*this); }
+
+  /// 关闭通道并唤醒所有等待者，可以重复调用
+  void Close() noexcept {
+    closed_.store(true, std::memory_order_seq_cst);
+    detail::Waiter *receivers;
+    detail::Waiter *senders;
+    {
+      std::lock_guard lg(lock_);
+      receivers = recv_waiters_.PopAll();
+      senders = send_waiters_.PopAll();
+      recv_waiting_.store(0, std::memory_order_relaxed);
+      send_waiting_.store(0, std::memory_order_relaxed);
+      // 接收者等待时缓冲区可能刚好被写入了元素，先让它们取完
+      for (auto waiter = receivers; waiter; waiter = waiter->next) {
+        TryPop(static_cast<RecvAwaiter *>(waiter)->value_);
+      }
+    }
+    ResumeAll(receivers);
+    ResumeAll(senders);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<std::size_t> seq;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T *Get() noexcept { return std::launder(reinterpret_cast<T *>(storage)); }
+  };
+
+  template<typename U>
+  bool TrySendImpl(U &&value) {
+    if (closed_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    if (!TryPush(std::forward<U>(value))) {
+      return false;
+    }
+    WakeWaiters(true);
+    return true;
+  }
+
+  /// 槽位的序号等于2*pos时可以写入，等于2*pos+1时可以读取，读取之后变成2*(pos+capacity)留给下一轮写入。
+  /// 序号乘2是为了区分容量为1时"第pos个可以读取"和"第pos+1个可以写入"两种状态
+  template<typename U>
+  bool TryPush(U &&value) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      auto &slot = slots_[pos % capacity_];
+      auto seq = slot.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(2 * pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          new(slot.storage) T(std::forward<U>(value));
+          slot.seq.store(2 * pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool TryPop(std::optional<T> &value) noexcept {
+    auto pos = head_.load(std::memory_order_relaxed);
+    while (true) {
+      auto &slot = slots_[pos % capacity_];
+      auto seq = slot.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(2 * pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          value.emplace(std::move(*slot.Get()));
+          slot.Get()->~T();
+          slot.seq.store(2 * (pos + capacity_), std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// 发送成功或者通道已经关闭返回false，否则加入等待队列并返回true
+  bool SendOrEnqueue(SendAwaiter *waiter) noexcept {
+    {
+      std::lock_guard lg(lock_);
+      // 和WakeSender中的fence配对：要么这里看到空出来的槽位，要么对端看到等待者
+      send_waiting_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (closed_.load(std::memory_order_relaxed)) {
+        send_waiting_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+      }
+      if (!TryPush(std::move(waiter->value_))) {
+        send_waiters_.Push(waiter);
+        return true;
+      }
+      send_waiting_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    waiter->ok_ = true;
+    WakeWaiters(true);
+    return false;
+  }
+
+  /// 接收成功或者通道已经关闭返回false，否则加入等待队列并返回true
+  bool RecvOrEnqueue(RecvAwaiter *waiter) noexcept {
+    {
+      std::lock_guard lg(lock_);
+      recv_waiting_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!TryPop(waiter->value_)) {
+        if (closed_.load(std::memory_order_acquire)) {
+          recv_waiting_.fetch_sub(1, std::memory_order_relaxed);
+          TryPop(waiter->value_);
+          return false;
+        }
+        recv_waiters_.Push(waiter);
+        return true;
+      }
+      recv_waiting_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    WakeWaiters(false);
+    return false;
+  }
+
+  /// 缓冲区被写入(pushed)或者取出元素之后调用。代替等待者完成的操作又会改变缓冲区，
+  /// 所以交替唤醒两端，直到没有可以唤醒的等待者
+  void WakeWaiters(bool pushed) noexcept {
+    while (pushed ? WakeReceiver() : WakeSender()) {
+      pushed = !pushed;
+    }
+  }
+
+  /// 代替一个等待中的接收者取出元素并唤醒它，成功返回true
+  bool WakeReceiver() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (recv_waiting_.load(std::memory_order_relaxed) == 0) LIKELY {
+      return false;
+    }
+    RecvAwaiter *waiter;
+    {
+      std::lock_guard lg(lock_);
+      waiter = static_cast<RecvAwaiter *>(recv_waiters_.Pop());
+      if (!waiter) {
+        return false;
+      }
+      // 元素可能已经被其他接收者的快速路径取走，此时等待者留在队首
+      if (!TryPop(waiter->value_)) {
+        recv_waiters_.PushFront(waiter);
+        return false;
+      }
+      recv_waiting_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    waiter->Resume();
+    return true;
+  }
+
+  /// 代替一个等待中的发送者写入元素并唤醒它，成功返回true
+  bool WakeSender() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (send_waiting_.load(std::memory_order_relaxed) == 0) LIKELY {
+      return false;
+    }
+    SendAwaiter *waiter;
+    {
+      std::lock_guard lg(lock_);
+      waiter = static_cast<SendAwaiter *>(send_waiters_.Pop());
+      if (!waiter) {
+        return false;
+      }
+      if (!TryPush(std::move(waiter->value_))) {
+        send_waiters_.PushFront(waiter);
+        return false;
+      }
+      send_waiting_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    waiter->ok_ = true;
+    waiter->Resume();
+    return true;
+  }
+
+  static void ResumeAll(detail::Waiter *waiter) noexcept {
+    while (waiter) {
+      // 恢复之后waiter可能已经被销毁
+      auto next = waiter->next;
+      waiter->Resume();
+      waiter = next;
+    }
+  }
+
+  const std::size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<bool> closed_{false};
+  std::atomic<std::size_t> send_waiting_{0};  ///< send_waiters_中的个数，不加锁地判断是否需要唤醒
+  std::atomic<std::size_t> recv_waiting_{0};
+  util::SpinLock lock_;
+  detail::WaiterQueue send_waiters_;
+  detail::WaiterQueue recv_waiters_;
+};
+
+} // namespace async_simple::coro
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_CHANNEL_HPP_
@@ -4,7 +4,11 @@
 #include "async_simple/coro/count_event.hpp"
 #include "async_simple/coro/lazy.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <optional>
+#include <stop_token>
 
 namespace async_simple::coro {
 
@@ -32,39 +36,55 @@ struct CollectAnyResult<void> {
   Try<void> value;
 };
 
+/// 第一个任务完成后通过stop_source请求取消其余的任务，
+/// 没有单独设置stop_token的任务会在下一个挂起点抛出OperationCancelled，尽早释放资源
+/// 父协程的取消请求也会转发给所有任务
 template<typename LazyType, typename InAlloc>
 struct CollectAnyAwaiter : noncopyable {
   using ValueType = typename LazyType::ValueType;
   using ResultType = CollectAnyResult<ValueType>;
 
-  CollectAnyAwaiter(std::vector<LazyType, InAlloc> &&input)
-      : input(std::move(input)), result(nullptr) {}
+  struct RequestStop {
+    void operator()() { source.request_stop(); }
+    std::stop_source source;
+  };
+
+  CollectAnyAwaiter(std::vector<LazyType, InAlloc> &&input, std::stop_token token = {})
+      : input(std::move(input)), result(nullptr), stop_token(std::move(token)) {}
 
   CollectAnyAwaiter(CollectAnyAwaiter &&other)
-      : input(std::move(other.input)), result(std::move(other.result)) {}
+      : input(std::move(other.input)), result(std::move(other.result)),
+        stop_token(std::move(other.stop_token)) {}
 
   bool await_ready() const noexcept {
     return input.empty() || (result && result->index != static_cast<std::size_t>(-1));
   }
 
   void await_suspend(std::coroutine_handle<> continuation) {
-    auto promise = std::coroutine_handle<LazyPromiseBase>::from_address(
+    auto &promise = std::coroutine_handle<LazyPromiseBase>::from_address(
         continuation.address()).promise();
     auto executor = promise.executor_;
     std::vector<LazyType, InAlloc> in(std::move(input));
     auto res = std::make_shared<ResultType>();
     auto event = std::make_shared<CountEvent>(in.size());
+    std::stop_source source;
+    if (stop_token.stop_possible()) {
+      link.emplace(stop_token, RequestStop{source});
+    }
     result = res;
     for (size_t i = 0; i < in.size() && (res->index == static_cast<std::size_t>(-1)); ++i) {
-      if (!in[i].coro_.promise().executor_) {
-        in[i].coro_.promise().executor_ = executor;
+      auto &child = in[i].coro_.promise();
+      if (!child.executor_) {
+        child.executor_ = executor;
       }
-      in[i].Start([i, sz = in.size(), res, continuation, event](Try<ValueType> &&t) mutable {
+      child.InheritStopToken(source.get_token());
+      in[i].Start([i, sz = in.size(), res, continuation, event, source](Try<ValueType> &&t) mutable {
         ASSERT(event != nullptr);
         auto count = event->DownCount();
         if (count == sz + 1) {
           res->index = i;
           res->value = std::move(t);
+          source.request_stop();
           continuation.resume();
         }
       });
@@ -73,11 +93,14 @@ struct CollectAnyAwaiter : noncopyable {
 
   auto await_resume() {
     ASSERT(result != nullptr);
+    link.reset();
     return std::move(*result);
   }
 
   std::vector<LazyType, InAlloc> input;
   std::shared_ptr<ResultType> result;
+  std::stop_token stop_token;  ///< 父协程的stop_token
+  std::optional<std::stop_callback<RequestStop>> link;  ///< 把父协程的取消请求转发给所有任务
 };
 
 template<typename T, typename InAlloc>
@@ -86,40 +109,43 @@ struct SimpleCollectAnyAwaitable {
   using LazyType = Lazy<T>;
   using VectorType = std::vector<LazyType, InAlloc>;
 
-  SimpleCollectAnyAwaitable(VectorType &&_input)
-      : input(std::move(_input)) {}
+  SimpleCollectAnyAwaitable(VectorType &&_input, std::stop_token _token)
+      : input(std::move(_input)), token(std::move(_token)) {}
 
   auto CoAwait(Executor *executor) {
-    return CollectAnyAwaiter<LazyType, InAlloc>(std::move(input));
+    return CollectAnyAwaiter<LazyType, InAlloc>(std::move(input), std::move(token));
   }
 
   VectorType input;
+  std::stop_token token;
 };
 
 template<typename LazyType, typename IAlloc, typename OAlloc, bool Para = false>
 struct CollectAllAwaiter : noncopyable {
   using ValueType = typename LazyType::ValueType;
 
-  CollectAllAwaiter(std::vector<LazyType, IAlloc> &&in, OAlloc out_alloc)
-      : input(std::move(in)), output(out_alloc), event(input.size()) {
+  CollectAllAwaiter(std::vector<LazyType, IAlloc> &&in, OAlloc out_alloc, std::stop_token token = {})
+      : input(std::move(in)), output(out_alloc), event(input.size()), stop_token(std::move(token)) {
     output.resize(input.size());
   }
 
   CollectAllAwaiter(CollectAllAwaiter &&other)
       : input(std::move(other.input)),
         output(std::move(other.output)),
-        event(std::move(other.event)) {}
+        event(std::move(other.event)),
+        stop_token(std::move(other.stop_token)) {}
 
   bool await_ready() const noexcept { return input.empty(); }
   void await_suspend(std::coroutine_handle<> continuation) {
-    auto promise = std::coroutine_handle<LazyPromiseBase>::from_address(
+    auto &promise = std::coroutine_handle<LazyPromiseBase>::from_address(
         continuation.address()).promise();
     auto executor = promise.executor_;
     for (size_t i = 0; i < input.size(); ++i) {
-      auto &exec = input[i].coro_.promise().executor_;
-      if (!exec) {
-        exec = executor;
+      auto &child = input[i].coro_.promise();
+      if (!child.executor_) {
+        child.executor_ = executor;
       }
+      child.InheritStopToken(stop_token);
       auto &&func = [this, i]() {
         input[i].Start([this, i](Try<ValueType> &&t) {
           output[i] = std::move(t);
@@ -148,6 +174,7 @@ struct CollectAllAwaiter : noncopyable {
   std::vector<LazyType, IAlloc> input;
   std::vector<Try<ValueType>, OAlloc> output;
   CountEvent event;
+  std::stop_token stop_token;  ///< 父协程的stop_token，传递给没有单独设置的子任务
 };
 
 template<typename T, typename IAlloc, typename OAlloc, bool Para = false>
@@ -156,15 +183,121 @@ struct SimpleCollectAllAwaitable {
   using LazyType = Lazy<T>;
   using VectorType = std::vector<LazyType, IAlloc>;
 
-  SimpleCollectAllAwaitable(VectorType &&_input, OAlloc _out_alloc)
-      : input(std::move(_input)), out_alloc(_out_alloc) {}
+  SimpleCollectAllAwaitable(VectorType &&_input, OAlloc _out_alloc, std::stop_token _token)
+      : input(std::move(_input)), out_alloc(_out_alloc), token(std::move(_token)) {}
 
   auto CoAwait(Executor *executor) {
-    return CollectAllAwaiter<LazyType, IAlloc, OAlloc, Para>(std::move(input), out_alloc);
+    return CollectAllAwaiter<LazyType, IAlloc, OAlloc, Para>(std::move(input), out_alloc, std::move(token));
   }
 
   VectorType input;
   OAlloc out_alloc;
+  std::stop_token token;
+};
+
+/// 滑动窗口：始终保持max_concurrency个任务在执行，任何一个任务完成后立即启动下一个
+/// 任务同步完成时不会递归启动下一个，而是由当前持有launching_的线程循环启动
+template<typename LazyType, typename IAlloc, typename OAlloc, bool Para = false>
+struct CollectAllWindowedAwaiter : noncopyable {
+  using ValueType = typename LazyType::ValueType;
+
+  CollectAllWindowedAwaiter(std::size_t max_concurrency, bool yield,
+                            std::vector<LazyType, IAlloc> &&in, OAlloc out_alloc,
+                            std::stop_token token = {})
+      : max_concurrency(max_concurrency), yield(yield), input(std::move(in)),
+        output(out_alloc), event(input.size()), stop_token(std::move(token)) {
+    output.resize(input.size());
+  }
+
+  CollectAllWindowedAwaiter(CollectAllWindowedAwaiter &&other)
+      : max_concurrency(other.max_concurrency),
+        yield(other.yield),
+        input(std::move(other.input)),
+        output(std::move(other.output)),
+        event(std::move(other.event)),
+        stop_token(std::move(other.stop_token)) {}
+
+  bool await_ready() const noexcept { return input.empty(); }
+  void await_suspend(std::coroutine_handle<> continuation) {
+    auto &promise = std::coroutine_handle<LazyPromiseBase>::from_address(
+        continuation.address()).promise();
+    executor = promise.executor_;
+    event.SetAwaitingCoroutine(continuation);
+    Launch(std::min(max_concurrency, input.size()));
+    auto awaiting_coro = event.Down();
+    if (awaiting_coro) {
+      awaiting_coro.resume();
+    }
+  }
+  auto await_resume() { return std::move(output); }
+
+  /// 增加n个启动名额，没有其他线程在启动任务时由当前线程负责启动
+  /// 调用者自己的任务还没有Down，所以循环期间this一直有效
+  void Launch(std::size_t n) {
+    if (launching.fetch_add(n, std::memory_order_acq_rel) != 0) {
+      return;
+    }
+    do {
+      if (next < input.size()) {
+        auto i = next++;
+        // 第一个窗口之外的任务在yield时也通过executor启动，让出当前线程
+        bool scheduled = (Para || (yield && i >= max_concurrency)) && executor &&
+            executor->Schedule([this, i]() { Start(i); });
+        if (!scheduled) {
+          Start(i);
+        }
+      }
+    } while (launching.fetch_sub(1, std::memory_order_acq_rel) != 1);
+  }
+
+  void Start(std::size_t i) {
+    auto &child = input[i].coro_.promise();
+    if (!child.executor_) {
+      child.executor_ = executor;
+    }
+    child.InheritStopToken(stop_token);
+    input[i].Start([this, i](Try<ValueType> &&t) {
+      output[i] = std::move(t);
+      Launch(1);
+      auto awaiting_coro = event.Down();
+      if (awaiting_coro) {
+        awaiting_coro.resume();
+      }
+    });
+  }
+
+  std::size_t max_concurrency;
+  bool yield;
+  std::vector<LazyType, IAlloc> input;
+  std::vector<Try<ValueType>, OAlloc> output;
+  CountEvent event;
+  Executor *executor{nullptr};
+  std::stop_token stop_token;
+  std::size_t next{0};  ///< 下一个要启动的任务，只有持有launching的线程访问
+  std::atomic<std::size_t> launching{0};
+};
+
+template<typename T, typename IAlloc, typename OAlloc, bool Para = false>
+struct SimpleCollectAllWindowedAwaitable {
+  using ValueType = T;
+  using LazyType = Lazy<T>;
+  using VectorType = std::vector<LazyType, IAlloc>;
+
+  SimpleCollectAllWindowedAwaitable(std::size_t _max_concurrency, bool _yield,
+                                    VectorType &&_input, OAlloc _out_alloc, std::stop_token _token)
+      : max_concurrency(_max_concurrency), yield(_yield),
+        input(std::move(_input)), out_alloc(_out_alloc), token(std::move(_token)) {}
+
+  auto CoAwait(Executor *) {
+    return CollectAllWindowedAwaiter<LazyType, IAlloc, OAlloc, Para>(
+        max_concurrency, yield, std::move(input), out_alloc, std::move(token));
+  }
+
+  std::size_t max_concurrency;
+  bool yield;
+  VectorType input;
+  OAlloc out_alloc;
+  std::stop_token token;
 };
 
 } // namespace async::simple::detail
@@ -176,27 +309,35 @@ inline auto CollectAny(std::vector<LazyType<T>, IAlloc> &&input)
   using AT = std::conditional_t<std::is_same_v<LazyType<T>, Lazy<T>>,
                                 detail::SimpleCollectAnyAwaitable<T, IAlloc>,
                                 detail::CollectAnyAwaiter<LazyType<T>, IAlloc>>;
-  co_return co_await AT(std::move(input));
+  // 等待RescheduleLazy时awaiter会被ViaAsyncAwaiter包装，拿不到当前协程的promise，
+  // 所以stop_token需要显式传进去
+  co_return co_await AT(std::move(input), co_await CurrentStopToken{});
 }
 
+ASYNC_SIMPLE_FRAME_ALLOC_WARNINGS_PUSH
+
 namespace detail {
 
-template<bool Para, typename T, template<typename> typename LazyType,
+/// 以std::allocator_arg_t, FrameAlloc开头，自身的协程帧通过FrameAlloc分配
+/// frame_alloc在函数体中没有用到，只用来选择FrameAllocator的operator new
+template<bool Para, typename FrameAlloc, typename T, template<typename> typename LazyType,
     typename IAlloc = std::allocator<LazyType<T>>,
     typename OAlloc = std::allocator<Try<T>>>
-inline auto CollectAllImpl(std::vector<LazyType<T>, IAlloc> &&input,
+inline auto CollectAllImpl(std::allocator_arg_t, [[maybe_unused]] FrameAlloc frame_alloc,
+                           std::vector<LazyType<T>, IAlloc> &&input,
                            OAlloc out_alloc = OAlloc())
 -> Lazy<std::vector<Try<T>, OAlloc>> {
   using AT = std::conditional_t<std::is_same_v<LazyType<T>, Lazy<T>>,
                                 detail::SimpleCollectAllAwaitable<T, IAlloc, OAlloc, Para>,
                                 detail::CollectAllAwaiter<LazyType<T>, IAlloc, OAlloc, Para>>;
-  co_return co_await AT(std::move(input), out_alloc);
+  co_return co_await AT(std::move(input), out_alloc, co_await CurrentStopToken{});
 }
 
-template<bool Para, typename T, template<typename> typename LazyType,
+template<bool Para, typename FrameAlloc, typename T, template<typename> typename LazyType,
     typename IAlloc = std::allocator<LazyType<T>>,
     typename OAlloc = std::allocator<Try<T>>>
-inline auto CollectAllWindowedImpl(size_t max_concurrency,
+inline auto CollectAllWindowedImpl(std::allocator_arg_t, [[maybe_unused]] FrameAlloc frame_alloc,
+                                   size_t max_concurrency,
                                    bool yield,
                                    std::vector<LazyType<T>, IAlloc> &&input,
                                    OAlloc out_alloc = OAlloc())
@@ -204,27 +345,13 @@ inline auto CollectAllWindowedImpl(size_t max_concurrency,
   using AT = std::conditional_t<std::is_same_v<LazyType<T>, Lazy<T>>,
                                 detail::SimpleCollectAllAwaitable<T, IAlloc, OAlloc, Para>,
                                 detail::CollectAllAwaiter<LazyType<T>, IAlloc, OAlloc, Para>>;
-  std::vector<Try<T>, OAlloc> output(out_alloc);
-  std::size_t input_size = input.size();
-  if (max_concurrency == 0 || input_size <= max_concurrency) {
-    co_return co_await AT(std::move(input), out_alloc);
+  using WAT = std::conditional_t<std::is_same_v<LazyType<T>, Lazy<T>>,
+                                 detail::SimpleCollectAllWindowedAwaitable<T, IAlloc, OAlloc, Para>,
+                                 detail::CollectAllWindowedAwaiter<LazyType<T>, IAlloc, OAlloc, Para>>;
+  if (max_concurrency == 0 || input.size() <= max_concurrency) {
+    co_return co_await AT(std::move(input), out_alloc, co_await CurrentStopToken{});
   }
-  std::size_t start = 0;
-  while (start < input_size) {
-    std::size_t end = std::min(input_size, start + max_concurrency);
-    std::vector<LazyType<T>, IAlloc> tmp_group(input.get_allocator());
-    for (; start < end; ++start) {
-      tmp_group.push_back(std::move(input[start]));
-    }
-    auto tmp_output = co_await AT(std::move(tmp_group), out_alloc);
-    for (auto &t : tmp_output) {
-      output.push_back(std::move(t));
-    }
-    if (yield) {
-      co_await Yield{};
-    }
-  }
-  co_return std::move(output);
+  co_return co_await WAT(max_concurrency, yield, std::move(input), out_alloc, co_await CurrentStopToken{});
 }
 
 template<template<typename> typename LazyType, typename Ts>
@@ -253,7 +380,7 @@ inline auto CollectAllVariadicImpl(std::index_sequence<Indices...>,
   std::vector<Lazy<void>> wrapper_tasks;
   (..., wrapper_tasks.push_back(std::move(
       MakeWrapperTask(std::move(awaitables), std::get<Indices>(results)))));
-  co_await CollectAllImpl<Para>(std::move(wrapper_tasks));
+  co_await CollectAllImpl<Para>(std::allocator_arg, std::allocator<char>(), std::move(wrapper_tasks));
   co_return std::move(results);
 }
 
@@ -266,7 +393,22 @@ template<typename T,
 inline auto CollectAll(std::vector<LazyType<T>, IAlloc> &&input,
                        OAlloc out_alloc = OAlloc{})
 -> Lazy<std::vector<Try<T>, OAlloc>> {
-  co_return co_await detail::CollectAllImpl<false>(std::move(input), out_alloc);
+  co_return co_await detail::CollectAllImpl<false>(std::allocator_arg, std::allocator<char>(),
+                                                    std::move(input), out_alloc);
+}
+
+/// CollectAll和内部的协程帧都通过frame_alloc分配，可以和IAlloc、OAlloc一起使用同一个arena
+template<typename FrameAlloc,
+    typename T,
+    template<typename> typename LazyType,
+    typename IAlloc = std::allocator<LazyType<T>>,
+    typename OAlloc = std::allocator<Try<T>>>
+inline auto CollectAll(std::allocator_arg_t, FrameAlloc frame_alloc,
+                       std::vector<LazyType<T>, IAlloc> &&input,
+                       OAlloc out_alloc = OAlloc{})
+-> Lazy<std::vector<Try<T>, OAlloc>> {
+  co_return co_await detail::CollectAllImpl<false>(std::allocator_arg, frame_alloc,
+                                                    std::move(input), out_alloc);
 }
 
 template<typename T,
@@ -276,7 +418,21 @@ template<typename T,
 inline auto CollectAllPara(std::vector<LazyType<T>, IAlloc> &&input,
                            OAlloc out_alloc = OAlloc{})
 -> Lazy<std::vector<Try<T>, OAlloc>> {
-  co_return co_await detail::CollectAllImpl<true>(std::move(input), out_alloc);
+  co_return co_await detail::CollectAllImpl<true>(std::allocator_arg, std::allocator<char>(),
+                                                   std::move(input), out_alloc);
+}
+
+template<typename FrameAlloc,
+    typename T,
+    template<typename> typename LazyType,
+    typename IAlloc = std::allocator<LazyType<T>>,
+    typename OAlloc = std::allocator<Try<T>>>
+inline auto CollectAllPara(std::allocator_arg_t, FrameAlloc frame_alloc,
+                           std::vector<LazyType<T>, IAlloc> &&input,
+                           OAlloc out_alloc = OAlloc{})
+-> Lazy<std::vector<Try<T>, OAlloc>> {
+  co_return co_await detail::CollectAllImpl<true>(std::allocator_arg, frame_alloc,
+                                                   std::move(input), out_alloc);
 }
 
 template<template<typename> typename LazyType, typename ...Ts>
@@ -311,7 +467,22 @@ inline auto CollectAllWindowed(std::size_t max_concurrency,
                                OAlloc out_alloc = OAlloc{})
 -> Lazy<std::vector<Try<T>, OAlloc>> {
   co_return co_await detail::CollectAllWindowedImpl<false>(
-      max_concurrency, yield, std::move(input), out_alloc);
+      std::allocator_arg, std::allocator<char>(), max_concurrency, yield, std::move(input), out_alloc);
+}
+
+template<typename FrameAlloc,
+    typename T,
+    template<typename> typename LazyType,
+    typename IAlloc = std::allocator<LazyType<T>>,
+    typename OAlloc = std::allocator<Try<T>>>
+inline auto CollectAllWindowed(std::allocator_arg_t, FrameAlloc frame_alloc,
+                               std::size_t max_concurrency,
+                               bool yield,
+                               std::vector<LazyType<T>, IAlloc> &&input,
+                               OAlloc out_alloc = OAlloc{})
+-> Lazy<std::vector<Try<T>, OAlloc>> {
+  co_return co_await detail::CollectAllWindowedImpl<false>(
+      std::allocator_arg, frame_alloc, max_concurrency, yield, std::move(input), out_alloc);
 }
 
 template<typename T,
@@ -324,9 +495,26 @@ inline auto CollectAllWindowedPara(std::size_t max_concurrency,
                                    OAlloc out_alloc = OAlloc{})
 -> Lazy<std::vector<Try<T>, OAlloc>> {
   co_return co_await detail::CollectAllWindowedImpl<true>(
-      max_concurrency, yield, std::move(input), out_alloc);
+      std::allocator_arg, std::allocator<char>(), max_concurrency, yield, std::move(input), out_alloc);
 }
 
+template<typename FrameAlloc,
+    typename T,
+    template<typename> typename LazyType,
+    typename IAlloc = std::allocator<LazyType<T>>,
+    typename OAlloc = std::allocator<Try<T>>>
+inline auto CollectAllWindowedPara(std::allocator_arg_t, FrameAlloc frame_alloc,
+                                   std::size_t max_concurrency,
+                                   bool yield,
+                                   std::vector<LazyType<T>, IAlloc> &&input,
+                                   OAlloc out_alloc = OAlloc{})
+-> Lazy<std::vector<Try<T>, OAlloc>> {
+  co_return co_await detail::CollectAllWindowedImpl<true>(
+      std::allocator_arg, frame_alloc, max_concurrency, yield, std::move(input), out_alloc);
+}
+
+ASYNC_SIMPLE_FRAME_ALLOC_WARNINGS_POP
+
 } // namespace async_simple::coro
 
 #endif // MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_COLLECT_HPP_
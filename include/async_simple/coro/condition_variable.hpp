@@ -0,0 +1,104 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_CONDITION_VARIABLE_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_CONDITION_VARIABLE_HPP_
+
+#include "async_simple/base/noncopyable.hpp"
+#include "async_simple/coro/lazy.hpp"
+#include "async_simple/coro/mutex.hpp"
+#include "async_simple/coro/waiter.hpp"
+#include "async_simple/util/spin_lock.hpp"
+
+#include <mutex>
+
+namespace async_simple::coro {
+
+/// 配合coro::Mutex使用的条件变量
+/// ```
+/// auto lock = co_await mutex.CoScopedLock();
+/// co_await cv.Wait(mutex, [&] { return ready; });
+/// ```
+/// 被唤醒的等待者不会直接恢复，而是被移到mutex的等待队列中，拿到锁之后才恢复，
+/// 避免唤醒之后马上又因为锁被占用而挂起
+class ConditionVariable : noncopyable {
+ public:
+  class WaitAwaiter : public detail::Waiter {
+   public:
+    WaitAwaiter(ConditionVariable &cv, Mutex &mutex, Executor *ex) : cv_(cv), mutex_(mutex) { executor = ex; }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> continuation) noexcept {
+      Prepare(continuation);
+      {
+        std::lock_guard lg(cv_.lock_);
+        cv_.waiters_.Push(this);
+      }
+      mutex_.Unlock();
+    }
+    void await_resume() noexcept {}
+
+   private:
+    friend class ConditionVariable;
+
+    ConditionVariable &cv_;
+    Mutex &mutex_;
+  };
+
+  class WaitAwaitable {
+   public:
+    WaitAwaitable(ConditionVariable &cv, Mutex &mutex) : cv_(cv), mutex_(mutex) {}
+    WaitAwaiter CoAwait(Executor *executor) { return {cv_, mutex_, executor}; }
+
+   private:
+    ConditionVariable &cv_;
+    Mutex &mutex_;
+  };
+
+  /// 调用前需要持有mutex，返回时重新持有mutex，可能会虚假唤醒
+  WaitAwaitable Wait(Mutex &mutex) noexcept { return {*this, mutex}; }
+
+  /// 调用前需要持有mutex，直到pred返回true
+  template<typename Pred>
+  Lazy<void> Wait(Mutex &mutex, Pred pred) {
+    while (!pred()) {
+      co_await Wait(mutex);
+    }
+  }
+
+  void NotifyOne() noexcept {
+    detail::Waiter *waiter;
+    {
+      std::lock_guard lg(lock_);
+      waiter = waiters_.Pop();
+    }
+    if (waiter) {
+      Requeue(static_cast<WaitAwaiter *>(waiter));
+    }
+  }
+
+  void NotifyAll() noexcept {
+    detail::Waiter *waiter;
+    {
+      std::lock_guard lg(lock_);
+      waiter = waiters_.PopAll();
+    }
+    while (waiter) {
+      auto next = waiter->next;
+      Requeue(static_cast<WaitAwaiter *>(waiter));
+      waiter = next;
+    }
+  }
+
+ private:
+  /// 把等待者交给mutex，锁空闲时直接恢复
+  static void Requeue(WaitAwaiter *waiter) noexcept {
+    if (!waiter->mutex_.LockOrEnqueue(waiter)) {
+      waiter->Resume();
+    }
+  }
+
+  util::SpinLock lock_;
+  detail::WaiterQueue waiters_;
+};
+
+} // namespace async_simple::coro
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_CONDITION_VARIABLE_HPP_
@@ -2,6 +2,7 @@
 #define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_CORO_CONCEPT_HPP_
 
 #include <coroutine>
+#include <stop_token>
 #include <utility>
 
 namespace async_simple::coro {
@@ -13,6 +14,12 @@ concept HasCoAwaitMethod = requires(T&& t) {
   t.CoAwait(nullptr);
 };
 
+/// 可以观察当前协程stop_token的Awaitable
+template<typename T>
+concept HasStoppableCoAwaitMethod = requires(T&& t, const std::stop_token &token) {
+  t.CoAwait(nullptr, token);
+};
+
 template<typename T>
 concept HasMemberCoAwaitOperator = requires(T&& t) {
   t.operator co_await();
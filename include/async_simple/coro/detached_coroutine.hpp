@@ -5,6 +5,8 @@
 #include <cstdio>
 #include <exception>
 
+#include "async_simple/util/frame_pool.hpp"
+
 namespace async_simple::coro {
 
 struct DetachedCoroutine {
@@ -13,6 +15,10 @@ struct DetachedCoroutine {
     std::suspend_never final_suspend() noexcept { return {}; }
     DetachedCoroutine get_return_object() noexcept { return {}; }
     void return_void() noexcept {}
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+    static void *operator new(std::size_t size) { return util::FramePool::Allocate(size); }
+    static void operator delete(void *ptr) noexcept { util::FramePool::Deallocate(ptr); }
+#endif
     void unhandled_exception() {
       try {
         std::rethrow_exception(std::current_exception());
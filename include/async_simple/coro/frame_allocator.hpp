@@ -0,0 +1,137 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_FRAME_ALLOCATOR_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_FRAME_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "async_simple/util/frame_pool.hpp"
+
+/// GCC 13之前的版本把以std::allocator_arg_t开头的协程的帧分配当作placement new，
+/// 和协程帧释放时调用的operator delete(void *, std::size_t)配对检查，报出-Wmismatched-new-delete。
+/// 这是误报，两者都是FrameAllocator的成员，释放时通过帧末尾的释放函数找回分配器。
+/// 定义这类协程的地方用这两个宏包起来，其他编译器上为空
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 13
+#define ASYNC_SIMPLE_FRAME_ALLOC_WARNINGS_PUSH \
+  _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wmismatched-new-delete\"")
+#define ASYNC_SIMPLE_FRAME_ALLOC_WARNINGS_POP _Pragma("GCC diagnostic pop")
+#else
+#define ASYNC_SIMPLE_FRAME_ALLOC_WARNINGS_PUSH
+#define ASYNC_SIMPLE_FRAME_ALLOC_WARNINGS_POP
+#endif
+
+namespace async_simple::coro::detail {
+
+template<typename Alloc>
+inline constexpr bool kIsStdAllocator = false;
+template<typename T>
+inline constexpr bool kIsStdAllocator<std::allocator<T>> = true;
+
+/// 协程帧的分配策略，Lazy的promise继承它
+/// - 默认从util::FramePool中分配，定义ASYNC_SIMPLE_DISABLE_FRAME_POOL时使用全局的operator new
+/// - 协程的参数以std::allocator_arg_t, Alloc开头时（成员函数和lambda的对象参数之后），
+///   帧通过Alloc分配和释放，Alloc会被复制一份保存在帧的末尾。std::allocator按默认方式处理
+/// ```
+/// Lazy<int> Foo(std::allocator_arg_t, std::pmr::polymorphic_allocator<> alloc, int x);
+/// ```
+class FrameAllocator {
+  using DeallocFn = void (*)(void *frame, std::size_t size) noexcept;
+
+ public:
+  static void *operator new(std::size_t size) {
+    void *frame = DefaultAllocate(TrailerOffset(size) + sizeof(DeallocFn));
+    Trailer(frame, size) = nullptr;
+    return frame;
+  }
+
+  template<typename Alloc, typename... Args>
+  static void *operator new(std::size_t size, std::allocator_arg_t, const Alloc &alloc, const Args &...) {
+    return Allocate(size, alloc);
+  }
+
+  template<typename This, typename Alloc, typename... Args>
+  static void *operator new(std::size_t size, const This &, std::allocator_arg_t, const Alloc &alloc,
+                            const Args &...) {
+    return Allocate(size, alloc);
+  }
+
+  /// 协程帧的释放会带上分配时的大小，用来找到帧末尾的释放函数
+  static void operator delete(void *frame, std::size_t size) noexcept {
+    if (auto dealloc = Trailer(frame, size)) {
+      dealloc(frame, size);
+    } else {
+      DefaultDeallocate(frame);
+    }
+  }
+
+ private:
+  struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Unit {
+    std::byte data[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+  };
+  template<typename Alloc>
+  using UnitAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Unit>;
+
+  static constexpr std::size_t AlignUp(std::size_t n, std::size_t align) {
+    return (n + align - 1) & ~(align - 1);
+  }
+  static constexpr std::size_t TrailerOffset(std::size_t size) {
+    return AlignUp(size, alignof(DeallocFn));
+  }
+  static DeallocFn &Trailer(void *frame, std::size_t size) noexcept {
+    return *reinterpret_cast<DeallocFn *>(static_cast<std::byte *>(frame) + TrailerOffset(size));
+  }
+
+  /// 帧的布局：[协程帧][释放函数][Alloc]
+  template<typename Alloc>
+  static constexpr std::size_t AllocOffset(std::size_t size) {
+    return AlignUp(TrailerOffset(size) + sizeof(DeallocFn), alignof(UnitAlloc<Alloc>));
+  }
+  template<typename Alloc>
+  static constexpr std::size_t UnitCount(std::size_t size) {
+    return (AllocOffset<Alloc>(size) + sizeof(UnitAlloc<Alloc>) + sizeof(Unit) - 1) / sizeof(Unit);
+  }
+
+  static void *DefaultAllocate(std::size_t size) {
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+    return util::FramePool::Allocate(size);
+#else
+    return ::operator new(size);
+#endif
+  }
+  static void DefaultDeallocate(void *frame) noexcept {
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+    util::FramePool::Deallocate(frame);
+#else
+    ::operator delete(frame);
+#endif
+  }
+
+  template<typename Alloc>
+  static void *Allocate(std::size_t size, const Alloc &alloc) {
+    if constexpr (kIsStdAllocator<Alloc>) {
+      return FrameAllocator::operator new(size);
+    } else {
+      static_assert(alignof(UnitAlloc<Alloc>) <= alignof(Unit));
+      UnitAlloc<Alloc> unit_alloc(alloc);
+      void *frame = std::allocator_traits<UnitAlloc<Alloc>>::allocate(unit_alloc, UnitCount<Alloc>(size));
+      Trailer(frame, size) = &Deallocate<Alloc>;
+      ::new(static_cast<std::byte *>(frame) + AllocOffset<Alloc>(size)) UnitAlloc<Alloc>(std::move(unit_alloc));
+      return frame;
+    }
+  }
+
+  template<typename Alloc>
+  static void Deallocate(void *frame, std::size_t size) noexcept {
+    auto stored = std::launder(reinterpret_cast<UnitAlloc<Alloc> *>(
+        static_cast<std::byte *>(frame) + AllocOffset<Alloc>(size)));
+    UnitAlloc<Alloc> unit_alloc(std::move(*stored));
+    std::destroy_at(stored);
+    std::allocator_traits<UnitAlloc<Alloc>>::deallocate(unit_alloc, static_cast<Unit *>(frame),
+                                                        UnitCount<Alloc>(size));
+  }
+};
+
+} // namespace async_simple::coro::detail
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_FRAME_ALLOCATOR_HPP_
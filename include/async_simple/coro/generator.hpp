@@ -0,0 +1,186 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_GENERATOR_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_GENERATOR_HPP_
+
+#include "async_simple/base/assert.hpp"
+#include "async_simple/base/noncopyable.hpp"
+#include "async_simple/coro/lazy.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+namespace async_simple::coro {
+
+template<typename T>
+class AsyncGenerator;
+
+namespace detail {
+
+/// 复用LazyPromiseBase的await_transform，生成器内部co_await的规则和Lazy相同
+template<typename T>
+class AsyncGeneratorPromise : public LazyPromiseBase {
+ public:
+  /// 挂起生成器并切回等待Next()的协程
+  struct YieldValueAwaiter {
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<AsyncGeneratorPromise> h) noexcept {
+      return h.promise().continuation_;
+    }
+    void await_resume() noexcept {}
+  };
+
+  AsyncGenerator<T> get_return_object() noexcept;
+
+  /// 右值只保存地址，co_yield表达式中的临时对象会一直存活到生成器恢复
+  YieldValueAwaiter yield_value(std::remove_reference_t<T> &&value) noexcept {
+    value_ = std::addressof(value);
+    return {};
+  }
+  /// 左值复制一份保存在promise中，生成器之后还能继续使用原来的对象
+  YieldValueAwaiter yield_value(const std::remove_reference_t<T> &value)
+  requires std::is_copy_constructible_v<T> {
+    value_ = std::addressof(copy_.emplace(value));
+    return {};
+  }
+
+  void return_void() noexcept {}
+  void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+  /// 生成器结束时返回std::nullopt，生成器抛出的异常在这里重新抛出
+  std::optional<T> Take(std::coroutine_handle<AsyncGeneratorPromise> h) {
+    if (h.done()) {
+      if (exception_) UNLIKELY {
+        std::rethrow_exception(std::exchange(exception_, nullptr));
+      }
+      return std::nullopt;
+    }
+    std::optional<T> result(std::move(*value_));
+    copy_.reset();
+    return result;
+  }
+
+ private:
+  std::remove_reference_t<T> *value_{nullptr};
+  std::optional<T> copy_;  ///< co_yield左值时的副本
+  std::exception_ptr exception_;
+};
+
+} // namespace async_simple::coro::detail
+
+/// 可以co_yield多个值、内部也可以co_await的协程，用于流式地返回结果，
+/// 调用方每次只持有一个元素，不需要先把所有结果放到vector中
+/// ```
+/// AsyncGenerator<Row> Scan(Table &table) {
+///   while (auto page = co_await table.ReadPage()) {
+///     for (auto &row : *page) co_yield std::move(row);
+///   }
+/// }
+///
+/// auto gen = Scan(table);
+/// while (auto row = co_await gen.Next()) { ... }
+/// co_await Scan(table).ForEach([](Row &row) { ... });
+/// ```
+/// - 和Lazy一样在第一次Next()之前不会执行，每次Next()把调用方的Executor和stop_token传给生成器
+/// - co_yield之后生成器挂起并直接切回调用方，右值从生成器的帧中移动出来，左值复制一份，没有额外的分配
+/// - 不能同时有两个Next()在等待同一个生成器
+template<typename T>
+class AsyncGenerator : noncopyable {
+ public:
+  using promise_type = detail::AsyncGeneratorPromise<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+  using ValueType = T;
+
+  class NextAwaiter {
+   public:
+    explicit NextAwaiter(Handle coro) : coro_(coro) {}
+
+    bool await_ready() const noexcept { return !coro_ || coro_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+      coro_.promise().continuation_ = continuation;
+      return coro_;
+    }
+    std::optional<T> await_resume() {
+      if (!coro_) {
+        return std::nullopt;
+      }
+      return coro_.promise().Take(coro_);
+    }
+
+   private:
+    Handle coro_;
+  };
+
+  class NextAwaitable {
+   public:
+    explicit NextAwaitable(Handle coro) : coro_(coro) {}
+
+    NextAwaiter CoAwait(Executor *executor) {
+      if (coro_) {
+        coro_.promise().executor_ = executor;
+      }
+      return NextAwaiter(coro_);
+    }
+    NextAwaiter CoAwait(Executor *executor, const std::stop_token &token) {
+      if (coro_) {
+        coro_.promise().executor_ = executor;
+        coro_.promise().InheritStopToken(token);
+      }
+      return NextAwaiter(coro_);
+    }
+
+   private:
+    Handle coro_;
+  };
+
+  explicit AsyncGenerator(Handle coro) : coro_(coro) {}
+  AsyncGenerator(AsyncGenerator &&other) noexcept : coro_(std::exchange(other.coro_, nullptr)) {}
+  AsyncGenerator &operator=(AsyncGenerator &&other) noexcept {
+    if (this != &other) {
+      Destroy();
+      coro_ = std::exchange(other.coro_, nullptr);
+    }
+    return *this;
+  }
+  ~AsyncGenerator() { Destroy(); }
+
+  /// co_await gen.Next()，返回下一个值，生成器结束时返回std::nullopt
+  NextAwaitable Next() noexcept { return NextAwaitable(coro_); }
+
+  /// 依次对每个值调用f，f可以返回Lazy<void>，此时会等待它完成再取下一个值
+  template<typename F>
+  Lazy<void> ForEach(F f) {
+    while (auto value = co_await Next()) {
+      if constexpr (std::is_same_v<std::invoke_result_t<F &, T &>, Lazy<void>>) {
+        co_await f(*value);
+      } else {
+        f(*value);
+      }
+    }
+  }
+
+  /// 生成器已经结束
+  bool IsDone() const noexcept { return !coro_ || coro_.done(); }
+
+ private:
+  void Destroy() noexcept {
+    if (coro_) {
+      coro_.destroy();
+      coro_ = nullptr;
+    }
+  }
+
+  Handle coro_;
+};
+
+template<typename T>
+inline AsyncGenerator<T> detail::AsyncGeneratorPromise<T>::get_return_object() noexcept {
+  return AsyncGenerator<T>(AsyncGenerator<T>::Handle::from_promise(*this));
+}
+
+} // namespace async_simple::coro
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_GENERATOR_HPP_
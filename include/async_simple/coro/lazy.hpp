@@ -1,13 +1,19 @@
 #ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_LAZY_HPP_
 #define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_LAZY_HPP_
 
+#include "async_simple/base/cancellation.hpp"
 #include "async_simple/base/macro.hpp"
 #include "async_simple/base/try.hpp"
 #include "async_simple/coro/via_coroutine.hpp"
 #include "async_simple/coro/detached_coroutine.hpp"
+#include "async_simple/coro/frame_allocator.hpp"
 #include "async_simple/coro/ready_awaiter.hpp"
 #include "async_simple/executor/executor.hpp"
 
+#include <atomic>
+#include <semaphore>
+#include <stop_token>
+
 namespace async_simple::coro {
 
 template<typename T>
@@ -20,31 +26,74 @@ namespace detail {
 template<typename LazyType, typename IAlloc, typename OAlloc, bool Para>
 struct CollectAllAwaiter;
 
+template<typename LazyType, typename IAlloc, typename OAlloc, bool Para>
+struct CollectAllWindowedAwaiter;
+
 template<typename LazyType, typename IAlloc>
 struct CollectAnyAwaiter;
 
-class LazyPromiseBase {
+template<typename T>
+class TimeoutAwaitable;
+
+/// SyncAwait阻塞的线程和结束的协程之间谁后到谁负责唤醒
+/// 协程在SyncAwait的线程上同步结束时不需要信号量，只有调用方已经阻塞时才release
+class SyncWaiter : noncopyable {
+ public:
+  /// 协程结束时调用，之后调用方随时可能返回，不能再访问this
+  void Notify() noexcept {
+    if (state_.exchange(kDone, std::memory_order_acq_rel) == kParked) {
+      sem_.release();
+    }
+  }
+  void Wait() noexcept {
+    if (state_.exchange(kParked, std::memory_order_acq_rel) != kDone) {
+      sem_.acquire();
+    }
+  }
+
+ private:
+  static constexpr uint8_t kRunning = 0;
+  static constexpr uint8_t kParked = 1;
+  static constexpr uint8_t kDone = 2;
+
+  std::atomic<uint8_t> state_{kRunning};
+  std::binary_semaphore sem_{0};
+};
+
+class LazyPromiseBase : public FrameAllocator {
  public:
   struct FinalAwaiter {
     bool await_ready() const noexcept { return false; }
     template<typename PromiseType>
-    auto await_suspend(std::coroutine_handle<PromiseType> h) noexcept {
-      return h.promise().continuation_;
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseType> h) noexcept {
+      auto &promise = h.promise();
+      if (promise.sync_waiter_) UNLIKELY {
+        // SyncAwait的线程被唤醒后会立即销毁协程，Notify之后不能再访问promise
+        promise.sync_waiter_->Notify();
+        return std::noop_coroutine();
+      }
+      return promise.continuation_;
     }
     void await_resume() noexcept {}
   };  // struct FinalAwaiter
 
+  /// 已经请求取消时不再让出，直接抛出OperationCancelled
   struct YieldAwaiter {
-    YieldAwaiter(Executor *ex) : executor(ex) {}
-    bool await_ready() const noexcept { return false; }
+    YieldAwaiter(Executor *ex, const std::stop_token &t) : executor(ex), token(t) {}
+    bool await_ready() const noexcept { return token.stop_requested(); }
     void await_suspend(std::coroutine_handle<> handle) {
       executor->Schedule([handle]() mutable {
         handle.resume();
       });
     }
-    void await_resume() noexcept {}
+    void await_resume() const {
+      if (token.stop_requested()) {
+        throw OperationCancelled();
+      }
+    }
 
     Executor *executor;
+    const std::stop_token &token;
   }; // struct YieldAwaiter
 
   LazyPromiseBase() : executor_(nullptr) {}
@@ -54,15 +103,31 @@ class LazyPromiseBase {
 
   template<typename Awaitable>
   auto await_transform(Awaitable &&awaitable) {
-    return CoAwait(executor_, std::forward<Awaitable>(awaitable));
+    if constexpr (HasStoppableCoAwaitMethod<Awaitable>) {
+      return std::forward<Awaitable>(awaitable).CoAwait(executor_, stop_token_);
+    } else {
+      return CoAwait(executor_, std::forward<Awaitable>(awaitable));
+    }
   }
   auto await_transform(CurrentExecutor) {
     return ReadyAwaiter<Executor *>(executor_);
   }
-  auto await_transform(Yield) { return YieldAwaiter(executor_); }
+  auto await_transform(CurrentStopToken) {
+    return ReadyAwaiter<std::stop_token>(stop_token_);
+  }
+  auto await_transform(Yield) { return YieldAwaiter(executor_, stop_token_); }
+
+  /// 子协程没有单独设置stop_token时继承父协程的
+  void InheritStopToken(const std::stop_token &token) {
+    if (token.stop_possible() && !stop_token_.stop_possible()) {
+      stop_token_ = token;
+    }
+  }
 
   Executor *executor_;
   std::coroutine_handle<> continuation_;
+  std::stop_token stop_token_;
+  SyncWaiter *sync_waiter_{nullptr};  ///< 被SyncAwait直接驱动时代替continuation_
 };
 
 template<typename T>
@@ -258,6 +323,15 @@ class Lazy : noncopyable {
     return Lazy<T>(std::exchange(coro_, nullptr));
   }
 
+  /// 设置协程的stop_token，之后co_await的Lazy、Yield、sleep、Executor::Schedule和文件IO
+  /// 都会观察这个token，请求取消之后在下一个挂起点抛出OperationCancelled(文件IO返回-ECANCELED)
+  Lazy<T> SetStopToken(std::stop_token token) &&{
+    LOGIC_ASSERT(coro_.operator bool(),
+                 "Lazy do not have a coroutine");
+    coro_.promise().stop_token_ = std::move(token);
+    return Lazy<T>(std::exchange(coro_, nullptr));
+  }
+
   template<typename F>
   void Start(F &&callback) {
     auto launch_coro = [](Lazy lazy, std::decay_t<F> cb) -> DetachedCoroutine {
@@ -277,6 +351,12 @@ class Lazy : noncopyable {
     return ValueAwaiter(std::exchange(coro_, nullptr));
   }
 
+  auto CoAwait(Executor *executor, const std::stop_token &token) {
+    coro_.promise().executor_ = executor;
+    coro_.promise().InheritStopToken(token);
+    return ValueAwaiter(std::exchange(coro_, nullptr));
+  }
+
   auto CoAwaitTry() {
     return TryAwaiter(std::exchange(coro_, nullptr));
   }
@@ -290,9 +370,15 @@ class Lazy : noncopyable {
   template<typename LazyType, typename IAlloc, typename OAlloc, bool Para>
   friend struct detail::CollectAllAwaiter;
 
+  template<typename LazyType, typename IAlloc, typename OAlloc, bool Para>
+  friend struct detail::CollectAllWindowedAwaiter;
+
   template<typename LazyType, typename IAlloc>
   friend struct detail::CollectAnyAwaiter;
 
+  template<typename U>
+  friend class detail::TimeoutAwaitable;
+
   Handle coro_;
 };
 
@@ -362,6 +448,9 @@ class RescheduleLazy : noncopyable {
   template<typename LazyType, typename IAlloc, typename OAlloc, bool Para>
   friend struct detail::CollectAllAwaiter;
 
+  template<typename LazyType, typename IAlloc, typename OAlloc, bool Para>
+  friend struct detail::CollectAllWindowedAwaiter;
+
   template<typename LazyType, typename IAlloc>
   friend struct detail::CollectAnyAwaiter;
 
@@ -387,16 +476,22 @@ inline auto SyncAwait(LazyType &&lazy) -> typename std::decay_t<LazyType>::Value
                  "do not sync await in the same executor with Lazy");
   }
 
+  // 不经过DetachedCoroutine和回调，直接驱动lazy的协程，协程结束时FinalAwaiter唤醒当前线程，
+  // 结果从仍然挂起在final_suspend的协程帧中取出
   using ValueType = typename std::decay_t<LazyType>::ValueType;
-  Try<ValueType> value;
-  std::binary_semaphore sem(0);
-  std::move(std::forward<LazyType>(lazy))
-      .Start([&sem, &value](Try<ValueType> result) {
-        value = std::move(result);
-        sem.release();
-      });
-  sem.acquire();
-  return std::move(value).Value();
+  detail::SyncWaiter waiter;
+  detail::LazyAwaiterBase<ValueType> awaiter(std::exchange(lazy.coro_, nullptr));
+  auto handle = awaiter.handle;
+  handle.promise().sync_waiter_ = &waiter;
+  bool scheduled = false;
+  if constexpr (std::is_same_v<std::decay_t<LazyType>, RescheduleLazy<ValueType>>) {
+    scheduled = executor && executor->Schedule([handle]() mutable { handle.resume(); });
+  }
+  if (!scheduled) {
+    handle.resume();
+  }
+  waiter.Wait();
+  return awaiter.AwaitResume();
 }
 
 } // namespace async_simple::coro
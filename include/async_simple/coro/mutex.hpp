@@ -0,0 +1,147 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_MUTEX_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_MUTEX_HPP_
+
+#include "async_simple/base/assert.hpp"
+#include "async_simple/base/noncopyable.hpp"
+#include "async_simple/coro/waiter.hpp"
+
+#include <atomic>
+#include <utility>
+
+namespace async_simple::coro {
+
+class ConditionVariable;
+
+/// 持有锁，析构时调用Unlock
+template<typename MutexType>
+class ScopedLock : noncopyable {
+ public:
+  explicit ScopedLock(MutexType &mutex) noexcept : mutex_(&mutex) {}
+  ScopedLock(ScopedLock &&other) noexcept : mutex_(std::exchange(other.mutex_, nullptr)) {}
+  ~ScopedLock() { Unlock(); }
+
+  void Unlock() noexcept {
+    if (mutex_) {
+      std::exchange(mutex_, nullptr)->Unlock();
+    }
+  }
+
+ private:
+  MutexType *mutex_;
+};
+
+/// 协程互斥锁，等待锁时挂起协程而不是阻塞线程
+/// ```
+/// auto lock = co_await mutex.CoScopedLock();
+/// ```
+/// - 加锁和等待都是无锁的：state_为this表示未加锁，为nullptr表示加锁且没有等待者，
+///   否则是新加入的等待者组成的栈(后进先出)
+/// - Unlock时把栈反转到waiters_中，按先进先出的顺序把锁直接交给下一个等待者，
+///   等待者通过Checkin回到挂起前的context上继续执行
+class Mutex : noncopyable {
+ public:
+  class LockAwaiter;
+  class ScopedLockAwaiter;
+
+  template<typename Awaiter>
+  class Awaitable {
+   public:
+    explicit Awaitable(Mutex &mutex) : mutex_(mutex) {}
+    Awaiter CoAwait(Executor *executor) { return Awaiter(mutex_, executor); }
+
+   private:
+    Mutex &mutex_;
+  };
+
+  Mutex() noexcept : state_(NotLocked()) {}
+  ~Mutex() {
+    ASSERT(state_.load(std::memory_order_relaxed) == NotLocked() && waiters_ == nullptr);
+  }
+
+  bool TryLock() noexcept {
+    void *expected = NotLocked();
+    return state_.compare_exchange_strong(expected, nullptr, std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  /// co_await mutex.CoLock()，返回时持有锁，需要手动Unlock
+  Awaitable<LockAwaiter> CoLock() noexcept { return Awaitable<LockAwaiter>(*this); }
+
+  /// co_await mutex.CoScopedLock()，返回ScopedLock<Mutex>
+  Awaitable<ScopedLockAwaiter> CoScopedLock() noexcept { return Awaitable<ScopedLockAwaiter>(*this); }
+
+  void Unlock() noexcept {
+    ASSERT(state_.load(std::memory_order_relaxed) != NotLocked());
+    detail::Waiter *head = waiters_;
+    if (!head) {
+      void *expected = nullptr;
+      if (state_.compare_exchange_strong(expected, NotLocked(), std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+        return;
+      }
+      // 有新的等待者，全部取出并反转成先进先出的顺序
+      auto waiter = static_cast<detail::Waiter *>(state_.exchange(nullptr, std::memory_order_acquire));
+      ASSERT(waiter != nullptr);
+      do {
+        auto next = waiter->next;
+        waiter->next = head;
+        head = waiter;
+        waiter = next;
+      } while (waiter);
+    }
+    waiters_ = head->next;
+    head->Resume();
+  }
+
+ private:
+  friend class ConditionVariable;
+
+  void *NotLocked() noexcept { return this; }
+
+  /// 加锁成功返回false，否则把waiter加入等待栈并返回true
+  bool LockOrEnqueue(detail::Waiter *waiter) noexcept {
+    void *state = state_.load(std::memory_order_relaxed);
+    while (true) {
+      if (state == NotLocked()) {
+        if (state_.compare_exchange_weak(state, nullptr, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+          return false;
+        }
+      } else {
+        waiter->next = static_cast<detail::Waiter *>(state);
+        if (state_.compare_exchange_weak(state, waiter, std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+          return true;
+        }
+      }
+    }
+  }
+
+  std::atomic<void *> state_;
+  detail::Waiter *waiters_{nullptr};  ///< 先进先出的等待者，只有持有锁的协程访问
+};
+
+class Mutex::LockAwaiter : public detail::Waiter {
+ public:
+  LockAwaiter(Mutex &mutex, Executor *ex) : mutex_(mutex) { executor = ex; }
+
+  bool await_ready() noexcept { return mutex_.TryLock(); }
+  bool await_suspend(std::coroutine_handle<> continuation) noexcept {
+    Prepare(continuation);
+    return mutex_.LockOrEnqueue(this);
+  }
+  void await_resume() noexcept {}
+
+ protected:
+  Mutex &mutex_;
+};
+
+class Mutex::ScopedLockAwaiter : public LockAwaiter {
+ public:
+  using LockAwaiter::LockAwaiter;
+  [[nodiscard]] ScopedLock<Mutex> await_resume() noexcept { return ScopedLock<Mutex>(mutex_); }
+};
+
+} // namespace async_simple::coro
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_MUTEX_HPP_
@@ -0,0 +1,114 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_SEMAPHORE_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_SEMAPHORE_HPP_
+
+#include "async_simple/base/assert.hpp"
+#include "async_simple/base/noncopyable.hpp"
+#include "async_simple/coro/waiter.hpp"
+#include "async_simple/util/spin_lock.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+
+namespace async_simple::coro {
+
+/// 协程计数信号量，没有可用的许可时挂起协程
+/// - TryAcquire只有一次CAS，不需要加锁
+/// - 等待队列由自旋锁保护，Release时把许可直接交给等待者，而不是先加到计数上再让它们去抢
+template<std::ptrdiff_t LeastMaxValue = std::numeric_limits<std::ptrdiff_t>::max()>
+class CountingSemaphore : noncopyable {
+ public:
+  class AcquireAwaiter : public detail::Waiter {
+   public:
+    AcquireAwaiter(CountingSemaphore &semaphore, Executor *ex) : semaphore_(semaphore) { executor = ex; }
+
+    bool await_ready() noexcept { return semaphore_.TryAcquire(); }
+    bool await_suspend(std::coroutine_handle<> continuation) noexcept {
+      Prepare(continuation);
+      return semaphore_.AcquireOrEnqueue(this);
+    }
+    void await_resume() noexcept {}
+
+   private:
+    CountingSemaphore &semaphore_;
+  };
+
+  class AcquireAwaitable {
+   public:
+    explicit AcquireAwaitable(CountingSemaphore &semaphore) : semaphore_(semaphore) {}
+    AcquireAwaiter CoAwait(Executor *executor) { return {semaphore_, executor}; }
+
+   private:
+    CountingSemaphore &semaphore_;
+  };
+
+  static constexpr std::ptrdiff_t max() noexcept { return LeastMaxValue; }
+
+  explicit CountingSemaphore(std::ptrdiff_t desired) : count_(desired) {
+    ASSERT(desired >= 0 && desired <= max());
+  }
+
+  bool TryAcquire() noexcept {
+    auto count = count_.load(std::memory_order_relaxed);
+    while (count > 0) {
+      if (count_.compare_exchange_weak(count, count - 1, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// co_await semaphore.CoAcquire()
+  AcquireAwaitable CoAcquire() noexcept { return AcquireAwaitable(*this); }
+
+  void Release(std::ptrdiff_t update = 1) noexcept {
+    ASSERT(update >= 0);
+    detail::Waiter *wake = nullptr;
+    detail::Waiter **tail = &wake;
+    {
+      std::lock_guard lg(lock_);
+      while (update > 0) {
+        auto waiter = waiters_.Pop();
+        if (!waiter) {
+          break;
+        }
+        *tail = waiter;
+        tail = &waiter->next;
+        --update;
+      }
+      *tail = nullptr;
+      if (update > 0) {
+        count_.fetch_add(update, std::memory_order_release);
+      }
+    }
+    while (wake) {
+      auto next = wake->next;
+      wake->Resume();
+      wake = next;
+    }
+  }
+
+ private:
+  /// 拿到许可返回false，否则加入等待队列并返回true
+  bool AcquireOrEnqueue(detail::Waiter *waiter) noexcept {
+    std::lock_guard lg(lock_);
+    // Release在锁内增加计数，这里在锁内再检查一次就不会错过唤醒
+    if (TryAcquire()) {
+      return false;
+    }
+    waiters_.Push(waiter);
+    return true;
+  }
+
+  std::atomic<std::ptrdiff_t> count_;
+  util::SpinLock lock_;
+  detail::WaiterQueue waiters_;
+};
+
+using BinarySemaphore = CountingSemaphore<1>;
+
+} // namespace async_simple::coro
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_SEMAPHORE_HPP_
@@ -0,0 +1,183 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_SHARED_MUTEX_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_SHARED_MUTEX_HPP_
+
+#include "async_simple/base/assert.hpp"
+#include "async_simple/base/noncopyable.hpp"
+#include "async_simple/coro/mutex.hpp"
+#include "async_simple/coro/waiter.hpp"
+#include "async_simple/util/spin_lock.hpp"
+
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+namespace async_simple::coro {
+
+/// 持有共享锁，析构时调用UnlockShared
+template<typename MutexType>
+class SharedLock : noncopyable {
+ public:
+  explicit SharedLock(MutexType &mutex) noexcept : mutex_(&mutex) {}
+  SharedLock(SharedLock &&other) noexcept : mutex_(std::exchange(other.mutex_, nullptr)) {}
+  ~SharedLock() { Unlock(); }
+
+  void Unlock() noexcept {
+    if (mutex_) {
+      std::exchange(mutex_, nullptr)->UnlockShared();
+    }
+  }
+
+ private:
+  MutexType *mutex_;
+};
+
+/// 协程读写锁，写者优先：有写者在等待时新的读者也会等待，避免写者饿死
+/// - 状态和等待队列由自旋锁保护，临界区只有几次指针操作，不会在持有自旋锁时恢复协程
+/// - 释放时直接把锁交给等待者：写者释放后优先交给下一个写者，没有写者时一次唤醒所有读者
+class SharedMutex : noncopyable {
+ public:
+  template<bool Exclusive, bool Scoped>
+  class LockAwaiter;
+
+  template<bool Exclusive, bool Scoped>
+  class Awaitable {
+   public:
+    explicit Awaitable(SharedMutex &mutex) : mutex_(mutex) {}
+    LockAwaiter<Exclusive, Scoped> CoAwait(Executor *executor) { return {mutex_, executor}; }
+
+   private:
+    SharedMutex &mutex_;
+  };
+
+  ~SharedMutex() { ASSERT(!writer_ && readers_ == 0); }
+
+  bool TryLock() noexcept {
+    std::lock_guard lg(lock_);
+    return TryLockLocked();
+  }
+  bool TryLockShared() noexcept {
+    std::lock_guard lg(lock_);
+    return TryLockSharedLocked();
+  }
+
+  Awaitable<true, false> CoLock() noexcept { return Awaitable<true, false>(*this); }
+  Awaitable<true, true> CoScopedLock() noexcept { return Awaitable<true, true>(*this); }
+  Awaitable<false, false> CoLockShared() noexcept { return Awaitable<false, false>(*this); }
+  Awaitable<false, true> CoScopedLockShared() noexcept { return Awaitable<false, true>(*this); }
+
+  void Unlock() noexcept {
+    detail::Waiter *wake;
+    {
+      std::lock_guard lg(lock_);
+      ASSERT(writer_ && readers_ == 0);
+      writer_ = false;
+      wake = HandOffLocked();
+    }
+    ResumeAll(wake);
+  }
+
+  void UnlockShared() noexcept {
+    detail::Waiter *wake = nullptr;
+    {
+      std::lock_guard lg(lock_);
+      ASSERT(!writer_ && readers_ > 0);
+      if (--readers_ == 0) {
+        wake = HandOffLocked();
+      }
+    }
+    ResumeAll(wake);
+  }
+
+ private:
+  bool TryLockLocked() noexcept {
+    if (writer_ || readers_ > 0) {
+      return false;
+    }
+    writer_ = true;
+    return true;
+  }
+  bool TryLockSharedLocked() noexcept {
+    if (writer_ || !writers_.Empty()) {
+      return false;
+    }
+    ++readers_;
+    return true;
+  }
+
+  /// 加锁成功返回false，否则加入等待队列并返回true
+  template<bool Exclusive>
+  bool LockOrEnqueue(detail::Waiter *waiter) noexcept {
+    std::lock_guard lg(lock_);
+    if constexpr (Exclusive) {
+      if (TryLockLocked()) {
+        return false;
+      }
+      writers_.Push(waiter);
+    } else {
+      if (TryLockSharedLocked()) {
+        return false;
+      }
+      readers_waiting_.Push(waiter);
+    }
+    return true;
+  }
+
+  /// 锁空闲时选出接下来持有锁的等待者，返回它们组成的链表
+  detail::Waiter *HandOffLocked() noexcept {
+    if (auto writer = writers_.Pop()) {
+      writer_ = true;
+      writer->next = nullptr;
+      return writer;
+    }
+    auto readers = readers_waiting_.PopAll();
+    for (auto reader = readers; reader; reader = reader->next) {
+      ++readers_;
+    }
+    return readers;
+  }
+
+  static void ResumeAll(detail::Waiter *waiter) noexcept {
+    while (waiter) {
+      // 恢复之后waiter可能已经被销毁
+      auto next = waiter->next;
+      waiter->Resume();
+      waiter = next;
+    }
+  }
+
+  util::SpinLock lock_;
+  bool writer_{false};
+  std::size_t readers_{0};
+  detail::WaiterQueue writers_;
+  detail::WaiterQueue readers_waiting_;
+};
+
+template<bool Exclusive, bool Scoped>
+class SharedMutex::LockAwaiter : public detail::Waiter {
+ public:
+  LockAwaiter(SharedMutex &mutex, Executor *ex) : mutex_(mutex) { executor = ex; }
+
+  bool await_ready() noexcept {
+    return Exclusive ? mutex_.TryLock() : mutex_.TryLockShared();
+  }
+  bool await_suspend(std::coroutine_handle<> continuation) noexcept {
+    Prepare(continuation);
+    return mutex_.LockOrEnqueue<Exclusive>(this);
+  }
+  auto await_resume() noexcept {
+    if constexpr (!Scoped) {
+      return;
+    } else if constexpr (Exclusive) {
+      return ScopedLock<SharedMutex>(mutex_);
+    } else {
+      return SharedLock<SharedMutex>(mutex_);
+    }
+  }
+
+ private:
+  SharedMutex &mutex_;
+};
+
+} // namespace async_simple::coro
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_SHARED_MUTEX_HPP_
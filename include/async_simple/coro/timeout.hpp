@@ -0,0 +1,179 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_TIMEOUT_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_TIMEOUT_HPP_
+
+#include "async_simple/base/cancellation.hpp"
+#include "async_simple/coro/lazy.hpp"
+#include "async_simple/coro/sleep.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+namespace async_simple::coro {
+
+namespace detail {
+
+/// 带超时地等待一个Lazy，不会创建额外的协程帧
+/// - Executor提供TimerService时，在等待期间往里面挂一个定时器，子任务完成后O(1)地取消
+/// - 否则通过一个可以取消的sleep实现，子任务完成后请求取消这个sleep
+/// - 超时后通过stop_token请求取消子任务，并等它在下一个挂起点结束，因此返回时子任务一定已经结束
+/// - 没有Executor时不设置超时
+template<typename T>
+class TimeoutAwaiter : noncopyable {
+  using Handle = typename Lazy<T>::Handle;
+
+  struct RequestStop {
+    void operator()() { source.request_stop(); }
+    std::stop_source source;
+  };
+
+  /// 没有TimerService时使用的定时器状态，由sleep协程和Awaiter共同持有
+  struct FallbackTimer {
+    std::atomic<bool> done{false};  ///< 超时和子任务完成谁先设置谁生效
+    std::stop_source child;
+    std::stop_source timer;
+  };
+
+ public:
+  TimeoutAwaiter(Executor *executor, Handle child, Executor::Duration duration,
+                 std::stop_token parent)
+      : executor_(executor), child_(child), duration_(duration), parent_(std::move(parent)) {}
+  ~TimeoutAwaiter() {
+    if (child_) {
+      child_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) {
+    auto &promise = child_.promise();
+    if (!promise.executor_) {
+      promise.executor_ = executor_;
+    }
+    // 子任务自己的stop_token优先，否则使用父协程的，它们的取消请求会转发给子任务
+    const auto &upstream = promise.stop_token_.stop_possible() ? promise.stop_token_ : parent_;
+    if (upstream.stop_possible()) {
+      link_.emplace(upstream, RequestStop{source_});
+    }
+    promise.stop_token_ = source_.get_token();
+    promise.continuation_ = continuation;
+    Arm();
+    return child_;
+  }
+
+  Try<T> await_resume() {
+    bool timed_out = Disarm();
+    link_.reset();
+    Try<T> result = child_.promise().TryResult();
+    child_.destroy();
+    child_ = nullptr;
+    if (timed_out && result.HasException()) {
+      return Try<T>(std::make_exception_ptr(TimeoutError()));
+    }
+    return result;
+  }
+
+ private:
+  void Arm() {
+    if (!executor_) {
+      return;
+    }
+    timer_ = executor_->GetTimerService();
+    if (timer_) LIKELY {
+      entry_.callback = [this]() {
+        // fired_被设置之后Awaiter随时可能被销毁，之后只能访问局部变量
+        auto source = source_;
+        fired_.store(true, std::memory_order_release);
+        source.request_stop();
+      };
+      timer_->Add(&entry_, duration_);
+      return;
+    }
+    fallback_ = std::make_shared<FallbackTimer>();
+    fallback_->child = source_;
+    [](std::shared_ptr<FallbackTimer> state, Executor::Duration duration) -> Lazy<void> {
+      co_await sleep(duration);
+      if (!state->done.exchange(true, std::memory_order_acq_rel)) {
+        state->child.request_stop();
+      }
+    }(fallback_, duration_)
+        .SetStopToken(fallback_->timer.get_token())
+        .Via(executor_)
+        .Start([](Try<void> &&) {});
+  }
+
+  /// @return 返回true表示已经超时
+  bool Disarm() {
+    if (timer_) {
+      if (timer_->Cancel(&entry_)) LIKELY {
+        return false;
+      }
+      // 回调已经从时间轮中取出，等它不再访问this
+      while (!fired_.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      return true;
+    }
+    if (fallback_) {
+      if (fallback_->done.exchange(true, std::memory_order_acq_rel)) {
+        return true;
+      }
+      fallback_->timer.request_stop();
+    }
+    return false;
+  }
+
+  Executor *executor_;
+  Handle child_;
+  Executor::Duration duration_;
+  std::stop_token parent_;
+  std::stop_source source_;
+  std::optional<std::stop_callback<RequestStop>> link_;
+  util::TimerService *timer_{nullptr};
+  util::TimerService::Entry entry_;
+  std::atomic<bool> fired_{false};
+  std::shared_ptr<FallbackTimer> fallback_;
+};
+
+template<typename T>
+class TimeoutAwaitable {
+ public:
+  TimeoutAwaitable(Lazy<T> &&lazy, Executor::Duration duration)
+      : lazy_(std::move(lazy)), duration_(duration) {}
+
+  auto CoAwait(Executor *executor) { return CoAwait(executor, {}); }
+  auto CoAwait(Executor *executor, std::stop_token token) {
+    LOGIC_ASSERT(lazy_.coro_.operator bool(), "Lazy do not have a coroutine");
+    return TimeoutAwaiter<T>(executor, std::exchange(lazy_.coro_, nullptr), duration_, std::move(token));
+  }
+
+ private:
+  Lazy<T> lazy_;
+  Executor::Duration duration_;
+};
+
+} // namespace async_simple::coro::detail
+
+/// 等待lazy完成，超过duration之后请求取消lazy，并返回带有TimeoutError的Try
+/// ```
+/// Try<int> r = co_await coro::WithTimeout(Fetch(), 50ms);
+/// ```
+/// lazy需要在挂起点观察stop_token(sleep、Yield、Executor::Schedule等)，否则会一直执行到结束
+template<typename T, typename Rep, typename Period>
+inline detail::TimeoutAwaitable<T> WithTimeout(Lazy<T> lazy, std::chrono::duration<Rep, Period> duration) {
+  return {std::move(lazy), std::chrono::duration_cast<Executor::Duration>(duration)};
+}
+
+/// 和WithTimeout相同，期限用时间点表示
+template<typename T, typename Clock, typename Dur>
+inline detail::TimeoutAwaitable<T> WithDeadline(Lazy<T> lazy, std::chrono::time_point<Clock, Dur> deadline) {
+  return WithTimeout(std::move(lazy), deadline - Clock::now());
+}
+
+} // namespace async_simple::coro
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_TIMEOUT_HPP_
@@ -0,0 +1,87 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_WAITER_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_WAITER_HPP_
+
+#include "async_simple/executor/executor.hpp"
+
+#include <coroutine>
+
+namespace async_simple::coro::detail {
+
+/// 挂起在同步原语上的协程，作为侵入式链表的节点保存在Awaiter中
+/// 唤醒时通过Checkin回到挂起前的context，不会在唤醒者的栈上嵌套执行，唤醒者就在这个context上时
+/// 会在它当前的任务结束后优先执行；没有Executor时直接恢复
+struct Waiter {
+  void Resume() {
+    auto h = handle;
+    if (executor) {
+      static constexpr ScheduleOptions kWakeup{.prompt = false, .next = true};
+      if (executor->Checkin([h]() mutable { h.resume(); }, context, kWakeup)) LIKELY {
+        return;
+      }
+    }
+    h.resume();
+  }
+
+  /// 挂起之前调用，记录恢复时需要的信息
+  void Prepare(std::coroutine_handle<> h) {
+    handle = h;
+    if (executor) {
+      context = executor->Checkout();
+    }
+  }
+
+  std::coroutine_handle<> handle;
+  Executor *executor{nullptr};
+  Executor::Context context{Executor::kNullContext};
+  Waiter *next{nullptr};
+};
+
+/// 先进先出的Waiter队列，需要外部同步
+class WaiterQueue {
+ public:
+  [[nodiscard]] bool Empty() const noexcept { return head_ == nullptr; }
+
+  void Push(Waiter *waiter) noexcept {
+    waiter->next = nullptr;
+    if (tail_) {
+      tail_->next = waiter;
+    } else {
+      head_ = waiter;
+    }
+    tail_ = waiter;
+  }
+
+  /// 把刚Pop出来的Waiter放回队首
+  void PushFront(Waiter *waiter) noexcept {
+    waiter->next = head_;
+    head_ = waiter;
+    if (!tail_) {
+      tail_ = waiter;
+    }
+  }
+
+  Waiter *Pop() noexcept {
+    auto waiter = head_;
+    if (waiter) {
+      head_ = waiter->next;
+      if (!head_) {
+        tail_ = nullptr;
+      }
+    }
+    return waiter;
+  }
+
+  /// 取出所有的Waiter，返回链表头
+  Waiter *PopAll() noexcept {
+    tail_ = nullptr;
+    return std::exchange(head_, nullptr);
+  }
+
+ private:
+  Waiter *head_{nullptr};
+  Waiter *tail_{nullptr};
+};
+
+} // namespace async_simple::coro::detail
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_CORO_WAITER_HPP_
@@ -1,23 +1,74 @@
 #ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_EXECUTOR_EXECUTOR_HPP_
 #define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_EXECUTOR_EXECUTOR_HPP_
 
+#include "async_simple/base/cancellation.hpp"
+#include "async_simple/base/macro.hpp"
 #include "async_simple/executor/io_executor.hpp"
+#include "async_simple/util/latency_histogram.hpp"
+#include "async_simple/util/timer_service.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <semaphore>
+#include <stop_token>
 #include <thread>
+#include <vector>
 
 namespace async_simple {
 
+/// 单个工作线程的调度统计，除pending_task_count和parked之外都是累计值，两次快照相减得到这段时间内的值
+struct WorkerStat {
+  size_t pending_task_count{0};         ///< 只能由这个线程执行或者窃取的等待中的任务数
+  bool parked{false};                   ///< 快照时是否在空闲休眠
+  uint64_t executed_task_count{0};
+  uint64_t steal_count{0};              ///< 从其他线程窃取成功的次数
+  uint64_t failed_steal_count{0};       ///< 没有窃取到任务的次数
+  uint64_t park_count{0};               ///< 空闲休眠的次数
+  std::chrono::nanoseconds parked_time{0};      ///< 已经结束的休眠的总时间
+  uint64_t queue_wait_samples{0};       ///< 采样统计了排队延迟的任务数
+  std::chrono::nanoseconds queue_wait_time{0};  ///< 采样任务从提交到开始执行的总时间
+  std::chrono::nanoseconds max_queue_wait_time{0};
+  uint64_t lifo_task_count{0};          ///< 通过ScheduleOptions::next在当前线程上优先执行的任务数
+};
+
 /// Executor的状态信息
 struct ExecutorStat {
-  size_t pending_task_count{0};
+  size_t pending_task_count{0};  ///< 所有等待中的任务，包括还没有分配到工作线程的
+  std::vector<WorkerStat> workers;
+};
+
+/// 一个延迟分布的分位数
+struct LatencyPercentiles {
+  LatencyPercentiles() = default;
+  explicit LatencyPercentiles(const util::LatencyHistogram::Snapshot &snapshot)
+      : count(snapshot.Count()),
+        p50(snapshot.Percentile(0.5)),
+        p99(snapshot.Percentile(0.99)),
+        p999(snapshot.Percentile(0.999)),
+        max(snapshot.Max()) {}
+
+  uint64_t count{0};  ///< 样本数
+  std::chrono::nanoseconds p50{0};
+  std::chrono::nanoseconds p99{0};
+  std::chrono::nanoseconds p999{0};
+  std::chrono::nanoseconds max{0};
+};
+
+/// Executor的延迟分布，只统计被采样的任务，都是从Executor创建开始的累计值
+struct ExecutorLatencyStat {
+  LatencyPercentiles queue_wait;          ///< 任务从提交到开始执行
+  LatencyPercentiles run_time;            ///< 任务执行的时间
+  LatencyPercentiles continuation_delay;  ///< Future的continuation从调度到开始执行
 };
 
 /// 一次调度的配置选项
 struct ScheduleOptions {
   bool prompt{true};  ///< 是否应该立即调度
+  bool next{false};   ///< 唤醒等待者这类很快就能执行的任务，当前线程就是目标线程时在当前任务结束后优先执行
 };
 
 /// 获取当前Executor的Awaitable类型
@@ -35,7 +86,7 @@ class Executor : noncopyable {
   static constexpr Context kNullContext = nullptr;
 
   using Duration = std::chrono::microseconds;
-  using Func = std::function<void()>;
+  using Func = Task;
 
   class Awaitable;
   class Awaiter;
@@ -49,6 +100,11 @@ class Executor : noncopyable {
   /// @return 当返回false时，表明func不会被调用；当返回true时，调度器需要确保函数会被执行
   virtual bool Schedule(Func func) = 0;
 
+  /// 带选项的调度，默认忽略选项
+  virtual bool Schedule(Func func, ScheduleOptions /*options*/) {
+    return Schedule(std::move(func));
+  }
+
   /// 当前线程是否绑定到了这个Executor
   virtual bool CurrentThreadInExecutor() const {
     throw std::logic_error("Not implemented");
@@ -58,13 +114,22 @@ class Executor : noncopyable {
     throw std::logic_error("Not implemented");
   }
 
+  /// 任务延迟的分布，定义了ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM时为空
+  virtual ExecutorLatencyStat LatencyStat() const {
+    throw std::logic_error("Not implemented");
+  }
+
+  /// 调度到这个Executor上的Future continuation开始执行时调用(只有被采样的continuation)，
+  /// delay是从调度到开始执行经过的时间
+  virtual void RecordContinuationDelay(std::chrono::nanoseconds /*delay*/) {}
+
   virtual size_t CurrentContextId() const { return 0; }
 
   /// 返回当前Context
   virtual Context Checkout() { return kNullContext; }
 
   /// 将函数调度都和之前一样的Context上
-  virtual bool Checkin(Func func, Context context, ScheduleOptions options) {
+  virtual bool Checkin(Func func, Context /*context*/, ScheduleOptions /*options*/) {
     return Schedule(std::move(func));
   }
   /// 将函数调度都和之前一样的Context上
@@ -86,6 +151,10 @@ class Executor : noncopyable {
     throw std::logic_error("Not implemented");
   }
 
+  /// 获取可以取消的定时器，不提供的话返回nullptr
+  /// WithTimeout优先使用它来设置和取消超时，否则退回到ScheduleAfter
+  virtual util::TimerService *GetTimerService() { return nullptr; }
+
   /// 阻塞当前线程，直到函数被调度
   /// @return 返回false表明调度失败，反之调度成功
   bool SyncSchedule(Func func) {
@@ -102,20 +171,22 @@ class Executor : noncopyable {
  private:
   /// 将一个虚函数声明为private的原因可参考：https://isocpp.org/wiki/faq/strange-inheritance#private-virtuals
   virtual void Schedule(Func func, Duration duration) {
-    std::thread([this, f = std::move(func), duration] {
+    std::thread([this, f = std::move(func), duration]() mutable {
       std::this_thread::sleep_for(duration);
-      Schedule(f);
+      Schedule(std::move(f));
     }).detach();
   }
 };
 
 /// 实现Executor::Schedule的Awaiter
+/// 已经请求取消时不再调度，在await_resume中抛出OperationCancelled
 class Executor::Awaiter {
  public:
-  Awaiter(Executor *executor) : executor_(executor) {}
+  Awaiter(Executor *executor, std::stop_token token = {})
+      : executor_(executor), token_(std::move(token)) {}
 
   bool await_ready() const noexcept {
-    return executor_->CurrentThreadInExecutor();
+    return token_.stop_requested() || executor_->CurrentThreadInExecutor();
   }
 
   template<typename PromiseType>
@@ -125,9 +196,14 @@ class Executor::Awaiter {
     });
   }
 
-  void await_resume() const noexcept {}
+  void await_resume() const {
+    if (token_.stop_requested()) {
+      throw OperationCancelled();
+    }
+  }
  private:
   Executor *executor_;
+  std::stop_token token_;
 };
 
 class Executor::Awaitable {
@@ -135,6 +211,7 @@ class Executor::Awaitable {
   Awaitable(Executor *executor) : executor_(executor) {}
 
   auto CoAwait(Executor *) { return Awaiter(executor_); }
+  auto CoAwait(Executor *, std::stop_token token) { return Awaiter(executor_, std::move(token)); }
  private:
   Executor *executor_;
 };
@@ -143,25 +220,105 @@ inline Executor::Awaitable Executor::Schedule() {
   return {this};
 }
 
+/// 带有可以取消的stop_token时，定时器和取消请求谁先到达谁负责恢复协程
+/// 被取消时协程会提前恢复，并在await_resume中抛出OperationCancelled
+/// Executor提供TimerService时定时器放在共享状态中，取消时O(1)地从时间轮中移除，否则退回到Schedule(func, duration)
 class Executor::TimeAwaiter {
  public:
-  TimeAwaiter(Executor *executor, Executor::Duration duration)
-      : executor_(executor), duration_(duration) {}
+  TimeAwaiter(Executor *executor, Executor::Duration duration, std::stop_token token = {})
+      : executor_(executor), duration_(duration), token_(std::move(token)) {}
 
-  constexpr bool await_ready() const noexcept { return false; }
+  bool await_ready() const noexcept { return token_.stop_requested(); }
 
   template<typename PromiseType>
   void await_suspend(std::coroutine_handle<PromiseType> continuation) {
-    executor_->Schedule([continuation]() mutable {
-      continuation.resume();
-    }, duration_);
+    if (!token_.stop_possible()) {
+      executor_->Schedule([continuation]() mutable {
+        continuation.resume();
+      }, duration_);
+      return;
+    }
+    // 先注册取消回调再启动定时器，任何一方恢复协程之后都不能再访问this
+    auto state = std::make_shared<State>(continuation, executor_->GetTimerService());
+    auto executor = executor_;
+    auto duration = duration_;
+    state_ = state;
+    on_stop_.emplace(token_, OnStop{state, executor});
+    if (state->Arrive()) {
+      // 注册时已经被取消，取消回调在emplace中执行过了
+      Resume(executor, state);
+      return;
+    }
+    if (state->timer) LIKELY {
+      state->armed = state;
+      state->entry.callback = [s = state.get(), executor]() {
+        // 回调执行之后TimerService不再访问entry，这里可以释放最后一个引用
+        auto self = std::move(s->armed);
+        if (!self->done.exchange(true, std::memory_order_acq_rel)) {
+          Resume(executor, self);
+        }
+      };
+      state->timer->Add(&state->entry, duration);
+      return;
+    }
+    executor->Schedule([state]() {
+      if (!state->done.exchange(true, std::memory_order_acq_rel)) {
+        state->continuation.resume();
+      }
+    }, duration);
   }
 
-  void await_resume() const noexcept {}
+  void await_resume() {
+    on_stop_.reset();
+    if (state_ ? state_->cancelled : token_.stop_requested()) {
+      throw OperationCancelled();
+    }
+  }
 
  private:
+  struct State {
+    State(std::coroutine_handle<> h, util::TimerService *t) : continuation(h), timer(t) {}
+    /// 取消时恢复协程需要取消回调执行完和注册完成两个条件，后到的一方负责恢复
+    bool Arrive() { return pending.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+    std::coroutine_handle<> continuation;
+    std::atomic<bool> done{false};
+    std::atomic<int> pending{2};
+    bool cancelled{false};
+    util::TimerService *const timer;
+    util::TimerService::Entry entry;
+    /// entry在时间轮中时由定时器持有的引用，回调执行或者Cancel成功的一方释放
+    std::shared_ptr<State> armed;
+  };
+  struct OnStop {
+    void operator()() const {
+      if (!state->done.exchange(true, std::memory_order_acq_rel)) {
+        state->cancelled = true;
+        // 定时器还没有启动或者回调正在执行时Cancel失败，由回调释放armed
+        if (state->timer && state->timer->Cancel(&state->entry)) {
+          state->armed.reset();
+        }
+        if (state->Arrive()) {
+          Resume(executor, state);
+        }
+      }
+    }
+    std::shared_ptr<State> state;
+    Executor *executor;
+  };
+
+  static void Resume(Executor *executor, const std::shared_ptr<State> &state) {
+    auto h = state->continuation;
+    if (!executor->Schedule([h]() mutable { h.resume(); })) {
+      h.resume();
+    }
+  }
+
   Executor *executor_;
   Executor::Duration duration_;
+  std::stop_token token_;
+  std::shared_ptr<State> state_;
+  std::optional<std::stop_callback<OnStop>> on_stop_;
 };
 
 class Executor::TimeAwaitable {
@@ -170,6 +327,9 @@ class Executor::TimeAwaitable {
       : executor_(executor), duration_(duration) {}
 
   auto CoAwait(Executor *) { return TimeAwaiter(executor_, duration_); }
+  auto CoAwait(Executor *, std::stop_token token) {
+    return TimeAwaiter(executor_, duration_, std::move(token));
+  }
  private:
   Executor *executor_;
   Executor::Duration duration_;
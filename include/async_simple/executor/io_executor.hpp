@@ -2,10 +2,10 @@
 #define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_EXECUTOR_IO_EXECUTOR_HPP_
 
 #include "async_simple/base/noncopyable.hpp"
+#include "async_simple/base/task.hpp"
 
 #include <cstdint>
 #include <cstdlib>
-#include <functional>
 
 namespace async_simple {
 
@@ -39,13 +39,13 @@ struct iovec_t {
   size_t iov_len;
 };
 
-using AIOCallback = std::function<void(io_event_t &)>;
+using AIOCallback = BasicTask<void(io_event_t &)>;
 
 /// IOExecutor会接收IO读写请求
 /// 用户应该将实现后的IOExecutor和实现后的Executor放在一起使用
 class IOExecutor : noncopyable {
  public:
-  using Func = std::function<void()>;
+  using Func = Task;
 
   IOExecutor() = default;
   virtual ~IOExecutor() = default;
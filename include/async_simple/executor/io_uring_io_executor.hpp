@@ -0,0 +1,430 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_EXECUTOR_IO_URING_IO_EXECUTOR_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_EXECUTOR_IO_URING_IO_EXECUTOR_HPP_
+
+#include "async_simple/executor/io_executor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace async_simple::executors {
+
+#ifdef HAS_IO_URING
+/// 基于io_uring的IOExecutor，直接使用系统调用和内核头文件，不依赖liburing
+/// - 提交: 多个线程同时提交时，只有一个线程进入内核，一次io_uring_enter提交所有积压的SQE；
+///   在回调中提交的SQE会攒起来，和等待完成合并成一次io_uring_enter
+/// - 完成: 完成线程直接从共享内存中的CQ环上取CQE，只有CQ为空时才调用io_uring_enter等待
+/// - 可选开启SQPOLL，由内核线程轮询SQ，提交时不需要系统调用
+/// - 可选注册文件和缓冲区，命中时自动使用IOSQE_FIXED_FILE和READ_FIXED/WRITE_FIXED
+/// 回调在完成线程中执行，SubmitIOV的iovec需要在回调执行之前一直有效
+class IoUringIOExecutor : public IOExecutor {
+ public:
+  struct Options {
+    unsigned entries{256};          ///< SQ的深度，CQ的深度是它的两倍
+    bool sqpoll{false};             ///< 使用内核线程轮询SQ
+    unsigned sqpoll_idle_ms{100};   ///< SQPOLL线程空闲多久之后休眠
+    std::vector<int> files;         ///< 需要注册的文件
+    std::vector<iovec_t> buffers;   ///< 需要注册的缓冲区
+  };
+
+  IoUringIOExecutor() = default;
+  ~IoUringIOExecutor() override { Destroy(); }
+
+  bool Init() { return Init(Options{}); }
+  bool Init(const Options &options) {
+    if (ring_fd_ >= 0) return false;
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if (options.sqpoll) {
+      params.flags |= IORING_SETUP_SQPOLL;
+      params.sq_thread_idle = options.sqpoll_idle_ms;
+    }
+    auto fd = static_cast<int>(syscall(__NR_io_uring_setup, options.entries, &params));
+    if (fd < 0) return false;
+    ring_fd_ = fd;
+    sqpoll_ = options.sqpoll;
+    if (!MapRings(params) || !RegisterFiles(options.files) || !RegisterBuffers(options.buffers)) {
+      Release();
+      return false;
+    }
+    loop_thread_ = std::thread([this]() {
+      this->Loop();
+    });
+    return true;
+  }
+
+  /// 等待所有已经提交的IO完成后退出
+  void Destroy() {
+    if (ring_fd_ < 0) return;
+    if (loop_thread_.joinable()) {
+      stop_.store(true, std::memory_order_release);
+      // 提交一个NOP来唤醒完成线程
+      Enqueue([](io_uring_sqe *sqe) {
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = 0;
+      });
+      loop_thread_.join();
+    }
+    Release();
+  }
+
+  void SubmitIO(int fd, iocb_cmd cmd, void *buffer, size_t len, off_t offset, AIOCallback cb) override {
+    uint8_t opcode;
+    switch (cmd) {
+      case IOCB_CMD_PREAD: opcode = IORING_OP_READ;
+        break;
+      case IOCB_CMD_PWRITE: opcode = IORING_OP_WRITE;
+        break;
+      case IOCB_CMD_FSYNC:
+      case IOCB_CMD_FDSYNC: opcode = IORING_OP_FSYNC;
+        break;
+      case IOCB_CMD_NOOP: opcode = IORING_OP_NOP;
+        break;
+      default: Fail(cb, -EINVAL);
+        return;
+    }
+    int buf_index = -1;
+    if (opcode == IORING_OP_READ || opcode == IORING_OP_WRITE) {
+      buf_index = FindBuffer(buffer, len);
+    }
+    if (buf_index >= 0) {
+      opcode = opcode == IORING_OP_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+    }
+    Submit(std::move(cb), [&](io_uring_sqe *sqe) {
+      sqe->opcode = opcode;
+      sqe->addr = reinterpret_cast<uint64_t>(buffer);
+      sqe->len = static_cast<uint32_t>(len);
+      sqe->off = static_cast<uint64_t>(offset);
+      if (buf_index >= 0) {
+        sqe->buf_index = static_cast<uint16_t>(buf_index);
+      }
+      if (cmd == IOCB_CMD_FDSYNC) {
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+      }
+      SetFile(sqe, fd);
+    });
+  }
+
+  void SubmitIOV(int fd, iocb_cmd cmd, const iovec_t *iov, size_t count, off_t offset, AIOCallback cb) override {
+    uint8_t opcode;
+    switch (cmd) {
+      case IOCB_CMD_PREAD:
+      case IOCB_CMD_PREADV: opcode = IORING_OP_READV;
+        break;
+      case IOCB_CMD_PWRITE:
+      case IOCB_CMD_PWRITEV: opcode = IORING_OP_WRITEV;
+        break;
+      default: Fail(cb, -EINVAL);
+        return;
+    }
+    Submit(std::move(cb), [&](io_uring_sqe *sqe) {
+      sqe->opcode = opcode;
+      sqe->addr = reinterpret_cast<uint64_t>(iov);
+      sqe->len = static_cast<uint32_t>(count);
+      sqe->off = static_cast<uint64_t>(offset);
+      SetFile(sqe, fd);
+    });
+  }
+
+ private:
+  struct Request {
+    AIOCallback callback;
+  };
+
+  template<typename T>
+  static std::atomic_ref<T> Ref(T *p) { return std::atomic_ref<T>(*p); }
+
+  static void Fail(AIOCallback &cb, int err) {
+    io_event_t event{nullptr, nullptr, static_cast<uint64_t>(static_cast<int64_t>(err)), 0};
+    cb(event);
+  }
+
+  int Enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    auto r = syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0);
+    return r < 0 ? -errno : static_cast<int>(r);
+  }
+
+  bool MapRings(const io_uring_params &params) {
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+      sq_ring_ = nullptr;
+      return false;
+    }
+    if (single_mmap) {
+      cq_ring_ = sq_ring_;
+    } else {
+      cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+      if (cq_ring_ == MAP_FAILED) {
+        cq_ring_ = nullptr;
+        return false;
+      }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    auto sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      return false;
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    auto sq = static_cast<char *>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_flags_ = reinterpret_cast<unsigned *>(sq + params.sq_off.flags);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    // SQ的索引数组固定为恒等映射，SQE的位置就是tail & mask
+    auto array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i) {
+      array[i] = i;
+    }
+    sq_local_tail_ = *sq_tail_;
+
+    auto cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  bool RegisterFiles(const std::vector<int> &files) {
+    if (files.empty()) return true;
+    auto r = syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_FILES,
+                     files.data(), static_cast<unsigned>(files.size()));
+    if (r < 0) return false;
+    for (size_t i = 0; i < files.size(); ++i) {
+      auto fd = files[i];
+      if (fd < 0) continue;
+      if (static_cast<size_t>(fd) >= fixed_files_.size()) {
+        fixed_files_.resize(fd + 1, -1);
+      }
+      fixed_files_[fd] = static_cast<int>(i);
+    }
+    return true;
+  }
+
+  bool RegisterBuffers(const std::vector<iovec_t> &buffers) {
+    if (buffers.empty()) return true;
+    // iovec_t和struct iovec的内存布局是一样的
+    auto r = syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS,
+                     buffers.data(), static_cast<unsigned>(buffers.size()));
+    if (r < 0) return false;
+    buffers_ = buffers;
+    return true;
+  }
+
+  void Release() {
+    if (sqes_) munmap(sqes_, sqes_size_);
+    if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+    sqes_ = nullptr;
+    sq_ring_ = cq_ring_ = nullptr;
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+
+  void SetFile(io_uring_sqe *sqe, int fd) const {
+    if (fd >= 0 && static_cast<size_t>(fd) < fixed_files_.size() && fixed_files_[fd] >= 0) {
+      sqe->fd = fixed_files_[fd];
+      sqe->flags |= IOSQE_FIXED_FILE;
+    } else {
+      sqe->fd = fd;
+    }
+  }
+
+  [[nodiscard]] int FindBuffer(void *buffer, size_t len) const {
+    auto begin = static_cast<char *>(buffer);
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      auto base = static_cast<char *>(buffers_[i].iov_base);
+      if (begin >= base && begin + len <= base + buffers_[i].iov_len) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  template<typename Prep>
+  void Submit(AIOCallback cb, Prep &&prep) {
+    if (ring_fd_ < 0) {
+      Fail(cb, -EBADF);
+      return;
+    }
+    auto request = new Request{std::move(cb)};
+    inflight_.fetch_add(1, std::memory_order_release);
+    Enqueue([&](io_uring_sqe *sqe) {
+      prep(sqe);
+      sqe->user_data = reinterpret_cast<uint64_t>(request);
+    });
+  }
+
+  /// 填写一个SQE，并保证它最终会被提交给内核
+  template<typename Prep>
+  void Enqueue(Prep &&prep) {
+    std::unique_lock lock(sq_mutex_);
+    while (sq_local_tail_ - Ref(sq_head_).load(std::memory_order_acquire) >= sq_entries_) {
+      // SQ已满，等待内核消费
+      if (sqpoll_ || flushing_) {
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+      } else {
+        Flush(lock);
+      }
+    }
+    auto sqe = &sqes_[sq_local_tail_ & sq_mask_];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    prep(sqe);
+    Ref(sq_tail_).store(++sq_local_tail_, std::memory_order_release);
+    if (sqpoll_) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (Ref(sq_flags_).load(std::memory_order_relaxed) & IORING_SQ_NEED_WAKEUP) {
+        Enter(0, 0, IORING_ENTER_SQ_WAKEUP);
+      }
+      return;
+    }
+    ++pending_;
+    if (!flushing_ && Current() != this) {
+      Flush(lock);
+    }
+  }
+
+  /// 一次系统调用提交所有积压的SQE，提交期间其他线程填写的SQE会在下一轮一起提交
+  void Flush(std::unique_lock<std::mutex> &lock) {
+    flushing_ = true;
+    while (pending_ > 0) {
+      auto n = std::exchange(pending_, 0);
+      lock.unlock();
+      auto r = Enter(n, 0, 0);
+      lock.lock();
+      if (r < 0) {
+        pending_ += n;
+        if (r != -EINTR && r != -EAGAIN && r != -EBUSY) {
+          break;
+        }
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+      } else if (static_cast<unsigned>(r) < n) {
+        pending_ += n - r;
+      }
+    }
+    flushing_ = false;
+  }
+
+  /// 不经过系统调用地取出所有完成的CQE
+  unsigned Reap() {
+    auto head = *cq_head_;
+    auto tail = Ref(cq_tail_).load(std::memory_order_acquire);
+    if (head == tail) {
+      return 0;
+    }
+    // 和Submit中的fetch_add配对。内核已经保证了SQE到CQE的顺序，这里是为了让TSAN也能看到Request的发布
+    inflight_.load(std::memory_order_acquire);
+    unsigned n = 0;
+    while (head != tail) {
+      auto &cqe = cqes_[head & cq_mask_];
+      auto request = reinterpret_cast<Request *>(cqe.user_data);
+      auto res = cqe.res;
+      // 先归还CQ的槽位，回调里可能会继续提交IO
+      Ref(cq_head_).store(++head, std::memory_order_release);
+      if (request) {
+        io_event_t event{nullptr, nullptr, static_cast<uint64_t>(static_cast<int64_t>(res)), 0};
+        request->callback(event);
+        delete request;
+        inflight_.fetch_sub(1, std::memory_order_release);
+      }
+      ++n;
+    }
+    return n;
+  }
+
+  static IoUringIOExecutor *&Current() {
+    static thread_local IoUringIOExecutor *current = nullptr;
+    return current;
+  }
+
+  void Loop() {
+    Current() = this;
+    while (true) {
+      if (Reap() > 0) {
+        continue;
+      }
+      if (stop_.load(std::memory_order_acquire) &&
+          inflight_.load(std::memory_order_acquire) == 0) {
+        break;
+      }
+      // 提交回调中产生的SQE，同时等待下一个CQE
+      // 即使有其他线程也在提交，每个线程提交的个数都不会超过它已经发布的SQE，所以不需要互斥
+      unsigned to_submit;
+      {
+        std::lock_guard lg(sq_mutex_);
+        to_submit = std::exchange(pending_, 0);
+      }
+      auto r = Enter(to_submit, 1, IORING_ENTER_GETEVENTS);
+      auto submitted = r < 0 ? 0u : std::min(static_cast<unsigned>(r), to_submit);
+      if (submitted < to_submit) {
+        std::lock_guard lg(sq_mutex_);
+        pending_ += to_submit - submitted;
+      }
+    }
+    Current() = nullptr;
+  }
+
+  int ring_fd_{-1};
+  bool sqpoll_{false};
+
+  void *sq_ring_{nullptr};
+  void *cq_ring_{nullptr};
+  size_t sq_ring_size_{0};
+  size_t cq_ring_size_{0};
+  size_t sqes_size_{0};
+
+  std::mutex sq_mutex_;
+  io_uring_sqe *sqes_{nullptr};
+  unsigned *sq_head_{nullptr};
+  unsigned *sq_tail_{nullptr};
+  unsigned *sq_flags_{nullptr};
+  unsigned sq_mask_{0};
+  unsigned sq_entries_{0};
+  unsigned sq_local_tail_{0};  ///< 受sq_mutex_保护
+  unsigned pending_{0};        ///< 已经填写但还没有提交的SQE个数，受sq_mutex_保护
+  bool flushing_{false};       ///< 是否有线程正在提交，受sq_mutex_保护
+
+  unsigned *cq_head_{nullptr};
+  unsigned *cq_tail_{nullptr};
+  unsigned cq_mask_{0};
+  io_uring_cqe *cqes_{nullptr};
+
+  std::vector<int> fixed_files_;   ///< fd到注册索引的映射，-1表示没有注册
+  std::vector<iovec_t> buffers_;
+
+  std::atomic<bool> stop_{false};
+  std::atomic<size_t> inflight_{0};
+  std::thread loop_thread_;
+};
+#endif
+
+} // namespace async_simple::executors
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_EXECUTOR_IO_URING_IO_EXECUTOR_HPP_
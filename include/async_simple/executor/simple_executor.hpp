@@ -2,30 +2,68 @@
 #define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_EXECUTOR_SIMPLE_EXECUTOR_HPP_
 
 #include "async_simple/executor/executor.hpp"
+#include "async_simple/executor/io_uring_io_executor.hpp"
 #include "async_simple/executor/simple_io_executor.hpp"
 #include "async_simple/util/thread_pool.hpp"
+#include "async_simple/util/timer_service.hpp"
+
+#include <memory>
 
 namespace async_simple::executors {
 
+/// SimpleExecutor使用的IO后端
+enum class IOBackend {
+  kAio,      ///< SimpleIOExecutor(libaio)
+  kIoUring,  ///< IoUringIOExecutor，不可用时退回kAio
+};
+
 class SimpleExecutor : public Executor {
   static constexpr int64_t kContextMask = 0x40000000;
 
  public:
-  explicit SimpleExecutor(std::size_t thread_num) : pool_(thread_num) {
-    io_executor_.Init();
-  }
-  ~SimpleExecutor() {
-    io_executor_.Destory();
+  /// @param spin_count 空闲的工作线程休眠前自旋的次数，用空闲时的CPU换取更低的唤醒延迟
+  explicit SimpleExecutor(std::size_t thread_num, bool enable_work_steal = false,
+                          IOBackend io_backend = IOBackend::kAio,
+                          uint32_t spin_count = util::ThreadPool::kDefaultSpinCount)
+      : pool_(thread_num, enable_work_steal, spin_count) {
+    InitIOExecutor(io_backend);
   }
 
   bool Schedule(Func func) override {
     return pool_.ScheduleById(std::move(func)) == util::ThreadPool::kErrorNone;
   }
+  bool Schedule(Func func, ScheduleOptions options) override {
+    if (options.next) {
+      return pool_.ScheduleNext(std::move(func)) == util::ThreadPool::kErrorNone;
+    }
+    return Schedule(std::move(func));
+  }
   [[nodiscard]] bool CurrentThreadInExecutor() const override {
     return pool_.GetCurrentId() != -1;
   }
   [[nodiscard]] ExecutorStat Stat() const override {
-    return {};
+    using std::chrono::nanoseconds;
+    ExecutorStat stat;
+    stat.pending_task_count = pool_.GetInjectionCount();
+    for (auto &worker : pool_.GetWorkerStats()) {
+      stat.pending_task_count += worker.pending;
+      stat.workers.push_back(WorkerStat{
+          worker.pending, worker.parked, worker.executed, worker.steals, worker.failed_steals, worker.parks,
+          nanoseconds(worker.parked_ns), worker.queue_wait_samples, nanoseconds(worker.queue_wait_ns),
+          nanoseconds(worker.max_queue_wait_ns), worker.lifo_executed});
+    }
+    return stat;
+  }
+  [[nodiscard]] ExecutorLatencyStat LatencyStat() const override {
+    auto snapshot = pool_.GetLatencySnapshot();
+    ExecutorLatencyStat stat;
+    stat.queue_wait = LatencyPercentiles(snapshot.queue_wait);
+    stat.run_time = LatencyPercentiles(snapshot.run_time);
+    stat.continuation_delay = LatencyPercentiles(snapshot.continuation_delay);
+    return stat;
+  }
+  void RecordContinuationDelay(std::chrono::nanoseconds delay) override {
+    pool_.RecordContinuationDelay(delay.count());
   }
   [[nodiscard]] size_t CurrentContextId() const override {
     return pool_.GetCurrentId();
@@ -41,14 +79,41 @@ class SimpleExecutor : public Executor {
       func();
       return true;
     }
+    if (options.next) {
+      return pool_.ScheduleNext(std::move(func), id & (~kContextMask)) == util::ThreadPool::kErrorNone;
+    }
     return pool_.ScheduleById(std::move(func), id & (~kContextMask)) == util::ThreadPool::kErrorNone;
   }
 
-  IOExecutor *GetIOExecutor() override { return &io_executor_; }
+  IOExecutor *GetIOExecutor() override { return io_executor_.get(); }
+  util::TimerService *GetTimerService() override { return &timer_; }
 
  private:
+  /// 所有的定时任务共用一个定时器线程，到期后再提交到线程池中
+  void Schedule(Func func, Duration duration) override {
+    timer_.Schedule([this, f = std::move(func)]() mutable {
+      Schedule(std::move(f));
+    }, duration);
+  }
+
+  void InitIOExecutor(IOBackend io_backend) {
+#ifdef HAS_IO_URING
+    if (io_backend == IOBackend::kIoUring) {
+      auto io_executor = std::make_unique<IoUringIOExecutor>();
+      if (io_executor->Init()) {
+        io_executor_ = std::move(io_executor);
+        return;
+      }
+    }
+#endif
+    auto io_executor = std::make_unique<SimpleIOExecutor>();
+    io_executor->Init();
+    io_executor_ = std::move(io_executor);
+  }
+
   util::ThreadPool pool_;
-  SimpleIOExecutor io_executor_;
+  util::TimerService timer_;  // 需要先于pool_析构
+  std::unique_ptr<IOExecutor> io_executor_;  // IO的回调会提交到线程池，需要最先析构
 };
 
 } // namespace async_simple
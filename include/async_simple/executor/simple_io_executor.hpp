@@ -2,9 +2,17 @@
 #define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_EXECUTOR_SIMPLE_IO_EXECUTOR_HPP_
 
 #include "async_simple/executor/io_executor.hpp"
-
+#include "async_simple/util/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #ifdef HAS_AIO
 #include <libaio.h>
@@ -13,111 +21,220 @@
 namespace async_simple::executors {
 
 #ifdef HAS_AIO
+/// 基于libaio的IOExecutor
+/// - 提交的iocb先放到暂存区，攒够batch_size个，或者当前任务执行结束时（在SimpleExecutor的工作线程中），
+///   或者完成线程下一次轮询时，用一次io_submit批量提交
+/// - Task预先分配在一个大小为depth的slab中，在途的IO超过depth时回调会收到-EAGAIN
+/// - 完成线程一次io_getevents取出一批事件，先归还slab再执行回调，不会逐个delete
 class SimpleIOExecutor : public IOExecutor {
  public:
-  static constexpr int kMaxAio = 8;
+  static constexpr unsigned kDefaultDepth = 128;
+  static constexpr unsigned kDefaultBatchSize = 32;
+
+  struct Options {
+    unsigned depth{kDefaultDepth};           ///< io_setup的深度，也是最多在途的IO个数
+    unsigned batch_size{kDefaultBatchSize};  ///< 暂存区达到这个大小时立即提交
+  };
 
   SimpleIOExecutor() = default;
-  ~SimpleIOExecutor() override = default;
+  ~SimpleIOExecutor() override { Destroy(); }
 
   class Task {
    public:
-    Task(AIOCallback func) : aio_callback_(std::move(func)) {}
-    ~Task() = default;
-
     void Process(io_event_t &event) { aio_callback_(event); }
 
    private:
+    friend class SimpleIOExecutor;
+
+    iocb io_;
     AIOCallback aio_callback_;
   };
 
-  bool Init() {
-    auto r = io_setup(kMaxAio, &io_context_);
+  bool Init() { return Init(Options{}); }
+  bool Init(const Options &options) {
+    depth_ = std::max(options.depth, 1u);
+    batch_size_ = std::clamp(options.batch_size, 1u, depth_);
+    auto r = io_setup(static_cast<int>(depth_), &io_context_);
     if (r < 0) return false;
+    tasks_ = std::make_unique<Task[]>(depth_);
+    free_.reserve(depth_);
+    for (unsigned i = depth_; i > 0; --i) {
+      free_.push_back(&tasks_[i - 1]);
+    }
+    staged_.reserve(depth_);
+    events_.resize(depth_);
+    callbacks_.resize(depth_);
     loop_thread_ = std::thread([this]() {
       this->Loop();
     });
     return true;
   }
 
+  /// 等待所有已经提交的IO完成后退出
   void Destroy() {
     shutdown_ = true;
     if (loop_thread_.joinable()) {
       loop_thread_.join();
     }
-    io_destroy(io_context_);
+    if (io_context_) {
+      io_destroy(io_context_);
+      io_context_ = nullptr;
+    }
   }
 
   void Loop() {
-    while (shutdown_) {
-      io_event events[kMaxAio];
+    while (true) {
+      // 兜底提交暂存区，避免提交者在任务结束之前阻塞时IO一直没有提交
+      Flush();
+      if (shutdown_) {
+        std::lock_guard lg(mutex_);
+        if (free_.size() == depth_) {
+          break;
+        }
+      }
       struct timespec timeout = {0, 1000 * 300};
-      auto n = io_getevents(io_context_, 1, kMaxAio, events, &timeout);
-      if (n < 0) continue;
+      auto n = io_getevents(io_context_, 1, static_cast<long>(depth_), events_.data(), &timeout);
+      if (n <= 0) continue;
+      // 先把回调取出来并归还slab，回调中可以立即提交新的IO
+      {
+        std::lock_guard lg(mutex_);
+        for (int i = 0; i < n; ++i) {
+          auto task = static_cast<Task *>(events_[i].data);
+          callbacks_[i] = std::move(task->aio_callback_);
+          free_.push_back(task);
+        }
+      }
       for (int i = 0; i < n; ++i) {
-        auto task = reinterpret_cast<Task *>(events[i].data);
-        io_event_t event{events[i].data, events[i].obj, events[i].res, events[i].res2};
-        task->Process(event);
-        delete task;
+        io_event_t event{events_[i].data, events_[i].obj, events_[i].res, events_[i].res2};
+        callbacks_[i](event);
+        callbacks_[i] = nullptr;
       }
     }
   }
 
   void SubmitIO(int fd, iocb_cmd cmd, void *buffer, size_t len, off_t offset, AIOCallback cb) override {
-    iocb io;
-    memset(&io, 0, sizeof(iocb));
-    io.aio_fildes = fd;
-    io.aio_lio_opcode = cmd;
-    io.u.c.buf = buffer;
-    io.u.c.nbytes = len;
-    io.data = new Task(cb);
-    struct iocb *iocbs[] = {&io};
-    auto r = io_submit(io_context_, 1, iocbs);
-    if (r < 0) {
-      auto task = reinterpret_cast<Task *>(iocbs[0]->data);
-      io_event_t event;
-      event.res = r;
-      task->Process(event);
-      delete task;
-    }
+    Submit(fd, cmd, buffer, len, offset, std::move(cb));
   }
 
   void SubmitIOV(int fd, iocb_cmd cmd, const iovec_t *iov, size_t count, off_t offset, AIOCallback cb) override {
-    iocb io;
+    Submit(fd, cmd, const_cast<iovec_t *>(iov), count, offset, std::move(cb));
+  }
+
+  /// 立即提交暂存区中的所有iocb
+  void Flush() {
+    std::unique_lock lock(mutex_);
+    if (!staged_.empty()) {
+      Flush(lock);
+    }
+  }
+
+ private:
+  static void Fail(AIOCallback &cb, long res) {
+    io_event_t event{nullptr, nullptr, static_cast<uint64_t>(res), 0};
+    cb(event);
+  }
+
+  void Submit(int fd, iocb_cmd cmd, void *buffer, size_t nbytes, off_t offset, AIOCallback cb) {
+    std::unique_lock lock(mutex_);
+    if (free_.empty()) {
+      lock.unlock();
+      Fail(cb, -EAGAIN);
+      return;
+    }
+    auto task = free_.back();
+    free_.pop_back();
+    auto &io = task->io_;
     memset(&io, 0, sizeof(iocb));
     io.aio_fildes = fd;
     io.aio_lio_opcode = cmd;
-    io.u.c.buf = (void*)iov;
+    io.u.c.buf = buffer;
+    io.u.c.nbytes = nbytes;
     io.u.c.offset = offset;
-    io.u.c.nbytes = count;
-    io.data = new Task(cb);
-    struct iocb *iocbs[] = {&io};
-    auto r = io_submit(io_context_, 1, iocbs);
-    if (r < 0) {
-      auto task = reinterpret_cast<Task *>(iocbs[0]->data);
-      io_event_t event;
-      event.res = r;
-      task->Process(event);
-      delete task;
+    io.data = task;
+    task->aio_callback_ = std::move(cb);
+    staged_.push_back(&io);
+    if (staged_.size() >= batch_size_) {
+      Flush(lock);
+      return;
+    }
+    if (!util::ThreadPool::DeferToTickEnd(this, [this]() { Flush(); })) {
+      // 不在工作线程中，没有办法知道什么时候结束，直接提交
+      Flush(lock);
     }
   }
- private:
-  volatile bool shutdown_{false};
+
+  /// 调用时需要持有锁，返回时锁可能已经被释放
+  void Flush(std::unique_lock<std::mutex> &lock) {
+    std::vector<std::pair<Task *, long>> failed;
+    size_t done = 0;
+    while (done < staged_.size()) {
+      auto r = io_submit(io_context_, static_cast<long>(staged_.size() - done), staged_.data() + done);
+      if (r > 0) {
+        done += r;
+        continue;
+      }
+      // 第一个iocb提交失败，跳过它继续提交剩下的
+      failed.emplace_back(static_cast<Task *>(staged_[done]->data), r < 0 ? r : -EIO);
+      ++done;
+    }
+    staged_.clear();
+    if (failed.empty()) {
+      return;
+    }
+    lock.unlock();
+    for (auto &[task, res] : failed) {
+      auto cb = std::move(task->aio_callback_);
+      {
+        std::lock_guard lg(mutex_);
+        free_.push_back(task);
+      }
+      Fail(cb, res);
+    }
+  }
+
+  unsigned depth_{kDefaultDepth};
+  unsigned batch_size_{kDefaultBatchSize};
+  std::atomic<bool> shutdown_{false};
   io_context_t io_context_{nullptr};
+
+  std::mutex mutex_;
+  std::unique_ptr<Task[]> tasks_;
+  std::vector<Task *> free_;     ///< 受mutex_保护
+  std::vector<iocb *> staged_;   ///< 受mutex_保护
+
+  std::vector<io_event> events_;          ///< 只在完成线程中使用
+  std::vector<AIOCallback> callbacks_;    ///< 只在完成线程中使用
   std::thread loop_thread_;
 };
 #else
 
 class SimpleIOExecutor : public IOExecutor {
  public:
+  struct Options {
+    unsigned depth{128};
+    unsigned batch_size{32};
+  };
+
   SimpleIOExecutor() = default;
   ~SimpleIOExecutor() override = default;
 
   bool Init() { return false; }
-  void Destory() {}
+  bool Init(const Options &) { return false; }
+  void Destroy() {}
   void Loop() {}
-  void SubmitIO(int fd, iocb_cmd cmd, void *buffer, size_t len, off_t offset, AIOCallback cb) override {}
-  void SubmitIOV(int fd, iocb_cmd cmd, const iovec_t *iov, size_t count, off_t offset, AIOCallback cb) override {}
+  /// 没有libaio时IO直接以-ENOSYS失败，避免等待回调的一方永远挂起
+  void SubmitIO(int, iocb_cmd, void *, size_t, off_t, AIOCallback cb) override {
+    Fail(cb);
+  }
+  void SubmitIOV(int, iocb_cmd, const iovec_t *, size_t, off_t, AIOCallback cb) override {
+    Fail(cb);
+  }
+
+ private:
+  static void Fail(AIOCallback &cb) {
+    io_event_t event{nullptr, nullptr, static_cast<uint64_t>(static_cast<int64_t>(-ENOSYS)), 0};
+    cb(event);
+  }
 };
 
 #endif
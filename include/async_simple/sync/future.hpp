@@ -5,9 +5,15 @@
 #include "async_simple/sync/future_trait.hpp"
 #include "async_simple/sync/local_state.hpp"
 #include "async_simple/sync/promise.hpp"
+#include "async_simple/sync/then_chain.hpp"
 
 namespace async_simple {
 
+/// Future有三种状态：
+/// - local_state_：已经有结果的Future
+/// - shared_state_：和Promise共享的FutureState
+/// - chain_/tail_：一串还没有开始执行的ThenValue/ThenTry，链的尾部产生T，
+///   需要等待结果或者设置continuation时才在尾部接一个Promise，回到FutureState上
 template<typename T>
 class Future : noncopyable {
  public:
@@ -24,25 +30,41 @@ class Future : noncopyable {
     if (shared_state_) {
       shared_state_->DetachOne();
     }
+    if (chain_) {
+      chain_->Release();
+    }
   }
 
   Future(Future &&other)
       : shared_state_(std::exchange(other.shared_state_, nullptr)),
+        chain_(std::exchange(other.chain_, nullptr)),
+        tail_(std::exchange(other.tail_, nullptr)),
         local_state_(std::move(other.local_state_)) {
   }
 
   Future &operator=(Future &&other) {
     if (this != &other) {
+      if (shared_state_) {
+        shared_state_->DetachOne();
+      }
+      if (chain_) {
+        chain_->Release();
+      }
       shared_state_ = std::exchange(other.shared_state_, nullptr);
+      chain_ = std::exchange(other.chain_, nullptr);
+      tail_ = std::exchange(other.tail_, nullptr);
       local_state_ = std::move(other.local_state_);
     }
     return *this;
   }
 
   [[nodiscard]] bool Valid() const {
-    return shared_state_ != nullptr || local_state_.HasResult();
+    return shared_state_ != nullptr || tail_ != nullptr || local_state_.HasResult();
   }
   bool HasResult() const {
+    if (tail_) {
+      return tail_->HasResult();
+    }
     return local_state_.HasResult() || shared_state_->HasResult();
   }
 
@@ -54,7 +76,14 @@ class Future : noncopyable {
   T &Value() &{ return Result().Value(); }
   const T &Value() const &{ return Result().Value(); }
 
+  /// 链上的阶段都在同一个executor上执行，只有executor变化时才把链截断
   void SetExecutor(Executor *executor) {
+    if (tail_) {
+      if (executor == chain_->GetExecutor()) {
+        return;
+      }
+      Materialize();
+    }
     if (shared_state_) {
       shared_state_->SetExecutor(executor);
     } else {
@@ -62,6 +91,9 @@ class Future : noncopyable {
     }
   }
   Executor *GetExecutor() {
+    if (tail_) {
+      return chain_->GetExecutor();
+    }
     if (shared_state_) {
       return shared_state_->GetExecutor();
     } else {
@@ -72,6 +104,7 @@ class Future : noncopyable {
   template<typename F>
   void SetContinuation(F &&func) {
     ASSERT(Valid());
+    Materialize();
     if (shared_state_) {
       shared_state_->SetContinuation(std::forward<F>(func));
     } else {
@@ -81,6 +114,10 @@ class Future : noncopyable {
 
   bool CurrentThreadInExecutor() {
     ASSERT(Valid());
+    if (tail_) {
+      auto executor = chain_->GetExecutor();
+      return executor && executor->CurrentThreadInExecutor();
+    }
     if (shared_state_) {
       return shared_state_->CurrentThreadInExecutor();
     } else {
@@ -101,17 +138,13 @@ class Future : noncopyable {
     }
     /// 在同一个Executor中等待可能会导致死锁
     ASSERT(!CurrentThreadInExecutor());
+    Materialize();
+    if (!shared_state_) {
+      return;
+    }
+    LOGIC_ASSERT(!shared_state_->HasContinuation(), "Future already has a continuation");
 
-    Promise<T> promise;
-    auto future = promise.GetFuture();
-    shared_state_->SetExecutor(nullptr);  // 下一个continuation是简单的，直接立即执行
-    std::binary_semaphore sem(0);
-    shared_state_->SetContinuation([&sem, p = std::move(promise)](Try<T> &&t) mutable {
-      p.SetValue(std::move(t));
-      sem.release();
-    });
-    sem.acquire();
-    *this = std::move(future);
+    shared_state_->Wait();
     ASSERT(shared_state_->HasResult());
   }
 
@@ -141,11 +174,38 @@ class Future : noncopyable {
   }
 
  private:
+  template<typename U>
+  friend class Future;
+
+  Future(detail::ThenChain *chain, detail::StageOutput<T> *tail)
+      : shared_state_(nullptr), chain_(chain), tail_(tail) {}
+
+  /// 在链的尾部接上一个Promise，之后按FutureState处理；链已经执行完时直接取出结果
+  void Materialize() {
+    if (!tail_) {
+      return;
+    }
+    auto chain = std::exchange(chain_, nullptr);
+    auto tail = std::exchange(tail_, nullptr);
+    if (tail->HasResult()) {
+      local_state_ = LocalState<T>(std::move(tail->GetTry()));
+      local_state_.SetExecutor(chain->GetExecutor());
+    } else {
+      Promise<T> promise;
+      *this = promise.GetFuture();
+      shared_state_->SetExecutor(chain->GetExecutor());
+      tail->Link(chain, chain->template Emplace<detail::PromiseStage<T>>(std::move(promise)));
+    }
+    chain->Release();
+  }
+
   template<typename Clazz>
   static decltype(auto) GetTry(Clazz &self) {
     LOGIC_ASSERT(self.Valid(), "Future is broken");
-    LOGIC_ASSERT(self.local_state_.HasResult() || self.shared_state_->HasResult(),
-                 "Future is not ready");
+    LOGIC_ASSERT(self.HasResult(), "Future is not ready");
+    if (self.tail_) {
+      return self.tail_->GetTry();
+    }
     if (self.shared_state_) {
       return self.shared_state_->GetTry();
     } else {
@@ -160,6 +220,8 @@ class Future : noncopyable {
     LOGIC_ASSERT(Valid(), "Future is broken");
     using T2 = typename R::ReturnsFuture::Inner;
 
+    // 返回Future的回调要等内层的Future完成，不能并入链中
+    Materialize();
     if (!shared_state_) {
       try {
         auto new_future = std::forward<F>(func)(std::move(local_state_.GetTry()));
@@ -200,27 +262,32 @@ class Future : noncopyable {
     LOGIC_ASSERT(Valid(), "Future is broken");
     using T2 = typename R::ReturnsFuture::Inner;
 
+    using Stage = detail::ThenStage<T, T2, std::decay_t<F>, R::is_try>;
+
+    if (tail_) {
+      // 接在链的尾部，不需要新的Promise和FutureState
+      auto stage = chain_->template Emplace<Stage>(std::forward<F>(func));
+      tail_->Link(chain_, stage);
+      tail_ = nullptr;
+      return Future<T2>(std::exchange(chain_, nullptr), stage);
+    }
+
     if (!shared_state_) {
       Future<T2> new_future(MakeTryCall(std::forward<F>(func), std::move(local_state_.GetTry())));
       new_future.SetExecutor(local_state_.GetExecutor());
       return new_future;
     }
 
-    Promise<T2> promise;
-    auto new_future = promise.GetFuture();
-    new_future.SetExecutor(shared_state_->GetExecutor());
-    shared_state_->SetContinuation([p = std::move(promise),
-                                       f = std::forward<F>(func)](Try<T> &&t) mutable {
-      if (!R::is_try && t.HasException()) {
-        p.SetException(t.GetException());
-      } else {
-        p.SetValue(MakeTryCall(std::forward<F>(f), std::move(t)));
-      }
-    });
-    return new_future;
+    // 新开一条链，整条链只在当前的FutureState上设置一次continuation
+    auto chain = new detail::ThenChain(shared_state_->GetExecutor());
+    auto stage = chain->template Emplace<Stage>(std::forward<F>(func));
+    shared_state_->SetContinuation(detail::ChainEntry<T>(chain, stage));
+    return Future<T2>(chain, stage);
   }
 
   FutureState<T> *shared_state_;
+  detail::ThenChain *chain_{nullptr};
+  detail::StageOutput<T> *tail_{nullptr};
   LocalState<T> local_state_;
 };
 
@@ -3,11 +3,183 @@
 
 #include "async_simple/sync/future.hpp"
 
-#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace async_simple {
 
+namespace detail {
+
+/// Collect系列的共享状态都和FutureState一样从内存池中分配，每次Collect只有这一个共享对象
+struct PooledContext : noncopyable {
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+  static void *operator new(std::size_t size) { return util::FramePool::Allocate(size); }
+  static void operator delete(void *ptr) noexcept { util::FramePool::Deallocate(ptr); }
+#endif
+};
+
+/// CollectAll的共享状态，R是结果的vector或者tuple
+/// 不使用shared_ptr，每个输入完成时计数减一，减到零的一方设置结果并删除自身
+template<typename R>
+struct CollectAllContext : PooledContext {
+  CollectAllContext(std::size_t n, Promise<R> &&p, R &&r)
+      : remaining(n + 1), results(std::move(r)), promise(std::move(p)) {}
+
+  void Arrive() {
+    if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      promise.SetValue(std::move(results));
+      delete this;
+    }
+  }
+
+  std::atomic<std::size_t> remaining;
+  R results;
+  Promise<R> promise;
+};
+
+/// CollectAny和CollectN的共享状态，按完成的先后顺序保留前k个结果
+/// R是单个结果(CollectAny)或者结果的vector(CollectN)，单个结果直接保存在共享状态中
+/// state_的高32位是领取到的结果位置，低32位是已经写好的结果数：
+/// - 领取到的位置不小于k时结果已经确定，之后完成的输入直接丢弃，不再移动结果
+/// - 写好第k个结果的一方设置promise，之后再把低32位加一，表示不再访问promise
+/// - 所有输入都完成并且promise已经设置之后，让state_到达终态的那一方删除自身
+template<typename T, typename R>
+class CollectNContext : public PooledContext {
+  using Slot = std::pair<std::size_t, Try<T>>;
+  static constexpr bool kSingle = std::is_same_v<R, Slot>;
+
+ public:
+  CollectNContext(std::size_t n, std::size_t k, Promise<R> &&p)
+      : final_state_(static_cast<uint64_t>(n) << 32 | (k + 1)),
+        k_(k),
+        promise_(std::move(p)) {
+    if constexpr (!kSingle) {
+      results_.resize(k);
+    }
+  }
+
+  void Arrive(std::size_t index, Try<T> &&t) {
+    // 每次fetch_add之后this都可能被别的输入删除，成员要提前读出来
+    const auto k = k_;
+    const auto final_state = final_state_;
+    auto state = state_.fetch_add(kClaim, std::memory_order_acq_rel) + kClaim;
+    auto slot = (state >> 32) - 1;
+    if (slot >= k) {
+      Release(state, final_state);
+      return;
+    }
+    if constexpr (kSingle) {
+      results_ = {index, std::move(t)};
+    } else {
+      results_[slot] = {index, std::move(t)};
+    }
+    state = state_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    if ((state & kMask) == k) {
+      promise_.SetValue(std::move(results_));
+      state = state_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+    Release(state, final_state);
+  }
+
+ private:
+  static constexpr uint64_t kClaim = uint64_t(1) << 32;
+  static constexpr uint64_t kMask = kClaim - 1;
+
+  void Release(uint64_t state, uint64_t final_state) {
+    if (state == final_state) {
+      delete this;
+    }
+  }
+
+  std::atomic<uint64_t> state_{0};
+  const uint64_t final_state_;
+  const std::size_t k_;
+  R results_;
+  Promise<R> promise_;
+};
+
+/// CollectAllWindowed的共享状态，completed_同时决定下一个要启动的输入，
+/// 第c个完成的输入启动第max_in_flight + c - 1个输入，每个位置只会被启动一次
+template<typename T, typename F>
+class CollectWindowedContext : public PooledContext {
+ public:
+  CollectWindowedContext(std::size_t n, std::size_t max_in_flight,
+                         Promise<std::vector<Try<T>>> &&p, F &&func)
+      : n_(n),
+        max_in_flight_(max_in_flight),
+        results_(n),
+        promise_(std::move(p)),
+        func_(std::move(func)) {}
+
+  /// 启动第i个输入，已经有结果的输入在循环中处理，不会因为一连串立即完成的输入而递归
+  void Launch(std::size_t i) {
+    auto future = Start(i);
+    if (future.HasResult()) {
+      Complete(i, std::move(future.Result()));
+    } else {
+      future.SetContinuation([this, i](Try<T> &&t) { Complete(i, std::move(t)); });
+    }
+  }
+
+ private:
+  /// func抛出的异常作为这个输入的结果：Complete运行在其他输入的continuation中，
+  /// 异常不能从那里抛出去，而且每个输入都要计入completed_，否则结果永远不会设置
+  Future<T> Start(std::size_t i) {
+    try {
+      return func_(i);
+    } catch (...) {
+      return Future<T>(Try<T>(std::current_exception()));
+    }
+  }
+
+  void Complete(std::size_t i, Try<T> &&t) {
+    // fetch_add之后最后一个完成的输入随时可能删除this，成员要提前读出来
+    const auto n = n_;
+    const auto max_in_flight = max_in_flight_;
+    Try<T> value = std::move(t);
+    while (true) {
+      results_[i] = std::move(value);
+      auto completed = completed_.fetch_add(1, std::memory_order_acq_rel) + 1;
+      if (completed == n) {
+        promise_.SetValue(std::move(results_));
+        delete this;
+        return;
+      }
+      auto next = max_in_flight + completed - 1;
+      if (next >= n) {
+        return;
+      }
+      auto future = Start(next);
+      if (!future.HasResult()) {
+        future.SetContinuation([this, next](Try<T> &&t) { Complete(next, std::move(t)); });
+        return;
+      }
+      i = next;
+      value = std::move(future.Result());
+    }
+  }
+
+  const std::size_t n_;
+  const std::size_t max_in_flight_;
+  std::atomic<std::size_t> completed_{0};
+  std::vector<Try<T>> results_;
+  Promise<std::vector<Try<T>>> promise_;
+  F func_;
+};
+
+template<typename F>
+using WindowedValueType = typename std::invoke_result_t<F &, std::size_t>::value_type;
+
+} // namespace async_simple::detail
+
+/// 等待所有的Future完成，结果的顺序和输入的顺序相同
 template<typename Iter>
+requires std::random_access_iterator<Iter>
 inline
 Future<std::vector<Try<typename std::iterator_traits<Iter>::value_type::value_type>>>
 CollectAll(Iter begin, Iter end) {
@@ -27,26 +199,131 @@ CollectAll(Iter begin, Iter end) {
 
   Promise<std::vector<Try<T>>> promise;
   auto future = promise.GetFuture();
-
-  struct Context {
-    Context(std::size_t n, Promise<std::vector<Try<T>>> pp)
-        : results(n), p(std::move(pp)) {}
-    ~Context() { p.SetValue(std::move(results)); }
-    std::vector<Try<T>> results;
-    Promise<std::vector<Try<T>>> p;
-  };
-
-  auto ctx = std::make_shared<Context>(n, std::move(promise));
+  // 已经有结果的Future直接填入，其余的完成时各自减少计数；多出的一个计数保证填入过程中ctx不会被删除
+  auto ctx = new detail::CollectAllContext<std::vector<Try<T>>>(
+      n, std::move(promise), std::vector<Try<T>>(n));
   for (std::size_t i = 0; i < n; ++i) {
     auto cur = begin + i;
     if (cur->HasResult()) {
       ctx->results[i] = std::move(cur->Result());
+      ctx->Arrive();
     } else {
       cur->SetContinuation([ctx, i](Try<T> &&t) mutable {
         ctx->results[i] = std::move(t);
+        ctx->Arrive();
       });
     }
   }
+  ctx->Arrive();
+  return future;
+}
+
+/// 等待所有不同类型的Future完成
+/// ```
+/// auto [a, b] = CollectAll(std::move(fa), std::move(fb)).Get();
+/// ```
+template<typename ...Ts>
+inline Future<std::tuple<Try<Ts>...>> CollectAll(Future<Ts> &&...inputs) {
+  using R = std::tuple<Try<Ts>...>;
+  Promise<R> promise;
+  auto future = promise.GetFuture();
+  auto ctx = new detail::CollectAllContext<R>(sizeof...(Ts), std::move(promise), R());
+  [&]<std::size_t ...Indices>(std::index_sequence<Indices...>) {
+    ([&](auto &input) {
+      if (input.HasResult()) {
+        std::get<Indices>(ctx->results) = std::move(input.Result());
+        ctx->Arrive();
+      } else {
+        input.SetContinuation([ctx](auto &&t) {
+          std::get<Indices>(ctx->results) = std::move(t);
+          ctx->Arrive();
+        });
+      }
+    }(inputs), ...);
+  }(std::index_sequence_for<Ts...>());
+  ctx->Arrive();
+  return future;
+}
+
+/// 按完成的先后顺序返回最先完成的n个Future的位置和结果
+/// 结果确定之后，其余Future完成时只减少计数，不再移动它们的结果
+template<typename Iter>
+requires std::random_access_iterator<Iter>
+inline
+Future<std::vector<std::pair<std::size_t, Try<typename std::iterator_traits<Iter>::value_type::value_type>>>>
+CollectN(Iter begin, Iter end, std::size_t n) {
+  using T = typename std::iterator_traits<Iter>::value_type::value_type;
+  using R = std::vector<std::pair<std::size_t, Try<T>>>;
+  std::size_t size = std::distance(begin, end);
+  LOGIC_ASSERT(n <= size, "CollectN needs at least n futures");
+  if (n == 0) {
+    return Future<R>(R());
+  }
+
+  Promise<R> promise;
+  auto future = promise.GetFuture();
+  // 最后一个输入登记完成之前，ctx不会到达终态，之后不再访问ctx
+  auto ctx = new detail::CollectNContext<T, R>(size, n, std::move(promise));
+  for (std::size_t i = 0; i < size; ++i) {
+    auto cur = begin + i;
+    if (cur->HasResult()) {
+      ctx->Arrive(i, std::move(cur->Result()));
+    } else {
+      cur->SetContinuation([ctx, i](Try<T> &&t) { ctx->Arrive(i, std::move(t)); });
+    }
+  }
+  return future;
+}
+
+/// 返回最先完成的Future的位置和结果
+template<typename Iter>
+requires std::random_access_iterator<Iter>
+inline
+Future<std::pair<std::size_t, Try<typename std::iterator_traits<Iter>::value_type::value_type>>>
+CollectAny(Iter begin, Iter end) {
+  using T = typename std::iterator_traits<Iter>::value_type::value_type;
+  using R = std::pair<std::size_t, Try<T>>;
+  LOGIC_ASSERT(begin != end, "CollectAny needs at least one future");
+  for (auto it = begin; it != end; ++it) {
+    if (it->HasResult()) {
+      return Future<R>(R(std::distance(begin, it), std::move(it->Result())));
+    }
+  }
+
+  Promise<R> promise;
+  auto future = promise.GetFuture();
+  std::size_t size = std::distance(begin, end);
+  auto ctx = new detail::CollectNContext<T, R>(size, 1, std::move(promise));
+  for (std::size_t i = 0; i < size; ++i) {
+    (begin + i)->SetContinuation([ctx, i](Try<T> &&t) { ctx->Arrive(i, std::move(t)); });
+  }
+  return future;
+}
+
+/// 通过func(i)依次创建n个Future，同时最多只有max_in_flight个还没有完成，结果的顺序和i相同
+/// func可能在完成前一个Future的线程上被调用，需要是线程安全的；func抛出的异常作为对应位置的结果
+/// ```
+/// auto all = CollectAllWindowed(4, requests.size(), [&](std::size_t i) {
+///   return client.Call(requests[i]);
+/// });
+/// ```
+template<typename F, typename T = detail::WindowedValueType<F>>
+inline Future<std::vector<Try<T>>> CollectAllWindowed(std::size_t max_in_flight, std::size_t n,
+                                                      F &&func) {
+  LOGIC_ASSERT(max_in_flight > 0, "max_in_flight should be greater than 0");
+  if (n == 0) {
+    return Future<std::vector<Try<T>>>(std::vector<Try<T>>());
+  }
+
+  Promise<std::vector<Try<T>>> promise;
+  auto future = promise.GetFuture();
+  using Context = detail::CollectWindowedContext<T, std::decay_t<F>>;
+  auto ctx = new Context(n, max_in_flight, std::move(promise), std::decay_t<F>(std::forward<F>(func)));
+  // 第一个窗口之外的输入都由完成的输入启动，启动最后一个窗口内的输入之后不再访问ctx
+  auto window = std::min(max_in_flight, n);
+  for (std::size_t i = 0; i < window; ++i) {
+    ctx->Launch(i);
+  }
   return future;
 }
 
@@ -2,21 +2,25 @@
 #define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_SYNC_FUTURE_STATE_HPP_
 
 #include "async_simple/base/try.hpp"
-#include "async_simple/base/move_wrapper.hpp"
+#include "async_simple/base/task.hpp"
 #include "async_simple/executor/executor.hpp"
+#include "async_simple/util/frame_pool.hpp"
 
 #include <atomic>
-#include <functional>
 
 namespace async_simple {
 
 namespace detail {
 
+/// 结果和continuation各占一位，两者都设置之后就是kDone，
+/// SetResult和SetContinuation各自只需要一次fetch_or，后到的一方负责执行continuation
+/// kWaiting表示有线程阻塞在Wait中，SetResult看到这一位时才需要唤醒
 enum class State : uint8_t {
   kStart = 0,                 ///< 初始状态
   kOnlyResult = 1 << 0,       ///< 调用了promise.SetValue后的状态
   kOnlyContinuation = 1 << 1, ///< 调用了future.ThenImpl后的状态
-  kDone = 1 << 5,
+  kDone = kOnlyResult | kOnlyContinuation,
+  kWaiting = 1 << 2,
 };
 
 constexpr State operator|(State lhs, State rhs) {
@@ -27,13 +31,15 @@ constexpr State operator&(State lhs, State rhs) {
   return State((uint8_t) lhs & (uint8_t) rhs);
 }
 
+struct ContinuationSampleTag {};
+
 } // namespace async_simple::detail
 
 /// FutureState是Future和Promise之间的共享状态
 /// FutureState是Future/Promise模型的关键组件，它保证了线程安全性，以及会在需要的时候调用executor
 template<typename T>
 class FutureState : noncopyable {
-  using Continuation = std::function<void(Try<T> &&value)>;
+  using Continuation = BasicTask<void(Try<T> &&value)>;
 
   class ContinuationReference {
    public:
@@ -47,13 +53,34 @@ class FutureState : noncopyable {
         : fs_(other.fs_) {
       Attach();
     }
-    ContinuationReference(ContinuationReference &&other) noexcept: fs_(std::exchange(other.fs_, nullptr)) {}
+    ContinuationReference(ContinuationReference &&other) noexcept
+        : fs_(std::exchange(other.fs_, nullptr))
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+        , scheduled_ns_(other.scheduled_ns_)
+#endif
+    {}
 
     ContinuationReference &operator=(const ContinuationReference &) = delete;
     ContinuationReference &operator=(ContinuationReference &&) = delete;
 
     FutureState *GetFutureState() const noexcept { return fs_; }
 
+    /// 调度continuation之前调用，continuation开始执行时调用RecordDelay把延迟记录到Executor中。
+    /// 只记录被采样的continuation，定义了ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM时什么也不做
+    void MarkScheduled() noexcept {
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+      scheduled_ns_ = util::LatencySampler::Sample<detail::ContinuationSampleTag>();
+#endif
+    }
+    void RecordDelay() const {
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+      if (scheduled_ns_ != 0) UNLIKELY {
+        fs_->executor_->RecordContinuationDelay(
+            std::chrono::nanoseconds(util::LatencySampler::Since(scheduled_ns_)));
+      }
+#endif
+    }
+
    private:
     void Attach() {
       if (fs_) {
@@ -69,35 +96,55 @@ class FutureState : noncopyable {
     }
 
     FutureState *fs_{nullptr};
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+    int64_t scheduled_ns_{0};
+#endif
   };
  public:
   FutureState()
-      : state_(detail::State::kStart),
+      : state_(static_cast<uint8_t>(detail::State::kStart)),
+        force_scheduled(false),
         attached_(0),
         continuation_ref_(0),
         promise_ref_(0),
-        force_scheduled(false),
         executor_(nullptr),
         context_(Executor::kNullContext) {}
   ~FutureState() {}
 
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+  /// 和协程帧一样从线程本地的size class缓存中分配，超过默认对齐的类型仍然使用全局的operator new
+  static void *operator new(std::size_t size) {
+    if constexpr (kOverAligned) {
+      return ::operator new(size, std::align_val_t(alignof(FutureState)));
+    } else {
+      return util::FramePool::Allocate(size);
+    }
+  }
+  static void operator delete(void *ptr) noexcept {
+    if constexpr (kOverAligned) {
+      ::operator delete(ptr, std::align_val_t(alignof(FutureState)));
+    } else {
+      util::FramePool::Deallocate(ptr);
+    }
+  }
+#endif
+
   [[nodiscard]] bool HasResult() const noexcept {
-    constexpr auto allow = detail::State::kDone | detail::State::kOnlyResult;
-    auto state = state_.load(std::memory_order_acquire);
-    return (state & allow) != detail::State{};
+    auto state = LoadState(std::memory_order_acquire);
+    return (state & detail::State::kOnlyResult) != detail::State{};
   }
 
   bool HasContinuation() const noexcept {
-    constexpr auto allow = detail::State::kDone | detail::State::kOnlyContinuation;
-    auto state = state_.load(std::memory_order_acquire);
-    return (state & allow) != detail::State{};
+    auto state = LoadState(std::memory_order_acquire);
+    return (state & detail::State::kOnlyContinuation) != detail::State{};
   }
 
   FORCE_INLINE void AttachOne() {
     attached_.fetch_add(1, std::memory_order_relaxed);
   }
+  /// 最后一个引用释放时删除，release保证之前对状态的修改都发生在delete之前
   FORCE_INLINE void DetachOne() {
-    auto old = attached_.fetch_sub(1, std::memory_order_relaxed);
+    auto old = attached_.fetch_sub(1, std::memory_order_acq_rel);
     ASSERT(old >= 1u);
     if (old == 1) {
       delete this;
@@ -108,7 +155,7 @@ class FutureState : noncopyable {
     AttachOne();
   }
   FORCE_INLINE void DetachPromise() {
-    auto old = promise_ref_.fetch_sub(1, std::memory_order_relaxed);
+    auto old = promise_ref_.fetch_sub(1, std::memory_order_acq_rel);
     ASSERT(old >= 1u);
     if (!HasResult() && old == 1) {
       try {
@@ -143,60 +190,35 @@ class FutureState : noncopyable {
   void SetResult(Try<T> &&value) {
     LOGIC_ASSERT(!HasResult(), "FutureState already has a result");
     try_value_ = std::move(value);
+    // release发布try_value_，acquire看到对方设置的continuation_
+    auto old = FetchOrState(detail::State::kOnlyResult);
+    LOGIC_ASSERT((old & detail::State::kOnlyResult) == detail::State{}, "State Transfer Error");
+    if ((old & detail::State::kWaiting) != detail::State{}) {
+      // 等待的Future持有引用，被唤醒之后FutureState也不会在这里被删除
+      state_.notify_all();
+    }
+    if ((old & detail::State::kOnlyContinuation) != detail::State{}) {
+      ScheduleContinuation(false);
+    }
+  }
 
-    auto state = state_.load(std::memory_order_acquire);
-    switch (state) {
-      case detail::State::kStart:
-        if (state_.compare_exchange_strong(state,
-                                           detail::State::kOnlyResult,
-                                           std::memory_order_release)) {
-          return;
-        }
-        /// 状态已经转移
-        ASSERT(state_.load(std::memory_order_relaxed) == detail::State::kOnlyContinuation);
-        [[fallthrough]];
-      case detail::State::kOnlyContinuation:
-        if (state_.compare_exchange_strong(state,
-                                           detail::State::kDone,
-                                           std::memory_order_release)) {
-          ScheduleContinuation(false);
-          return;
-        }
-        [[fallthrough]];
-      default:
-        LOGIC_ASSERT(false, "State Transfer Error");
+  /// 阻塞当前线程直到有结果，直接等待在state_上，不需要额外的continuation和FutureState
+  void Wait() {
+    auto state = FetchOrState(detail::State::kWaiting) | detail::State::kWaiting;
+    while ((state & detail::State::kOnlyResult) == detail::State{}) {
+      state_.wait(static_cast<uint8_t>(state), std::memory_order_acquire);
+      state = LoadState(std::memory_order_acquire);
     }
   }
 
   template<typename F>
   void SetContinuation(F &&func) {
     LOGIC_ASSERT(!HasContinuation(), "FutureState already has a continuation");
-    MoveWrapper<F> lambda_func(std::move(func));
-    new(&continuation_) Continuation([lambda_func](Try<T> &&v) mutable {
-      auto &f = lambda_func.Get();
-      f(std::forward<Try<T>>(v));
-    });
-
-    auto state = state_.load(std::memory_order_acquire);
-    switch (state) {
-      case detail::State::kStart:
-        if (state_.compare_exchange_strong(state,
-                                           detail::State::kOnlyContinuation)) {
-          return;
-        }
-        // 状态已经改变
-        ASSERT(state_.load(std::memory_order_relaxed) == detail::State::kOnlyResult);
-        [[fallthrough]];
-      case detail::State::kOnlyResult:
-        if (state_.compare_exchange_strong(state,
-                                           detail::State::kDone,
-                                           std::memory_order_release)) {
-          ScheduleContinuation(true);
-          return;
-        }
-        [[fallthrough]];
-      default:
-        LOGIC_ASSERT(false, "State Transfer Error");
+    new(&continuation_) Continuation(std::forward<F>(func));
+    auto old = FetchOrState(detail::State::kOnlyContinuation);
+    LOGIC_ASSERT((old & detail::State::kOnlyContinuation) == detail::State{}, "State Transfer Error");
+    if ((old & detail::State::kOnlyResult) != detail::State{}) {
+      ScheduleContinuation(true);
     }
   }
 
@@ -209,7 +231,7 @@ class FutureState : noncopyable {
 
  private:
   void ScheduleContinuation(bool trigger_by_continuation) {
-    LOGIC_ASSERT(state_.load(std::memory_order_relaxed) == detail::State::kDone,
+    LOGIC_ASSERT((LoadState(std::memory_order_relaxed) & detail::State::kDone) == detail::State::kDone,
                  "FutureState is not done");
     if (!force_scheduled && (!executor_ || trigger_by_continuation || CurrentThreadInExecutor())) {
       // 立即执行
@@ -218,16 +240,21 @@ class FutureState : noncopyable {
     } else {
       ContinuationReference guard(this);
       ContinuationReference guard_for_exception(this);
+      guard.MarkScheduled();
       bool ret;
+      // continuation在设置结果的线程上接着执行，保持缓存局部性
+      ScheduleOptions options;
+      options.next = true;
       if (context_ == Executor::kNullContext) {
         ret = executor_->Schedule([ref = std::move(guard)]() mutable {
+          ref.RecordDelay();
           FutureState *fs = ref.GetFutureState();
           fs->continuation_(std::move(fs->try_value_));
-        });
+        }, options);
       } else {
-        ScheduleOptions options;
         options.prompt = !force_scheduled;
         ret = executor_->Checkin([ref = std::move(guard)]() mutable {
+          ref.RecordDelay();
           auto fs = ref.GetFutureState();
           fs->continuation_(std::move(fs->try_value_));
         }, context_, options);
@@ -239,22 +266,31 @@ class FutureState : noncopyable {
     }
   }
 
+  detail::State LoadState(std::memory_order order) const noexcept {
+    return static_cast<detail::State>(state_.load(order));
+  }
+  detail::State FetchOrState(detail::State bit) noexcept {
+    return static_cast<detail::State>(state_.fetch_or(static_cast<uint8_t>(bit), std::memory_order_acq_rel));
+  }
+
   void RefContinuation() {
     continuation_ref_.fetch_add(1, std::memory_order_relaxed);
   }
   void DerefContinuation() {
-    auto old = continuation_ref_.fetch_sub(1, std::memory_order_relaxed);
+    auto old = continuation_ref_.fetch_sub(1, std::memory_order_acq_rel);
     ASSERT(old >= 1);
     if (old == 1) {
       continuation_.~Continuation();
     }
   }
 
-  std::atomic<detail::State> state_;
-  std::atomic<uint8_t> attached_;
-  std::atomic<uint8_t> continuation_ref_;
-  std::atomic<std::size_t> promise_ref_;
+  static constexpr bool kOverAligned = alignof(Try<T>) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+  std::atomic<uint8_t> state_;  ///< detail::State，用整数类型才能使用fetch_or
   bool force_scheduled;
+  std::atomic<uint32_t> attached_;  ///< 被大量Future拷贝、continuation引用时也不会溢出
+  std::atomic<uint32_t> continuation_ref_;
+  std::atomic<uint32_t> promise_ref_;
 
   Try<T> try_value_;
   union {
@@ -11,7 +11,7 @@ namespace async_simple {
 /// LocalState在Future和Promise断开后依然是有效的
 template<typename T>
 class LocalState : noncopyable {
-  using Continuation = std::function<void(Try<T> &&value)>;
+  using Continuation = BasicTask<void(Try<T> &&value)>;
  public:
   LocalState() : executor_(nullptr) {}
   LocalState(T &&v) : try_value_(std::forward<T>(v)), executor_(nullptr) {}
@@ -34,14 +34,17 @@ class Promise {
     return *this;
   }
 
-  Promise(Promise &&other)
+  Promise(Promise &&other) noexcept
       : shared_state_(std::exchange(other.shared_state_, nullptr)),
         has_future_(std::exchange(other.has_future_, false)) {
   }
 
   Promise &operator=(Promise &&other) {
-    shared_state_ = std::exchange(other.shared_state_, nullptr);
-    has_future_ = std::exchange(other.has_future_, false);
+    if (this != &other) {
+      this->~Promise();
+      shared_state_ = std::exchange(other.shared_state_, nullptr);
+      has_future_ = std::exchange(other.has_future_, false);
+    }
     return *this;
   }
 
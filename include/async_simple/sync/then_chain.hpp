@@ -0,0 +1,280 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_SYNC_THEN_CHAIN_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_SYNC_THEN_CHAIN_HPP_
+
+#include "async_simple/base/try.hpp"
+#include "async_simple/executor/executor.hpp"
+#include "async_simple/util/frame_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace async_simple {
+
+template<typename T>
+class Promise;
+
+namespace detail {
+
+class ThenChain;
+
+/// 链上的一个阶段，由ThenChain统一析构
+class StageNode {
+ public:
+  virtual ~StageNode() = default;
+ private:
+  friend class ThenChain;
+  StageNode *older_{nullptr};
+};
+
+/// 以Try<T>为输入的阶段，每条Run路径最后都恰好释放一次chain的运行引用
+template<typename T>
+class StageInput : public StageNode {
+ public:
+  virtual void Run(ThenChain *chain, Try<T> &&value) = 0;
+};
+
+/// 产生Try<T>的阶段，也就是链的尾部
+/// 只有尾部需要和上游同步：执行的一方发现还没有下一个阶段时把结果留在slot_中并停下，
+/// 持有Future的一方追加阶段时如果发现已经停下，就在当前线程接着执行，
+/// 两者通过一次compare_exchange决定谁负责执行下一个阶段
+template<typename T>
+class StageOutput {
+ public:
+  bool HasResult() const noexcept {
+    return next_.load(std::memory_order_acquire) == Parked();
+  }
+  Try<T> &GetTry() noexcept { return slot_; }
+  const Try<T> &GetTry() const noexcept { return slot_; }
+
+  /// 追加下一个阶段，只能由持有Future的一方调用
+  void Link(ThenChain *chain, StageInput<T> *stage);
+
+ protected:
+  /// 把结果交给下一个阶段，只能由执行链的一方调用
+  void Emit(ThenChain *chain, Try<T> &&value);
+
+ private:
+  static StageInput<T> *Parked() noexcept {
+    return reinterpret_cast<StageInput<T> *>(alignof(StageInput<T>));
+  }
+
+  std::atomic<StageInput<T> *> next_{nullptr};
+  Try<T> slot_;
+};
+
+/// 一串还没有开始执行的ThenValue/ThenTry
+/// - 整条链只在上游的FutureState上挂一个continuation，所有阶段在同一个continuation中依次执行，
+///   中间不再创建Promise和FutureState，也不会再经过executor调度
+/// - 阶段按顺序放在链自带的内存中，用完之后再从FramePool中申请更大的块，
+///   链销毁时统一析构
+/// - 两个引用：持有尾部的Future和执行链的一方，都释放之后删除
+class ThenChain : noncopyable {
+ public:
+  explicit ThenChain(Executor *executor) noexcept
+      : refs_(2),
+        executor_(executor),
+        cur_(inline_),
+        end_(inline_ + kInlineSize) {}
+
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+  static void *operator new(std::size_t size) {
+    return util::FramePool::Allocate(size);
+  }
+  static void operator delete(void *ptr) noexcept {
+    util::FramePool::Deallocate(ptr);
+  }
+#endif
+
+  Executor *GetExecutor() const noexcept { return executor_; }
+
+  /// 在链的内存中构造一个阶段，只能由持有Future的一方调用
+  template<typename Stage, typename... Args>
+  Stage *Emplace(Args &&...args) {
+    auto stage = new(Bump(sizeof(Stage), alignof(Stage))) Stage(std::forward<Args>(args)...);
+    static_cast<StageNode *>(stage)->older_ = newest_;
+    newest_ = stage;
+    return stage;
+  }
+
+  void Retain() noexcept { refs_.fetch_add(1, std::memory_order_relaxed); }
+  void Release() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+ private:
+  static constexpr std::size_t kInlineSize = 512;
+  /// 不超过FramePool缓存的最大size class，长链反复创建时也不会回到全局的operator new
+  static constexpr std::size_t kMaxBlockSize =
+      util::FramePool::kClassSize * (util::FramePool::kNumClasses - 1);
+
+  struct Block {
+    Block *next;
+    std::size_t size;
+  };
+
+  ~ThenChain() {
+    while (newest_) {
+      std::exchange(newest_, newest_->older_)->~StageNode();
+    }
+    while (blocks_) {
+      FreeBlock(std::exchange(blocks_, blocks_->next));
+    }
+  }
+
+  void *Bump(std::size_t size, std::size_t align) {
+    auto p = AlignUp(cur_, align);
+    if (p + size > end_) UNLIKELY {
+      // 每块的大小翻倍直到kMaxBlockSize，特别大的阶段单独占一块
+      std::size_t last = blocks_ ? blocks_->size : kInlineSize;
+      std::size_t bytes = std::max(std::min(last * 2, kMaxBlockSize), sizeof(Block) + size + align);
+      auto block = AllocateBlock(bytes);
+      block->next = blocks_;
+      block->size = bytes;
+      blocks_ = block;
+      cur_ = reinterpret_cast<std::byte *>(block + 1);
+      end_ = reinterpret_cast<std::byte *>(block) + bytes;
+      p = AlignUp(cur_, align);
+    }
+    cur_ = p + size;
+    return p;
+  }
+
+  static std::byte *AlignUp(std::byte *p, std::size_t align) noexcept {
+    auto value = reinterpret_cast<std::uintptr_t>(p);
+    return p + ((align - value % align) % align);
+  }
+
+  static Block *AllocateBlock(std::size_t bytes) {
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+    return static_cast<Block *>(util::FramePool::Allocate(bytes));
+#else
+    return static_cast<Block *>(::operator new(bytes));
+#endif
+  }
+  static void FreeBlock(Block *block) noexcept {
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+    util::FramePool::Deallocate(block);
+#else
+    ::operator delete(block);
+#endif
+  }
+
+  std::atomic<uint32_t> refs_;
+  Executor *const executor_;
+  StageNode *newest_{nullptr};
+  Block *blocks_{nullptr};
+  std::byte *cur_;
+  std::byte *end_;
+  alignas(std::max_align_t) std::byte inline_[kInlineSize];
+};
+
+template<typename T>
+void StageOutput<T>::Emit(ThenChain *chain, Try<T> &&value) {
+  auto next = next_.load(std::memory_order_acquire);
+  if (!next) {
+    // release发布slot_，失败时acquire看到对方构造好的下一个阶段
+    slot_ = std::move(value);
+    if (next_.compare_exchange_strong(next, Parked(), std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+      chain->Release();
+      return;
+    }
+    next->Run(chain, std::move(slot_));
+    return;
+  }
+  next->Run(chain, std::move(value));
+}
+
+template<typename T>
+void StageOutput<T>::Link(ThenChain *chain, StageInput<T> *stage) {
+  StageInput<T> *expected = nullptr;
+  if (next_.compare_exchange_strong(expected, stage, std::memory_order_acq_rel,
+                                    std::memory_order_acquire)) {
+    return;
+  }
+  ASSERT(expected == Parked());
+  // 链已经在这里停下，由当前线程接着执行，和在已有结果的FutureState上设置continuation一样
+  next_.store(stage, std::memory_order_relaxed);
+  chain->Retain();
+  stage->Run(chain, std::move(slot_));
+}
+
+/// ThenValue/ThenTry的一个阶段，F不返回Future
+/// func_在执行之后立即析构，和单独的continuation一样，捕获的资源不会一直保留到整条链删除
+template<typename In, typename Out, typename F, bool kIsTry>
+class ThenStage final : public StageInput<In>, public StageOutput<Out> {
+ public:
+  template<typename G>
+  explicit ThenStage(G &&func) : func_(std::in_place, std::forward<G>(func)) {}
+
+  void Run(ThenChain *chain, Try<In> &&value) override {
+    if constexpr (!kIsTry) {
+      if (value.HasException()) {
+        func_.reset();
+        this->Emit(chain, Try<Out>(value.GetException()));
+        return;
+      }
+    }
+    Try<Out> result = MakeTryCall(std::move(*func_), std::move(value));
+    // Emit之后链可能已经被删除
+    func_.reset();
+    this->Emit(chain, std::move(result));
+  }
+
+ private:
+  std::optional<F> func_;
+};
+
+/// 链的终点，把结果交给Promise，链从这里重新回到FutureState上
+template<typename T>
+class PromiseStage final : public StageInput<T> {
+ public:
+  explicit PromiseStage(Promise<T> &&promise) : promise_(std::move(promise)) {}
+
+  void Run(ThenChain *chain, Try<T> &&value) override {
+    promise_.SetValue(std::move(value));
+    chain->Release();
+  }
+
+ private:
+  Promise<T> promise_;
+};
+
+/// 挂在上游FutureState上的continuation，持有链的运行引用
+/// 没有被调用就销毁时释放引用，链上的Promise随链一起析构，下游会得到Promise is broken
+template<typename T>
+class ChainEntry {
+ public:
+  ChainEntry(ThenChain *chain, StageInput<T> *head) noexcept : chain_(chain), head_(head) {}
+  ChainEntry(ChainEntry &&other) noexcept
+      : chain_(std::exchange(other.chain_, nullptr)), head_(other.head_) {}
+  ChainEntry(const ChainEntry &) = delete;
+  ChainEntry &operator=(const ChainEntry &) = delete;
+  ChainEntry &operator=(ChainEntry &&) = delete;
+  ~ChainEntry() {
+    if (chain_) {
+      chain_->Release();
+    }
+  }
+
+  void operator()(Try<T> &&value) {
+    head_->Run(std::exchange(chain_, nullptr), std::move(value));
+  }
+
+ private:
+  ThenChain *chain_;
+  StageInput<T> *head_;
+};
+
+} // namespace async_simple::detail
+
+} // namespace async_simple
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_SYNC_THEN_CHAIN_HPP_
@@ -0,0 +1,75 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_EVENT_COUNT_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_EVENT_COUNT_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#include "async_simple/base/macro.hpp"
+#include "async_simple/base/noncopyable.hpp"
+
+namespace async_simple::util {
+
+/// 把"检查条件-休眠"变成无锁的两阶段操作，条件本身由调用方维护
+/// ```
+/// auto key = event.PrepareWait();
+/// if (HasWork()) {
+///   event.CancelWait();
+/// } else {
+///   event.Wait(key);
+/// }
+/// // 另一个线程
+/// PushWork();
+/// event.Notify();
+/// ```
+/// - Notify在没有等待者时只有一次fence和一次load，不会进入内核
+/// - 休眠使用std::atomic::wait，Linux上是futex，不需要mutex和condition_variable
+/// - PrepareWait之后发生的Notify一定会让Wait返回，所以条件检查和Wait之间不会丢失唤醒
+class EventCount : noncopyable {
+ public:
+  using Key = uint32_t;
+
+  /// 登记为等待者，之后检查条件，满足时调用CancelWait，否则调用Wait
+  Key PrepareWait() noexcept {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_seq_cst);
+  }
+  void CancelWait() noexcept { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+  /// 休眠直到PrepareWait之后有Notify
+  void Wait(Key key) noexcept {
+    while (epoch_.load(std::memory_order_acquire) == key) {
+      epoch_.wait(key, std::memory_order_acquire);
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /// 调用前需要已经发布了让条件成立的修改
+  void Notify() noexcept { DoNotify(false); }
+  void NotifyAll() noexcept { DoNotify(true); }
+
+  [[nodiscard]] bool HasWaiters() const noexcept {
+    return waiters_.load(std::memory_order_relaxed) != 0;
+  }
+
+ private:
+  void DoNotify(bool all) noexcept {
+    // 与PrepareWait配对：要么这里看到等待者，要么等待者在PrepareWait之后看到条件已经成立
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) LIKELY {
+      return;
+    }
+    epoch_.fetch_add(1, std::memory_order_release);
+    if (all) {
+      epoch_.notify_all();
+    } else {
+      epoch_.notify_one();
+    }
+  }
+
+  std::atomic<Key> epoch_{0};
+  std::atomic<uint32_t> waiters_{0};
+};
+
+} // namespace async_simple::util
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_EVENT_COUNT_HPP_
@@ -0,0 +1,283 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_FRAME_POOL_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_FRAME_POOL_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "async_simple/base/macro.hpp"
+#include "async_simple/base/noncopyable.hpp"
+
+namespace async_simple::util {
+
+struct FramePoolStats {
+  uint64_t allocs{0};        ///< 分配的次数
+  uint64_t frees{0};         ///< 释放的次数
+  uint64_t cache_hits{0};    ///< 直接从线程缓存中拿到内存的次数
+  uint64_t remote_frees{0};  ///< 在分配线程之外的线程上释放的次数
+  uint64_t oversize{0};      ///< 超过最大的size class，直接使用operator new的次数
+};
+
+/// 协程帧的内存池，FutureState和CollectAll的共享状态也从这里分配
+/// - 按kClassSize划分size class，每个线程为每个size class缓存一个空闲链表，分配和释放都不需要同步
+/// - 每块内存的头部记录了分配它的线程缓存，在其他线程上释放时，放回所属线程缓存的无锁链表中，
+///   所属线程在本地链表为空时一次性取回
+/// - 线程退出时，仍有内存在外面的线程缓存会留到最后一块内存归还时再删除
+class FramePool {
+ public:
+  static constexpr std::size_t kClassSize = 64;
+  static constexpr std::size_t kNumClasses = 32;
+  static constexpr std::size_t kMaxCached = 256;  ///< 每个size class最多缓存的空闲块数
+
+  static void *Allocate(std::size_t size) {
+    std::size_t cls = (size + sizeof(Header) - 1) / kClassSize;
+    ThreadCache *cache = ThreadCache::Local();
+    if (cls < kNumClasses && cache) LIKELY {
+      return cache->Allocate(cls);
+    }
+    if (cache) {
+      ThreadCache::Inc(cache->stats_.allocs);
+      ThreadCache::Inc(cache->stats_.oversize);
+    }
+    auto header = static_cast<Header *>(::operator new(size + sizeof(Header)));
+    header->owner = nullptr;
+    header->size_class = kNumClasses;
+    return header + 1;
+  }
+
+  static void Deallocate(void *ptr) noexcept {
+    auto header = static_cast<Header *>(ptr) - 1;
+    ThreadCache *cache = ThreadCache::Local();
+    if (header->owner == cache && cache) LIKELY {
+      cache->LocalFree(header);
+      return;
+    }
+    if (cache) {
+      ThreadCache::Inc(cache->stats_.frees);
+    }
+    if (!header->owner) {
+      ::operator delete(header);
+      return;
+    }
+    if (cache) {
+      ThreadCache::Inc(cache->stats_.remote_frees);
+    }
+    header->owner->RemoteFree(header);
+  }
+
+  /// 所有线程的统计之和，包括已经退出的线程
+  static FramePoolStats GetStats() {
+    auto &registry = Registry::Instance();
+    std::lock_guard lg(registry.mutex);
+    FramePoolStats stats = registry.retired;
+    for (auto cache : registry.caches) {
+      cache->AddStatsTo(stats);
+    }
+    return stats;
+  }
+
+ private:
+  class ThreadCache;
+
+  struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Header {
+    ThreadCache *owner;
+    std::size_t size_class;
+  };
+
+  /// 空闲链表的next指针放在头部之后，头部始终保持有效
+  static Header *&Next(Header *header) noexcept {
+    return *reinterpret_cast<Header **>(header + 1);
+  }
+
+  struct Registry {
+    static Registry &Instance() {
+      static Registry registry;
+      return registry;
+    }
+
+    std::mutex mutex;
+    std::vector<ThreadCache *> caches;
+    FramePoolStats retired;
+  };
+
+  class ThreadCache : noncopyable {
+   public:
+    using Counter = std::atomic<uint64_t>;
+
+    struct Stats {
+      Counter allocs{0};
+      Counter frees{0};
+      Counter cache_hits{0};
+      Counter remote_frees{0};
+      Counter oversize{0};
+    };
+
+    /// 只有所属线程会修改，用load + store避免原子的读改写，其他线程只读取统计值
+    static void Inc(Counter &counter) noexcept {
+      counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static ThreadCache *Local() {
+      if (tls_cache_) LIKELY {
+        return tls_cache_;
+      }
+      return SlowLocal();
+    }
+
+    void *Allocate(std::size_t cls) {
+      Inc(stats_.allocs);
+      if (!free_[cls]) {
+        DrainRemote();
+      }
+      Header *header = free_[cls];
+      if (header) {
+        Inc(stats_.cache_hits);
+        free_[cls] = Next(header);
+        --free_count_[cls];
+      } else {
+        header = static_cast<Header *>(::operator new((cls + 1) * kClassSize));
+        header->owner = this;
+        header->size_class = cls;
+      }
+      ++owned_;
+      return header + 1;
+    }
+
+    void LocalFree(Header *header) noexcept {
+      Inc(stats_.frees);
+      --owned_;
+      Cache(header);
+    }
+
+    void RemoteFree(Header *header) noexcept {
+      auto head = remote_.load(std::memory_order_relaxed);
+      do {
+        if (head == Orphaned()) {
+          ::operator delete(header);
+          if (orphan_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+          }
+          return;
+        }
+        Next(header) = head;
+      } while (!remote_.compare_exchange_weak(head, header, std::memory_order_release,
+                                              std::memory_order_relaxed));
+    }
+
+    void AddStatsTo(FramePoolStats &stats) const {
+      stats.allocs += stats_.allocs.load(std::memory_order_relaxed);
+      stats.frees += stats_.frees.load(std::memory_order_relaxed);
+      stats.cache_hits += stats_.cache_hits.load(std::memory_order_relaxed);
+      stats.remote_frees += stats_.remote_frees.load(std::memory_order_relaxed);
+      stats.oversize += stats_.oversize.load(std::memory_order_relaxed);
+    }
+
+    Stats stats_;
+
+   private:
+    /// 线程退出后remote_被设置为这个值，之后归还的内存直接释放
+    static Header *Orphaned() noexcept { return reinterpret_cast<Header *>(alignof(Header)); }
+
+    static ThreadCache *SlowLocal() {
+      // thread_local的析构之后不能再访问holder，用平凡析构的tls_dead_判断
+      if (tls_dead_) {
+        return nullptr;
+      }
+      static thread_local struct Holder {
+        ~Holder() {
+          tls_dead_ = true;
+          tls_cache_ = nullptr;
+          if (cache) {
+            cache->Orphan();
+          }
+        }
+        ThreadCache *cache{nullptr};
+      } holder;
+      auto cache = new ThreadCache();
+      {
+        auto &registry = Registry::Instance();
+        std::lock_guard lg(registry.mutex);
+        registry.caches.push_back(cache);
+      }
+      holder.cache = cache;
+      tls_cache_ = cache;
+      return cache;
+    }
+
+    void Cache(Header *header) noexcept {
+      auto cls = header->size_class;
+      if (free_count_[cls] >= kMaxCached) {
+        ::operator delete(header);
+        return;
+      }
+      Next(header) = free_[cls];
+      free_[cls] = header;
+      ++free_count_[cls];
+    }
+
+    void DrainRemote() noexcept {
+      if (!remote_.load(std::memory_order_relaxed)) {
+        return;
+      }
+      Header *header = remote_.exchange(nullptr, std::memory_order_acquire);
+      while (header) {
+        auto next = Next(header);
+        --owned_;
+        Cache(header);
+        header = next;
+      }
+    }
+
+    void Orphan() {
+      {
+        auto &registry = Registry::Instance();
+        std::lock_guard lg(registry.mutex);
+        AddStatsTo(registry.retired);
+        std::erase(registry.caches, this);
+      }
+      for (std::size_t cls = 0; cls < kNumClasses; ++cls) {
+        FreeList(free_[cls]);
+        free_[cls] = nullptr;
+      }
+      Header *header = remote_.exchange(Orphaned(), std::memory_order_acq_rel);
+      while (header) {
+        --owned_;
+        header = FreeOne(header);
+      }
+      // 之后的远程释放会把orphan_count_减一，加上还在外面的块数之后归零的一方负责删除
+      // fetch_add之后this可能已经被删除，不能再访问成员
+      auto owned = owned_;
+      if (orphan_count_.fetch_add(owned, std::memory_order_acq_rel) + owned == 0) {
+        delete this;
+      }
+    }
+
+    static void FreeList(Header *header) noexcept {
+      while (header) {
+        header = FreeOne(header);
+      }
+    }
+    static Header *FreeOne(Header *header) noexcept {
+      auto next = Next(header);
+      ::operator delete(header);
+      return next;
+    }
+
+    static inline thread_local ThreadCache *tls_cache_ = nullptr;
+    static inline thread_local bool tls_dead_ = false;
+
+    std::array<Header *, kNumClasses> free_{};
+    std::array<std::size_t, kNumClasses> free_count_{};
+    int64_t owned_{0};  ///< 分配出去还没有回到本地链表的块数，只有所属线程修改
+    std::atomic<Header *> remote_{nullptr};
+    std::atomic<int64_t> orphan_count_{0};
+  };
+};
+
+} // namespace async_simple::util
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_FRAME_POOL_HPP_
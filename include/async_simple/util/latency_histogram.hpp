@@ -0,0 +1,157 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_LATENCY_HISTOGRAM_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_LATENCY_HISTOGRAM_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "async_simple/base/macro.hpp"
+#include "async_simple/base/noncopyable.hpp"
+
+namespace async_simple::util {
+
+/// 按线程计数的采样器，每kInterval次调用返回一次当前时间(纳秒)，其余返回0，
+/// 避免在每个任务上都读时钟
+struct LatencySampler {
+  static constexpr uint32_t kInterval = 64;
+
+  static int64_t Now() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /// 不同的Tag使用各自的计数，避免一个操作中依次调用的两处采样总是互相错开
+  template<typename Tag = void>
+  static int64_t Sample() noexcept {
+    static thread_local uint32_t count = 0;
+    if (++count % kInterval != 0) LIKELY {
+      return 0;
+    }
+    return Now();
+  }
+
+  /// 从采样的时间到现在经过的纳秒数
+  static uint64_t Since(int64_t start) noexcept {
+    return static_cast<uint64_t>(std::max<int64_t>(Now() - start, 0));
+  }
+};
+
+/// 对数分桶的延迟直方图(HdrHistogram的分桶方式)，单位是纳秒
+/// - 小于2^kSubBucketBits的值每个值一个桶；之后每个2的幂区间分成2^(kSubBucketBits-1)个桶，
+///   相对误差不超过1/2^(kSubBucketBits-1)，约3%
+/// - 只允许一个线程调用Record，用load + store避免原子的读改写；其他线程可以随时AddTo读取，
+///   多个线程各自的直方图合并到Snapshot中，不需要加锁
+class LatencyHistogram : noncopyable {
+ public:
+  static constexpr unsigned kSubBucketBits = 5;
+  static constexpr unsigned kMaxBits = 40;  ///< 超过2^40ns(约18分钟)的值记录到最后一个桶
+  static constexpr uint64_t kMaxValue = (uint64_t{1} << kMaxBits) - 1;
+  static constexpr std::size_t kSubBucketCount = std::size_t{1} << kSubBucketBits;
+  static constexpr std::size_t kHalfSubBucketCount = kSubBucketCount / 2;
+  static constexpr std::size_t kBucketCount =
+      kSubBucketCount + (kMaxBits - kSubBucketBits) * kHalfSubBucketCount;
+
+  static std::size_t BucketIndex(uint64_t value) noexcept {
+    value = std::min(value, kMaxValue);
+    if (value < kSubBucketCount) {
+      return value;
+    }
+    unsigned shift = std::bit_width(value) - kSubBucketBits;
+    auto top = value >> shift;  // [kHalfSubBucketCount, kSubBucketCount)
+    return kSubBucketCount + (shift - 1) * kHalfSubBucketCount + (top - kHalfSubBucketCount);
+  }
+  /// 桶中最小的值
+  static uint64_t BucketLowerBound(std::size_t index) noexcept {
+    if (index < kSubBucketCount) {
+      return index;
+    }
+    auto k = index - kSubBucketCount;
+    auto shift = k / kHalfSubBucketCount + 1;
+    return (k % kHalfSubBucketCount + kHalfSubBucketCount) << shift;
+  }
+  /// 桶中最大的值
+  static uint64_t BucketUpperBound(std::size_t index) noexcept {
+    if (index + 1 == kBucketCount) {
+      return kMaxValue;
+    }
+    return BucketLowerBound(index + 1) - 1;
+  }
+
+  /// 合并之后的直方图，不是线程安全的
+  class Snapshot {
+   public:
+    void Add(uint64_t value, uint64_t n = 1) noexcept {
+      counts_[BucketIndex(value)] += n;
+      count_ += n;
+      max_ = std::max(max_, std::min(value, kMaxValue));
+    }
+    void Merge(const Snapshot &other) noexcept {
+      for (std::size_t i = 0; i < kBucketCount; ++i) {
+        counts_[i] += other.counts_[i];
+      }
+      count_ += other.count_;
+      max_ = std::max(max_, other.max_);
+    }
+
+    [[nodiscard]] uint64_t Count() const noexcept { return count_; }
+    [[nodiscard]] uint64_t Max() const noexcept { return max_; }
+
+    /// q在[0, 1]之间，返回所在桶的上界(不超过记录过的最大值)，没有记录时返回0
+    [[nodiscard]] uint64_t Percentile(double q) const noexcept {
+      if (count_ == 0) {
+        return 0;
+      }
+      auto rank = static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(count_));
+      rank = std::clamp<uint64_t>(rank, 1, count_);
+      uint64_t seen = 0;
+      for (std::size_t i = 0; i < kBucketCount; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+          return std::min(BucketUpperBound(i), max_);
+        }
+      }
+      return max_;
+    }
+
+   private:
+    friend class LatencyHistogram;
+
+    std::array<uint64_t, kBucketCount> counts_{};
+    uint64_t count_{0};
+    uint64_t max_{0};
+  };
+
+  LatencyHistogram() = default;
+
+  /// 只能由所属的线程调用
+  void Record(uint64_t value) noexcept {
+    auto &bucket = buckets_[BucketIndex(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    value = std::min(value, kMaxValue);
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  /// 可以在任意线程调用，和Record并发时结果可能少算正在记录的值
+  void AddTo(Snapshot &snapshot) const noexcept {
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+      auto n = buckets_[i].load(std::memory_order_relaxed);
+      snapshot.counts_[i] += n;
+      snapshot.count_ += n;
+    }
+    snapshot.max_ = std::max(snapshot.max_, max_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+  std::atomic<uint64_t> max_{0};
+};
+
+} // namespace async_simple::util
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_LATENCY_HISTOGRAM_HPP_
@@ -0,0 +1,43 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_SPIN_LOCK_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_SPIN_LOCK_HPP_
+
+#include "async_simple/base/macro.hpp"
+#include "async_simple/base/noncopyable.hpp"
+
+#include <atomic>
+#include <thread>
+
+namespace async_simple::util {
+
+/// 用于保护极短临界区(几次指针操作)的自旋锁，自旋一段时间后让出CPU
+/// 方法名和std::mutex保持一致，满足BasicLockable，可以配合std::lock_guard使用
+class SpinLock : noncopyable {
+ public:
+  static constexpr int kSpinCount = 64;
+
+  void lock() noexcept {
+    while (true) {
+      if (!locked_.exchange(true, std::memory_order_acquire)) LIKELY {
+        return;
+      }
+      for (int i = 0; locked_.load(std::memory_order_relaxed); ++i) {
+        if (i >= kSpinCount) {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  bool try_lock() noexcept {
+    return !locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire);
+  }
+
+  void unlock() noexcept { locked_.store(false, std::memory_order_release); }
+
+ private:
+  std::atomic<bool> locked_{false};
+};
+
+} // namespace async_simple::util
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_SPIN_LOCK_HPP_
@@ -1,18 +1,74 @@
 #ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_THREAD_POOL_HPP_
 #define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_THREAD_POOL_HPP_
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <thread>
+#include <vector>
 
 #include "async_simple/base/assert.hpp"
+#include "async_simple/base/macro.hpp"
+#include "async_simple/base/noncopyable.hpp"
+#include "async_simple/base/task.hpp"
 #include "async_simple/container/threadsafe_queue.hpp"
+#include "async_simple/container/work_steal_deque.hpp"
+#include "async_simple/util/event_count.hpp"
+#include "async_simple/util/latency_histogram.hpp"
 
 namespace async_simple::util {
 
+namespace detail {
+
+/// 放在ThreadPool外面，在ThreadPool内部使用ThreadsafeQueue<WorkItem>时已经是完整的可默认构造类型
+struct WorkItem {
+  bool can_steal{false};
+  Task fn{nullptr};
+  int64_t enqueue_ns{0};  ///< 被采样时记录提交的时间，用于统计排队延迟，否则为0
+};
+
+} // namespace async_simple::util::detail
+
+/// 开启work steal时，每个工作线程有三个任务来源：
+/// - inbox: 通过ScheduleById指定到该线程上的任务，不能被窃取
+/// - local: 工作线程自己提交的任务，存放在无锁的Chase-Lev队列中，其他线程可以窃取
+/// - injection: 外部线程提交的任务，所有工作线程共享
+/// 没有开启work steal时，每个线程只使用自己的inbox
+///
+/// 另外每个工作线程有一个只能容纳一个任务的LIFO槽，ScheduleNext提交的任务(通常是被唤醒的协程)
+/// 放在这里，当前任务结束后优先执行，保持缓存局部性，不需要排在其他任务之后。
+/// 连续从LIFO槽执行kMaxLifoRuns次之后会把槽中的任务放回队尾，避免互相唤醒的一对任务饿死其他任务
 class ThreadPool {
  public:
-  struct WorkItem {
-    bool can_steal{false};
-    std::function<void()> fn{nullptr};
+  using WorkItem = detail::WorkItem;
+
+  /// 单个工作线程的调度统计，除pending之外都是从线程池创建开始的累计值
+  struct WorkerStats {
+    std::size_t pending{0};            ///< inbox和本地队列中等待的任务数
+    bool parked{false};                ///< 当前是否在休眠
+    uint64_t executed{0};              ///< 执行过的任务数
+    uint64_t steals{0};                ///< 从其他线程的队列中窃取成功的次数
+    uint64_t failed_steals{0};         ///< 遍历了所有线程都没有窃取到任务的次数
+    uint64_t parks{0};                 ///< 休眠的次数
+    uint64_t parked_ns{0};             ///< 已经结束的休眠的总时间
+    uint64_t queue_wait_samples{0};    ///< 统计了排队延迟的任务数
+    uint64_t queue_wait_ns{0};         ///< 采样任务从提交到开始执行的总时间
+    uint64_t max_queue_wait_ns{0};
+    uint64_t lifo_executed{0};         ///< 从LIFO槽中取出执行的任务数
+  };
+
+  /// 连续从LIFO槽中执行任务的上限
+  static constexpr uint32_t kMaxLifoRuns = 3;
+
+  /// 每kQueueWaitSampleInterval个提交的任务记录一次提交时间，避免每次提交都读时钟
+  static constexpr uint32_t kQueueWaitSampleInterval = LatencySampler::kInterval;
+
+  /// 所有工作线程的延迟直方图合并之后的结果，只统计被采样的任务
+  struct LatencySnapshot {
+    LatencyHistogram::Snapshot queue_wait;          ///< 从提交到开始执行
+    LatencyHistogram::Snapshot run_time;            ///< 执行任务(包括DeferToTickEnd注册的回调)的时间
+    LatencyHistogram::Snapshot continuation_delay;  ///< 通过RecordContinuationDelay记录的延迟
   };
 
   enum ErrorType {
@@ -21,12 +77,23 @@ class ThreadPool {
     kErrorPoolItemIsNull,
   };
 
+  /// 空闲的工作线程在休眠之前自旋检查新任务的次数，之后再让出kIdleYieldCount次CPU
+  static constexpr uint32_t kDefaultSpinCount = 64;
+  static constexpr uint32_t kIdleYieldCount = 4;
+
+  /// @param spin_count 空闲时自旋的次数，越大唤醒延迟越低，空闲时占用的CPU越多；为0时直接休眠
   explicit ThreadPool(std::size_t thread_num = std::thread::hardware_concurrency(),
-                      bool enable_work_steal = false)
+                      bool enable_work_steal = false,
+                      uint32_t spin_count = kDefaultSpinCount)
       : thread_num_(thread_num ? thread_num : std::thread::hardware_concurrency()),
-        queues_(thread_num_),
+        workers_(thread_num_),
         enable_work_steal_(enable_work_steal),
-        stop_(false) {
+        // 单核时自旋只会和提交者争抢CPU，只保留让出CPU的阶段
+        spin_count_(std::thread::hardware_concurrency() > 1 ? spin_count : 0),
+        yield_count_(spin_count > 0 ? kIdleYieldCount : 0),
+        stop_(false),
+        parked_num_(0),
+        spinning_num_(0) {
     threads_.reserve(thread_num_);
     for (int i = 0; i < thread_num_; ++i) {
       threads_.emplace_back(&ThreadPool::WorkerThreadMain, this, i);
@@ -34,16 +101,24 @@ class ThreadPool {
   }
   ~ThreadPool() {
     stop_ = true;
-    for (auto &queue : queues_) {
-      queue.Stop();
+    for (auto &worker : workers_) {
+      worker.idle_event.NotifyAll();
     }
     for (auto &thread : threads_) {
       thread.join();
     }
+    for (auto &worker : workers_) {
+      WorkItem *node = nullptr;
+      while (worker.local.Pop(node)) {
+        FreeNode(node);
+      }
+      if ((node = worker.lifo.exchange(nullptr, std::memory_order_relaxed))) {
+        FreeNode(node);
+      }
+    }
   }
 
-  ThreadPool::ErrorType ScheduleById(std::function<void()> fn,
-                                     int32_t id = -1) {
+  ThreadPool::ErrorType ScheduleById(Task fn, int32_t id = -1) {
     if (fn == nullptr) {
       return kErrorPoolItemIsNull;
     }
@@ -51,19 +126,47 @@ class ThreadPool {
       return kErrorPoolHasStop;
     }
     if (id == -1) {
-      if (enable_work_steal_) {
-        WorkItem work_item{true, fn};
-        for (int n = 0; n < thread_num_ * 2; ++n) {
-          if (queues_.at(n % thread_num_).TryPush(work_item)) {
-            return kErrorNone;
-          }
+      auto current_id = GetCurrentId();
+      if (!enable_work_steal_) {
+        id = PickWorker(current_id);
+        workers_[id].inbox.Push(WorkItem{false, std::move(fn), LatencySampler::Sample()});
+        if (id != current_id) {
+          Unpark(id);
         }
+        return kErrorNone;
+      }
+      if (current_id != -1) {
+        // 工作线程提交的任务放到自己的无锁队列中，由空闲线程来窃取
+        workers_[current_id].local.Push(NewNode(std::move(fn)));
+      } else {
+        injection_.Push(WorkItem{true, std::move(fn), LatencySampler::Sample()});
       }
-      id = rand() % thread_num_;
-      queues_[id].Push(WorkItem{enable_work_steal_, std::move(fn)});
+      UnparkOne(current_id);
     } else {
       ASSERT(id < thread_num_);
-      queues_[id].Push(WorkItem{false, std::move(fn)});
+      workers_[id].inbox.Push(WorkItem{false, std::move(fn), LatencySampler::Sample()});
+      Unpark(id);
+    }
+    return kErrorNone;
+  }
+
+  /// 在当前工作线程上接着执行fn：当前线程是id对应的工作线程(id为-1时是任意工作线程)时放入它的LIFO槽，
+  /// 槽中原有的任务按ScheduleById重新提交；否则等同于ScheduleById。
+  /// 放入LIFO槽时不会唤醒其他线程，适合唤醒等待者这类很快就能执行的任务
+  ThreadPool::ErrorType ScheduleNext(Task fn, int32_t id = -1) {
+    auto current_id = GetCurrentId();
+    if (current_id == -1 || (id != -1 && id != current_id)) {
+      return ScheduleById(std::move(fn), id);
+    }
+    if (fn == nullptr) {
+      return kErrorPoolItemIsNull;
+    }
+    if (stop_) {
+      return kErrorPoolHasStop;
+    }
+    auto prev = workers_[current_id].lifo.exchange(NewNode(std::move(fn)), std::memory_order_acq_rel);
+    if (prev) {
+      Displace(current_id, prev, id);
     }
     return kErrorNone;
   }
@@ -76,49 +179,446 @@ class ThreadPool {
     return -1;
   }
   [[nodiscard]] std::size_t GetItemCount() const {
-    std::size_t ret = 0;
+    std::size_t ret = injection_.Size();
     for (int i = 0; i < thread_num_; ++i) {
-      ret += queues_[i].Size();
+      ret += workers_[i].inbox.Size() + workers_[i].local.Size() + HasLifo(workers_[i]);
     }
     return ret;
   }
   [[nodiscard]] std::size_t GetThreadNum() const { return thread_num_; }
 
+  /// 外部线程提交到共享队列中还没有被取走的任务数
+  [[nodiscard]] std::size_t GetInjectionCount() const { return injection_.SizeHint(); }
+
+  /// 所有工作线程统计的快照，只读取计数器，不加锁，可以频繁调用
+  [[nodiscard]] std::vector<WorkerStats> GetWorkerStats() const {
+    std::vector<WorkerStats> stats(thread_num_);
+    for (std::size_t i = 0; i < thread_num_; ++i) {
+      auto &worker = workers_[i];
+      auto &counters = worker.counters;
+      auto &stat = stats[i];
+      stat.pending = worker.inbox.SizeHint() + worker.local.Size() + HasLifo(worker);
+      stat.parked = worker.parked.load(std::memory_order_relaxed);
+      stat.executed = counters.executed.load(std::memory_order_relaxed);
+      stat.steals = counters.steals.load(std::memory_order_relaxed);
+      stat.failed_steals = counters.failed_steals.load(std::memory_order_relaxed);
+      stat.parks = counters.parks.load(std::memory_order_relaxed);
+      stat.parked_ns = counters.parked_ns.load(std::memory_order_relaxed);
+      stat.queue_wait_samples = counters.queue_wait_samples.load(std::memory_order_relaxed);
+      stat.queue_wait_ns = counters.queue_wait_ns.load(std::memory_order_relaxed);
+      stat.max_queue_wait_ns = counters.max_queue_wait_ns.load(std::memory_order_relaxed);
+      stat.lifo_executed = counters.lifo_executed.load(std::memory_order_relaxed);
+    }
+    return stats;
+  }
+
+  /// 合并所有工作线程的直方图，不加锁。定义了ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM时总是为空
+  [[nodiscard]] LatencySnapshot GetLatencySnapshot() const {
+    LatencySnapshot snapshot;
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+    for (auto &worker : workers_) {
+      worker.histograms.queue_wait.AddTo(snapshot.queue_wait);
+      worker.histograms.run_time.AddTo(snapshot.run_time);
+      worker.histograms.continuation_delay.AddTo(snapshot.continuation_delay);
+    }
+#endif
+    return snapshot;
+  }
+
+  /// 记录到当前工作线程的continuation_delay直方图中，当前线程不是这个线程池的工作线程时忽略
+  void RecordContinuationDelay([[maybe_unused]] uint64_t ns) {
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+    auto id = GetCurrentId();
+    if (id != -1) {
+      workers_[id].histograms.continuation_delay.Record(ns);
+    }
+#endif
+  }
+
+  /// 在当前任务执行结束之后调用fn，用于把一个任务中积攒的操作（比如IO提交）合并处理
+  /// 同一个任务中使用相同的key多次注册，fn只会被调用一次
+  /// @return 当前线程不是工作线程时返回false，调用者需要自己立即处理
+  static bool DeferToTickEnd(const void *key, Task fn) {
+    if (GetCurrent()->second == nullptr) {
+      return false;
+    }
+    auto &deferred = GetDeferred();
+    for (auto &item : deferred) {
+      if (item.first == key) {
+        return true;
+      }
+    }
+    deferred.emplace_back(key, std::move(fn));
+    return true;
+  }
+
  private:
-  [[nodiscard]] std::pair<int32_t, ThreadPool *> *GetCurrent() const {
+  /// 只有所属的工作线程会修改，用load + store避免原子的读改写，单独占用缓存行，
+  /// 不会和提交者访问的队列互相影响；GetWorkerStats在其他线程只读取
+  struct alignas(64) Counters {
+    using Counter = std::atomic<uint64_t>;
+
+    static void Add(Counter &counter, uint64_t n = 1) noexcept {
+      counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    Counter executed{0};
+    Counter steals{0};
+    Counter failed_steals{0};
+    Counter parks{0};
+    Counter parked_ns{0};
+    Counter queue_wait_samples{0};
+    Counter queue_wait_ns{0};
+    Counter max_queue_wait_ns{0};
+    Counter lifo_executed{0};
+  };
+
+  /// 和Counters一样只有所属的工作线程会记录
+  struct Histograms {
+    LatencyHistogram queue_wait;
+    LatencyHistogram run_time;
+    LatencyHistogram continuation_delay;
+  };
+
+  struct alignas(64) Worker {
+    container::WorkStealDeque<WorkItem *> local;
+    container::ThreadsafeQueue<WorkItem> inbox;
+    EventCount idle_event;
+    std::atomic<bool> parked{false};
+    /// 只有所属线程会放入任务，开启work steal时其他线程在没有别的任务可做时也会从这里窃取
+    std::atomic<WorkItem *> lifo{nullptr};
+    uint32_t lifo_runs{0};  ///< 连续从lifo执行的次数，只有所属线程访问
+    Counters counters;
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+    Histograms histograms;
+#endif
+  };
+
+  /// 不加锁地估计一个工作线程的负载：排队的任务数，没有休眠时再加上正在执行的任务
+  [[nodiscard]] static std::size_t LoadHint(const Worker &worker) noexcept {
+    return worker.inbox.SizeHint() + !worker.parked.load(std::memory_order_relaxed);
+  }
+
+  /// 线程本地的xorshift，避免rand()中的全局锁
+  static uint32_t NextRandom() noexcept {
+    static thread_local uint32_t state =
+        static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  /// 没有开启work steal时为不指定线程的任务选择工作线程(power of two choices)：
+  /// 随机取两个不同的线程，选择负载较小的一个。工作线程提交时其中一个固定是自己，
+  /// 不计算自己正在执行的任务，负载相同时优先自己，自己已经有积压时再分给更空闲的线程
+  int32_t PickWorker(int32_t current_id) noexcept {
+    if (thread_num_ == 1) {
+      return 0;
+    }
+    auto r = NextRandom();
+    int32_t first = current_id;
+    std::size_t first_load = 0;
+    if (first == -1) {
+      first = static_cast<int32_t>(r % thread_num_);
+      first_load = LoadHint(workers_[first]);
+    } else {
+      first_load = workers_[first].inbox.SizeHint();
+    }
+    auto second = static_cast<int32_t>((first + 1 + (r >> 16) % (thread_num_ - 1)) % thread_num_);
+    return LoadHint(workers_[second]) < first_load ? second : first;
+  }
+
+  [[nodiscard]] static bool HasLifo(const Worker &worker) noexcept {
+    return worker.lifo.load(std::memory_order_relaxed) != nullptr;
+  }
+
+  /// 被LIFO槽中新任务挤出来的任务，按照ScheduleById的规则放到队列中
+  void Displace(int32_t current_id, WorkItem *node, int32_t id) {
+    if (enable_work_steal_ && id == -1) {
+      workers_[current_id].local.Push(node);
+      UnparkOne(current_id);
+      return;
+    }
+    ScheduleById(std::move(node->fn), id);
+    FreeNode(node);
+  }
+
+  /// 被采样的任务返回开始执行的时间，否则返回0
+  static int64_t RecordExecute(Worker &self, const WorkItem &item) noexcept {
+    auto &counters = self.counters;
+    Counters::Add(counters.executed);
+    if (item.enqueue_ns == 0) LIKELY {
+      return 0;
+    }
+    auto now = LatencySampler::Now();
+    auto wait = static_cast<uint64_t>(std::max<int64_t>(now - item.enqueue_ns, 0));
+    Counters::Add(counters.queue_wait_samples);
+    Counters::Add(counters.queue_wait_ns, wait);
+    if (wait > counters.max_queue_wait_ns.load(std::memory_order_relaxed)) {
+      counters.max_queue_wait_ns.store(wait, std::memory_order_relaxed);
+    }
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+    self.histograms.queue_wait.Record(wait);
+#endif
+    return now;
+  }
+
+  /// 无锁队列中存放的是WorkItem的指针，节点缓存在线程本地复用，稳定状态下提交任务不会分配内存
+  class NodeCache : noncopyable {
+   public:
+    static constexpr std::size_t kMaxCached = 1024;
+
+    NodeCache() { nodes_.reserve(kMaxCached); }
+    ~NodeCache() {
+      for (auto node : nodes_) {
+        delete node;
+      }
+    }
+
+    WorkItem *Get() {
+      if (nodes_.empty()) {
+        return new WorkItem;
+      }
+      auto node = nodes_.back();
+      nodes_.pop_back();
+      return node;
+    }
+    void Put(WorkItem *node) {
+      if (nodes_.size() == kMaxCached) {
+        delete node;
+      } else {
+        nodes_.push_back(node);
+      }
+    }
+
+   private:
+    std::vector<WorkItem *> nodes_;
+  };
+
+  static NodeCache &GetNodeCache() {
+    static thread_local NodeCache cache;
+    return cache;
+  }
+  static WorkItem *NewNode(Task fn) {
+    auto node = GetNodeCache().Get();
+    node->can_steal = true;
+    node->fn = std::move(fn);
+    node->enqueue_ns = LatencySampler::Sample();
+    return node;
+  }
+  static void FreeNode(WorkItem *node) {
+    node->fn = nullptr;
+    GetNodeCache().Put(node);
+  }
+
+  [[nodiscard]] static std::pair<int32_t, ThreadPool *> *GetCurrent() {
     static thread_local std::pair<int32_t, ThreadPool *> current(-1, nullptr);
     return &current;
   }
 
+  static std::vector<std::pair<const void *, Task>> &GetDeferred() {
+    static thread_local std::vector<std::pair<const void *, Task>> deferred;
+    return deferred;
+  }
+  static void RunDeferred() {
+    auto &deferred = GetDeferred();
+    // 回调中可能会再次注册
+    while (!deferred.empty()) {
+      auto fn = std::move(deferred.back().second);
+      deferred.pop_back();
+      fn();
+    }
+  }
+
   void WorkerThreadMain(int32_t id) {
     auto current = GetCurrent();
     current->first = id;
     current->second = this;
+    auto &self = workers_[id];
     while (true) {
       WorkItem item;
-      if (enable_work_steal_) {
-        // 优先进行窃取
-        for (int n = 0; n < thread_num_ * 2; ++n) {
-          if (queues_[(id + n) % thread_num_].TryPopIf(item, [](WorkItem &item) { return item.can_steal; })) {
-            break;
+      if (PopWorkItem(id, item)) {
+        [[maybe_unused]] auto start = RecordExecute(self, item);
+        item.fn();
+        RunDeferred();
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+        if (start != 0) UNLIKELY {
+          self.histograms.run_time.Record(LatencySampler::Since(start));
+        }
+#endif
+        continue;
+      }
+      if (stop_) {
+        // 退出前需要把属于自己的任务执行完
+        if (!HasWork(id)) {
+          break;
+        }
+        continue;
+      }
+      if (!Spin(id)) {
+        Park(id);
+      }
+    }
+  }
+
+  bool PopWorkItem(int32_t id, WorkItem &item) {
+    auto &self = workers_[id];
+    if (HasLifo(self)) {
+      if (auto node = self.lifo.exchange(nullptr, std::memory_order_acquire)) {
+        if (self.lifo_runs < kMaxLifoRuns) {
+          ++self.lifo_runs;
+          Counters::Add(self.counters.lifo_executed);
+          TakeNode(node, item);
+          return true;
+        }
+        // 用完了连续执行的次数，放回自己的队尾，让等待中的任务先执行
+        if (enable_work_steal_) {
+          self.local.Push(node);
+        } else {
+          self.inbox.Push(WorkItem{false, std::move(node->fn), node->enqueue_ns});
+          FreeNode(node);
+        }
+      }
+    }
+    self.lifo_runs = 0;
+    if (self.inbox.SizeHint() > 0 && self.inbox.TryPop(item)) {
+      return true;
+    }
+    if (!enable_work_steal_) {
+      return false;
+    }
+    if (injection_.SizeHint() > 0 && injection_.TryPop(item)) {
+      return true;
+    }
+    // 自己的队列也从top端取，保持FIFO顺序，这样Yield之类的让出操作会排在已有任务之后
+    WorkItem *node = nullptr;
+    if (!self.local.Steal(node)) {
+      for (std::size_t n = 1; n < thread_num_; ++n) {
+        auto &victim = workers_[(id + n) % thread_num_];
+        if (victim.local.Steal(node)) {
+          Counters::Add(self.counters.steals);
+          if (!victim.local.Empty()) {
+            UnparkOne(id);
           }
+          break;
         }
       }
-      // 没有开启窃取，或者窃取失败，则调用Pop等待任务
-      if (!item.fn && !queues_[id].Pop(item)) {
-        break;
+    }
+    if (!node) {
+      // 最后才窃取其他线程LIFO槽中的任务，避免所属线程长时间执行一个任务时它一直等待
+      for (std::size_t n = 1; n < thread_num_ && !node; ++n) {
+        auto &victim = workers_[(id + n) % thread_num_];
+        if (HasLifo(victim)) {
+          node = victim.lifo.exchange(nullptr, std::memory_order_acquire);
+        }
       }
-      if (item.fn) {
-        item.fn();
+      if (!node) {
+        Counters::Add(self.counters.failed_steals);
+        return false;
+      }
+      Counters::Add(self.counters.steals);
+    }
+    TakeNode(node, item);
+    return true;
+  }
+
+  static void TakeNode(WorkItem *node, WorkItem &item) {
+    item = std::move(*node);
+    FreeNode(node);
+  }
+
+  [[nodiscard]] bool HasWork(int32_t id) const {
+    if (workers_[id].inbox.SizeHint() > 0 || HasLifo(workers_[id])) {
+      return true;
+    }
+    if (!enable_work_steal_) {
+      return false;
+    }
+    if (injection_.SizeHint() > 0) {
+      return true;
+    }
+    for (auto &worker : workers_) {
+      if (!worker.local.Empty() || HasLifo(worker)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// 休眠之前先自旋、再让出CPU，期间出现新任务时返回true，避免每次交接任务都经过futex
+  bool Spin(int32_t id) {
+    if (spin_count_ + yield_count_ == 0) {
+      return false;
+    }
+    spinning_num_.fetch_add(1, std::memory_order_relaxed);
+    bool found = false;
+    for (uint32_t i = 0; i < spin_count_ + yield_count_ && !found; ++i) {
+      if (i < spin_count_) {
+        CPU_RELAX();
+      } else {
+        std::this_thread::yield();
+      }
+      found = stop_.load(std::memory_order_relaxed) || HasWork(id);
+    }
+    // 提交者看到有线程在自旋时不会唤醒休眠的线程，所以停止自旋之后还要在Park中再检查一次
+    spinning_num_.fetch_sub(1, std::memory_order_seq_cst);
+    return found;
+  }
+
+  void Park(int32_t id) {
+    auto &self = workers_[id];
+    self.parked.store(true, std::memory_order_relaxed);
+    parked_num_.fetch_add(1, std::memory_order_relaxed);
+    auto key = self.idle_event.PrepareWait();
+    // 与提交者中的fence配对：要么提交者看到parked，要么这里看到新任务
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (stop_ || HasWork(id)) {
+      self.idle_event.CancelWait();
+    } else {
+      Counters::Add(self.counters.parks);
+      auto start = LatencySampler::Now();
+      self.idle_event.Wait(key);
+      Counters::Add(self.counters.parked_ns, LatencySampler::Since(start));
+    }
+    parked_num_.fetch_sub(1, std::memory_order_relaxed);
+    self.parked.store(false, std::memory_order_relaxed);
+  }
+
+  /// 只有目标线程在休眠时才会进入内核
+  void Unpark(int32_t id) {
+    workers_[id].idle_event.Notify();
+  }
+
+  /// 唤醒任意一个休眠中的线程，没有线程休眠时不会加锁
+  void UnparkOne(int32_t from = -1) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // 自旋中的线程会自己找到任务
+    if (parked_num_.load(std::memory_order_relaxed) == 0 ||
+        spinning_num_.load(std::memory_order_relaxed) != 0) {
+      return;
+    }
+    // 从from的下一个线程开始找，from为-1时从0开始
+    auto start = static_cast<std::size_t>(from + 1);
+    for (std::size_t n = 0; n < thread_num_; ++n) {
+      auto id = static_cast<int32_t>((start + n) % thread_num_);
+      if (workers_[id].parked.load(std::memory_order_relaxed)) {
+        Unpark(id);
+        return;
       }
     }
   }
 
   std::size_t thread_num_;
-  std::vector<container::ThreadsafeQueue<WorkItem>> queues_;
+  std::vector<Worker> workers_;
+  container::ThreadsafeQueue<WorkItem> injection_;
   std::vector<std::thread> threads_;
   bool enable_work_steal_;
+  uint32_t spin_count_;
+  uint32_t yield_count_;
   std::atomic<bool> stop_;
+  std::atomic<std::size_t> parked_num_;
+  std::atomic<std::size_t> spinning_num_;
 };
 
 }
@@ -0,0 +1,148 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_TIMER_SERVICE_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_TIMER_SERVICE_HPP_
+
+#include "async_simple/util/timing_wheel.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace async_simple::util {
+
+/// TimerService使用一个线程驱动TimingWheel，精度为1us
+/// 到期的回调函数在定时器线程中批量执行，因此回调函数应该尽快返回（一般只是把任务提交给Executor）
+class TimerService : noncopyable {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = std::chrono::microseconds;
+  using Func = Task;
+  using Entry = TimingWheel::Entry;
+
+  TimerService() : start_(Clock::now()) {
+    thread_ = std::thread([this]() { Loop(); });
+  }
+  ~TimerService() {
+    {
+      std::lock_guard lg(mutex_);
+      stop_ = true;
+    }
+    cond_.notify_one();
+    thread_.join();
+    // 没有到期的定时器直接丢弃
+    auto entry = wheel_.Advance(std::numeric_limits<uint64_t>::max());
+    while (entry) {
+      auto next = entry->next;
+      if (entry->detached) {
+        delete entry;
+      }
+      entry = next;
+    }
+  }
+
+  /// 在duration之后执行func，Entry由TimerService管理
+  void Schedule(Func func, Duration duration) {
+    auto entry = new Entry;
+    entry->detached = true;
+    entry->callback = std::move(func);
+    Add(entry, duration);
+  }
+
+  /// 在duration之后执行entry->callback
+  /// entry由调用者持有，需要保证entry在回调执行或者Cancel成功之前一直有效，
+  /// 回调函数可以在返回之前让调用者释放entry，TimerService在调用之后不会再访问它
+  void Add(Entry *entry, Duration duration) {
+    auto deadline = Now() + std::max<int64_t>(duration.count(), 0);
+    bool inserted;
+    {
+      std::lock_guard lg(mutex_);
+      entry->deadline = deadline;
+      inserted = wheel_.Insert(entry);
+      if (inserted) {
+        if (deadline >= next_wakeup_) {
+          // 定时器线程会在这之前醒来
+          return;
+        }
+        next_wakeup_ = deadline;
+      }
+    }
+    if (inserted) {
+      cond_.notify_one();
+    } else {
+      // 已经到期，直接执行
+      Fire(entry);
+    }
+  }
+
+  /// 取消一个还没有到期的定时器，O(1)
+  /// @return 返回false表示回调已经执行或者正在执行
+  bool Cancel(Entry *entry) {
+    std::lock_guard lg(mutex_);
+    if (!entry->Linked()) {
+      return false;
+    }
+    wheel_.Remove(entry);
+    return true;
+  }
+
+  /// 是否没有等待中的定时器
+  [[nodiscard]] bool Empty() {
+    std::lock_guard lg(mutex_);
+    return wheel_.Empty();
+  }
+
+ private:
+  [[nodiscard]] uint64_t Now() const {
+    return std::chrono::duration_cast<Duration>(Clock::now() - start_).count();
+  }
+
+  static void Fire(Entry *entry) {
+    if (entry->detached) {
+      entry->callback();
+      delete entry;
+    } else {
+      entry->callback();
+    }
+  }
+
+  void Loop() {
+    std::unique_lock lock(mutex_);
+    while (!stop_) {
+      auto expired = wheel_.Advance(Now());
+      if (expired) {
+        next_wakeup_ = 0;
+        lock.unlock();
+        while (expired) {
+          // callback中可能会释放entry，需要先取出next
+          auto next = expired->next;
+          expired->next = nullptr;
+          Fire(expired);
+          expired = next;
+        }
+        lock.lock();
+        continue;
+      }
+      auto next = wheel_.NextDeadline();
+      if (next) {
+        next_wakeup_ = *next;
+        cond_.wait_until(lock, start_ + Duration(*next));
+      } else {
+        next_wakeup_ = std::numeric_limits<uint64_t>::max();
+        cond_.wait(lock);
+      }
+    }
+  }
+
+  Clock::time_point start_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  TimingWheel wheel_;
+  uint64_t next_wakeup_{std::numeric_limits<uint64_t>::max()};
+  bool stop_{false};
+  std::thread thread_;
+};
+
+} // namespace async_simple::util
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_TIMER_SERVICE_HPP_
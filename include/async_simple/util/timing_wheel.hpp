@@ -0,0 +1,191 @@
+#ifndef MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_TIMING_WHEEL_HPP_
+#define MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_TIMING_WHEEL_HPP_
+
+#include "async_simple/base/assert.hpp"
+#include "async_simple/base/noncopyable.hpp"
+#include "async_simple/base/task.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace async_simple::util {
+
+/// 分层时间轮，时间单位是tick(由使用者决定，TimerService中为1us)
+/// 共有kLevelNum层，每层kSlotNum个槽，第i层每个槽覆盖kSlotNum^i个tick
+/// 插入和删除都是O(1)的，Advance会批量取出所有到期的Entry
+/// TimingWheel本身不是线程安全的
+class TimingWheel : noncopyable {
+ public:
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlotNum = 1 << kSlotBits;
+  static constexpr uint64_t kSlotMask = kSlotNum - 1;
+  static constexpr int kLevelNum = 7;
+  /// 能够直接表示的最大时间跨度，超过的会先放在最高层，到期时重新插入
+  static constexpr uint64_t kMaxDuration = uint64_t(1) << (kSlotBits * kLevelNum);
+
+  /// 侵入式的链表节点，由使用者分配，并且需要保证在被删除或者到期之前一直有效
+  struct Entry {
+    Entry *prev{nullptr};
+    Entry *next{nullptr};
+    uint64_t deadline{0};
+    int level{-1};  ///< -1表示不在时间轮中
+    int slot{0};
+    bool detached{false};  ///< 为true时由TimerService负责释放
+    Task callback;
+
+    [[nodiscard]] bool Linked() const noexcept { return level >= 0; }
+  };
+
+  explicit TimingWheel(uint64_t now = 0) : elapsed_(now) {}
+
+  [[nodiscard]] uint64_t Elapsed() const noexcept { return elapsed_; }
+  [[nodiscard]] bool Empty() const noexcept {
+    for (auto occupied : occupied_) {
+      if (occupied) return false;
+    }
+    return true;
+  }
+
+  /// 插入一个Entry，需要事先设置好deadline
+  /// @return deadline已经过去时不会插入，返回false
+  bool Insert(Entry *entry) {
+    ASSERT(!entry->Linked());
+    if (entry->deadline <= elapsed_) {
+      return false;
+    }
+    Link(entry);
+    return true;
+  }
+
+  void Remove(Entry *entry) {
+    ASSERT(entry->Linked());
+    auto &head = slots_[entry->level][entry->slot];
+    if (entry->prev) {
+      entry->prev->next = entry->next;
+    } else {
+      head = entry->next;
+    }
+    if (entry->next) {
+      entry->next->prev = entry->prev;
+    }
+    if (!head) {
+      occupied_[entry->level] &= ~(uint64_t(1) << entry->slot);
+    }
+    entry->prev = entry->next = nullptr;
+    entry->level = -1;
+  }
+
+  /// 下一次需要处理的时间点，可能是某个Entry到期，也可能是高层的槽需要下沉
+  [[nodiscard]] std::optional<uint64_t> NextDeadline() const {
+    auto expiration = NextExpiration();
+    if (!expiration) return std::nullopt;
+    return expiration->deadline;
+  }
+
+  /// 将时间推进到now
+  /// @return 所有到期的Entry，按照next指针串成单链表
+  Entry *Advance(uint64_t now) {
+    Entry *expired = nullptr;
+    Entry **tail = &expired;
+    while (true) {
+      auto expiration = NextExpiration();
+      if (!expiration || expiration->deadline > now) {
+        break;
+      }
+      elapsed_ = expiration->deadline;
+      auto entry = TakeSlot(expiration->level, expiration->slot);
+      while (entry) {
+        auto next = entry->next;
+        entry->prev = entry->next = nullptr;
+        if (entry->deadline <= elapsed_) {
+          *tail = entry;
+          tail = &entry->next;
+        } else {
+          // 下沉到更低的层
+          Link(entry);
+        }
+        entry = next;
+      }
+    }
+    if (now > elapsed_) {
+      elapsed_ = now;
+    }
+    return expired;
+  }
+
+ private:
+  struct Expiration {
+    int level;
+    int slot;
+    uint64_t deadline;
+  };
+
+  static int LevelFor(uint64_t elapsed, uint64_t when) {
+    auto masked = (elapsed ^ when) | kSlotMask;
+    if (masked >= kMaxDuration) {
+      masked = kMaxDuration - 1;
+    }
+    auto significant = 63 - std::countl_zero(masked);
+    return significant / kSlotBits;
+  }
+
+  void Link(Entry *entry) {
+    // 太远的Entry放到最高层，最高层的槽相当于一个环
+    auto when = std::min(entry->deadline, elapsed_ + kMaxDuration - 1);
+    auto level = LevelFor(elapsed_, when);
+    auto slot = static_cast<int>((when >> (level * kSlotBits)) & kSlotMask);
+    auto &head = slots_[level][slot];
+    entry->level = level;
+    entry->slot = slot;
+    entry->prev = nullptr;
+    entry->next = head;
+    if (head) {
+      head->prev = entry;
+    }
+    head = entry;
+    occupied_[level] |= uint64_t(1) << slot;
+  }
+
+  Entry *TakeSlot(int level, int slot) {
+    auto head = std::exchange(slots_[level][slot], nullptr);
+    occupied_[level] &= ~(uint64_t(1) << slot);
+    for (auto entry = head; entry; entry = entry->next) {
+      entry->level = -1;
+    }
+    return head;
+  }
+
+  [[nodiscard]] std::optional<Expiration> NextExpiration() const {
+    // 低层的Entry总是比高层的先到期
+    for (int level = 0; level < kLevelNum; ++level) {
+      auto occupied = occupied_[level];
+      if (!occupied) continue;
+      auto shift = level * kSlotBits;
+      uint64_t slot_range = uint64_t(1) << shift;
+      uint64_t level_range = slot_range << kSlotBits;
+      // 从当前槽的下一个开始找，当前槽如果有Entry，只可能是最高层下一圈的
+      auto from = static_cast<int>(((elapsed_ >> shift) + 1) & kSlotMask);
+      auto zeros = std::countr_zero(std::rotr(occupied, from));
+      auto slot = static_cast<int>((zeros + from) & kSlotMask);
+      auto level_start = elapsed_ & ~(level_range - 1);
+      auto deadline = level_start + slot * slot_range;
+      if (deadline <= elapsed_) {
+        // 只会出现在最高层，说明是下一圈的槽
+        deadline += level_range;
+      }
+      return Expiration{level, slot, deadline};
+    }
+    return std::nullopt;
+  }
+
+  uint64_t elapsed_;
+  uint64_t occupied_[kLevelNum]{};
+  Entry *slots_[kLevelNum][kSlotNum]{};
+};
+
+} // namespace async_simple::util
+
+#endif //MINI_ASYNC_SIMPLE_INCLUDE_ASYNC_SIMPLE_UTIL_TIMING_WHEEL_HPP_
@@ -0,0 +1,9 @@
+#ifndef MINI_ASYNC_SIMPLE_TEST_ALLOC_COUNTER_HPP_
+#define MINI_ASYNC_SIMPLE_TEST_ALLOC_COUNTER_HPP_
+
+#include <cstddef>
+
+/// 测试程序替换了全局的operator new，用来统计堆内存分配的次数（所有线程）
+std::size_t AllocCount();
+
+#endif //MINI_ASYNC_SIMPLE_TEST_ALLOC_COUNTER_HPP_
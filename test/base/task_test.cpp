@@ -0,0 +1,107 @@
+#include <async_simple/base/task.hpp>
+
+#include "async_simple_test.hpp"
+#include "alloc_counter.hpp"
+
+#include <array>
+#include <coroutine>
+#include <memory>
+
+namespace async_simple {
+
+class TaskTest : public testing::Test {};
+
+TEST_F(TaskTest, TestEmpty) {
+  Task t0;
+  ASSERT_FALSE(t0);
+  ASSERT_TRUE(t0 == nullptr);
+
+  Task t1 = nullptr;
+  ASSERT_TRUE(t1 == nullptr);
+
+  void (*fp)() = nullptr;
+  Task t2 = fp;
+  ASSERT_TRUE(t2 == nullptr);
+
+  int value = 0;
+  Task t3 = [&value]() { ++value; };
+  ASSERT_TRUE(t3 != nullptr);
+  t3();
+  ASSERT_EQ(1, value);
+  t3 = nullptr;
+  ASSERT_FALSE(t3);
+}
+
+TEST_F(TaskTest, TestMoveOnly) {
+  auto p = std::make_unique<int>(42);
+  int value = 0;
+  Task t0 = [p = std::move(p), &value]() { value = *p; };
+  Task t1 = std::move(t0);
+  ASSERT_FALSE(t0);
+  t1();
+  ASSERT_EQ(42, value);
+
+  Task t2;
+  t2 = std::move(t1);
+  ASSERT_FALSE(t1);
+  value = 0;
+  t2();
+  ASSERT_EQ(42, value);
+}
+
+TEST_F(TaskTest, TestArgs) {
+  BasicTask<int(int, int)> add = [](int a, int b) { return a + b; };
+  ASSERT_EQ(3, add(1, 2));
+
+  BasicTask<void(std::unique_ptr<int> &&)> sink = [](std::unique_ptr<int> &&p) {
+    ASSERT_EQ(1, *p);
+  };
+  sink(std::make_unique<int>(1));
+
+  int value = 0;
+  BasicTask<void(int &)> ref = [](int &v) { v = 5; };
+  ref(value);
+  ASSERT_EQ(5, value);
+}
+
+TEST_F(TaskTest, TestDestroy) {
+  auto counter = std::make_shared<int>(0);
+  {
+    Task t0 = [counter]() {};
+    ASSERT_EQ(2, counter.use_count());
+    Task t1 = std::move(t0);
+    ASSERT_EQ(2, counter.use_count());
+  }
+  ASSERT_EQ(1, counter.use_count());
+  {
+    std::array<char, 128> big{};
+    Task t0 = [counter, big]() { (void) big; };
+    ASSERT_EQ(2, counter.use_count());
+    Task t1 = std::move(t0);
+    ASSERT_EQ(2, counter.use_count());
+  }
+  ASSERT_EQ(1, counter.use_count());
+}
+
+TEST_F(TaskTest, TestInlineStorage) {
+  auto before = AllocCount();
+  {
+    auto h = std::noop_coroutine();
+    Task t0 = [h]() mutable { h.resume(); };
+    Task t1 = std::move(t0);
+    t1();
+
+    std::array<char, Task::kInlineSize - sizeof(void *)> payload{};
+    int value = 0;
+    Task t2 = [payload, &value]() { value = payload[0] + 1; };
+    t2();
+    ASSERT_EQ(1, value);
+  }
+  ASSERT_EQ(before, AllocCount());
+
+  std::array<char, Task::kInlineSize + 1> big{};
+  Task t3 = [big]() { (void) big; };
+  ASSERT_EQ(before + 1, AllocCount());
+}
+
+} // namespace async_simple
@@ -0,0 +1,86 @@
+#include <async_simple/container/work_steal_deque.hpp>
+
+#include "async_simple_test.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace async_simple::container {
+
+class WorkStealDequeTest : public testing::Test {};
+
+TEST_F(WorkStealDequeTest, TestPushPop) {
+  WorkStealDeque<int> deque(2);
+  int v = 0;
+  EXPECT_FALSE(deque.Pop(v));
+  EXPECT_FALSE(deque.Steal(v));
+
+  // 超过初始容量，触发扩容
+  for (int i = 0; i < 10; ++i) {
+    deque.Push(i);
+  }
+  EXPECT_EQ(deque.Size(), 10u);
+
+  // Pop从bottom端取，Steal从top端取
+  ASSERT_TRUE(deque.Pop(v));
+  EXPECT_EQ(v, 9);
+  ASSERT_TRUE(deque.Steal(v));
+  EXPECT_EQ(v, 0);
+  ASSERT_TRUE(deque.Steal(v));
+  EXPECT_EQ(v, 1);
+  EXPECT_EQ(deque.Size(), 7u);
+
+  for (int i = 8; i >= 2; --i) {
+    ASSERT_TRUE(deque.Pop(v));
+    EXPECT_EQ(v, i);
+  }
+  EXPECT_TRUE(deque.Empty());
+  EXPECT_FALSE(deque.Pop(v));
+}
+
+TEST_F(WorkStealDequeTest, TestConcurrentSteal) {
+  constexpr int kItemNum = 100000;
+  constexpr int kThiefNum = 4;
+  WorkStealDeque<int> deque(64);
+  std::vector<std::atomic<int>> taken(kItemNum);
+  std::atomic<int> total{0};
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < kThiefNum; ++i) {
+    thieves.emplace_back([&]() {
+      int v;
+      while (!done.load(std::memory_order_acquire) || !deque.Empty()) {
+        if (deque.Steal(v)) {
+          taken[v].fetch_add(1, std::memory_order_relaxed);
+          total.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+
+  int v;
+  for (int i = 0; i < kItemNum; ++i) {
+    deque.Push(i);
+    if (i % 3 == 0 && deque.Pop(v)) {
+      taken[v].fetch_add(1, std::memory_order_relaxed);
+      total.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  while (deque.Pop(v)) {
+    taken[v].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+  }
+  done.store(true, std::memory_order_release);
+  for (auto &t : thieves) {
+    t.join();
+  }
+
+  EXPECT_EQ(total.load(), kItemNum);
+  for (int i = 0; i < kItemNum; ++i) {
+    ASSERT_EQ(taken[i].load(), 1) << "item " << i;
+  }
+}
+
+} // namespace async_simple::container
@@ -0,0 +1,151 @@
+#include <async_simple/coro/async_io.hpp>
+
+#include "async_simple_test.hpp"
+#include "alloc_counter.hpp"
+#include "scoped_bench.hpp"
+
+#include <async_simple/coro/future_awaiter.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+#include <async_simple/sync/future.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(HAS_IO_URING) || defined(HAS_AIO)
+
+namespace async_simple::coro {
+
+class AsyncIOTest : public testing::Test {
+ public:
+  void SetUp() override {
+    char path[] = "/tmp/async_io_test_XXXXXX";
+    fd_ = mkstemp(path);
+    ASSERT_GE(fd_, 0);
+    unlink(path);
+  }
+  void TearDown() override { close(fd_); }
+
+  int fd_{-1};
+};
+
+TEST_F(AsyncIOTest, TestReadWrite) {
+  executors::SimpleExecutor executor(2, false, executors::IOBackend::kIoUring);
+  auto task = [&]() -> Lazy<> {
+    std::string data = "hello async io";
+    EXPECT_EQ(data.size(), co_await AsyncWrite(fd_, data.data(), data.size(), 10));
+    EXPECT_EQ(0, co_await AsyncFsync(fd_));
+    EXPECT_EQ(0, co_await AsyncFsync(fd_, true));
+
+    std::string buffer(data.size(), '\0');
+    EXPECT_EQ(data.size(), co_await AsyncRead(fd_, buffer.data(), buffer.size(), 10));
+    EXPECT_EQ(data, buffer);
+
+    char part1[6] = {};
+    char part2[10] = {};
+    iovec_t iov[] = {{part1, 5}, {part2, 9}};
+    EXPECT_EQ(14, co_await AsyncReadV(fd_, iov, 2, 10));
+    EXPECT_STREQ("hello", part1);
+    EXPECT_STREQ(" async io", part2);
+
+    iovec_t wiov[] = {{data.data(), 5}, {data.data(), 5}};
+    EXPECT_EQ(10, co_await AsyncWriteV(fd_, wiov, 2, 0));
+    EXPECT_EQ(10, co_await AsyncRead(fd_, buffer.data(), 10, 0));
+    EXPECT_EQ("hellohello", buffer.substr(0, 10));
+
+    EXPECT_EQ(-EBADF, co_await AsyncRead(-1, buffer.data(), buffer.size(), 0));
+  };
+  SyncAwait(task().Via(&executor));
+}
+
+TEST_F(AsyncIOTest, TestResumeContext) {
+  executors::SimpleExecutor executor(4, false, executors::IOBackend::kIoUring);
+  auto task = [&]() -> Lazy<> {
+    char c = 'x';
+    for (int i = 0; i < 100; ++i) {
+      auto id = std::this_thread::get_id();
+      EXPECT_EQ(1, co_await AsyncWrite(fd_, &c, 1, i));
+      // 在挂起之前所在的工作线程上恢复
+      EXPECT_EQ(id, std::this_thread::get_id());
+      EXPECT_EQ(&executor, co_await CurrentExecutor{});
+    }
+  };
+  SyncAwait(task().Via(&executor));
+}
+
+TEST_F(AsyncIOTest, TestWithoutExecutor) {
+  // 没有Executor时同步执行
+  auto task = [&]() -> Lazy<> {
+    std::string data = "sync";
+    EXPECT_EQ(data.size(), co_await AsyncWrite(fd_, data.data(), data.size(), 0));
+    std::string buffer(data.size(), '\0');
+    EXPECT_EQ(data.size(), co_await AsyncRead(fd_, buffer.data(), buffer.size(), 0));
+    EXPECT_EQ(data, buffer);
+    EXPECT_EQ(0, co_await AsyncFsync(fd_));
+    EXPECT_EQ(-EBADF, co_await AsyncRead(-1, buffer.data(), buffer.size(), 0));
+  };
+  SyncAwait(task());
+}
+
+namespace {
+
+/// 通过Promise/Future桥接IOExecutor的回调，作为对比
+Future<int64_t> SubmitRead(IOExecutor *io, int fd, void *buffer, size_t len, off_t offset) {
+  Promise<int64_t> p;
+  auto f = p.GetFuture();
+  io->SubmitIO(fd, IOCB_CMD_PREAD, buffer, len, offset, [p = std::move(p)](io_event_t &event) mutable {
+    p.SetValue(static_cast<int64_t>(event.res));
+  });
+  return f;
+}
+
+} // namespace
+
+TEST_F(AsyncIOTest, TestBridgeBench) {
+  constexpr int kLoop = 100000;
+  constexpr size_t kBlock = 4096;
+  std::string data(kBlock, 'r');
+  ASSERT_EQ(kBlock, pwrite(fd_, data.data(), data.size(), 0));
+  executors::SimpleExecutor executor(1, false, executors::IOBackend::kIoUring);
+  auto io = executor.GetIOExecutor();
+  std::string buffer(kBlock, '\0');
+
+  auto report = [](const char *name, std::size_t allocs) {
+    std::cout << std::right << std::setw(30) << name << ": "
+              << static_cast<double>(allocs) / kLoop << " allocs/op" << std::endl;
+  };
+
+  auto awaiter_loop = [&]() -> Lazy<> {
+    for (int i = 0; i < kLoop; ++i) {
+      EXPECT_EQ(kBlock, co_await AsyncRead(fd_, buffer.data(), kBlock, 0));
+    }
+  };
+  auto bridge_loop = [&]() -> Lazy<> {
+    for (int i = 0; i < kLoop; ++i) {
+      EXPECT_EQ(kBlock, co_await SubmitRead(io, fd_, buffer.data(), kBlock, 0));
+    }
+  };
+
+  auto before = AllocCount();
+  {
+    ScopedBench bench("AsyncRead awaiter", kLoop);
+    SyncAwait(awaiter_loop().Via(&executor));
+  }
+  report("AsyncRead awaiter", AllocCount() - before);
+
+  before = AllocCount();
+  {
+    ScopedBench bench("Promise/Future bridge", kLoop);
+    SyncAwait(bridge_loop().Via(&executor));
+  }
+  report("Promise/Future bridge", AllocCount() - before);
+}
+
+} // namespace async_simple::coro
+
+#endif
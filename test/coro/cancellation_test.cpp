@@ -0,0 +1,254 @@
+#include <async_simple/base/cancellation.hpp>
+
+#include "async_simple_test.hpp"
+#include "scoped_bench.hpp"
+
+#include <async_simple/coro/async_io.hpp>
+#include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/coro/sleep.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+namespace async_simple::coro {
+
+namespace {
+
+/// 等待条件成立，超时返回false
+template<typename F>
+bool WaitFor(F &&cond, std::chrono::milliseconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!cond()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(1ms);
+  }
+  return true;
+}
+
+} // namespace
+
+class CancellationTest : public testing::Test {};
+
+TEST_F(CancellationTest, TestSleep) {
+  executors::SimpleExecutor executor(2);
+  std::stop_source source;
+  std::binary_semaphore sem(0);
+  Try<void> result;
+  auto start = std::chrono::steady_clock::now();
+  sleep(10s).SetStopToken(source.get_token()).Via(&executor).Start([&](Try<void> &&t) {
+    result = std::move(t);
+    sem.release();
+  });
+  std::this_thread::sleep_for(10ms);
+  source.request_stop();
+  sem.acquire();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+  ASSERT_TRUE(result.HasException());
+  EXPECT_THROW(std::rethrow_exception(result.GetException()), OperationCancelled);
+  // 取消时定时器从时间轮中移除，不会一直保留到原来的到期时间
+  EXPECT_TRUE(executor.GetTimerService()->Empty());
+
+  // 已经取消的token不再挂起
+  EXPECT_THROW(SyncAwait(sleep(10s).SetStopToken(source.get_token()).Via(&executor)),
+               OperationCancelled);
+  // 没有请求取消时正常完成
+  std::stop_source unused;
+  SyncAwait(sleep(1ms).SetStopToken(unused.get_token()).Via(&executor));
+}
+
+TEST_F(CancellationTest, TestYieldAndSchedule) {
+  executors::SimpleExecutor executor(2);
+  std::stop_source source;
+  std::atomic<int> count{0};
+  auto spin = [&]() -> Lazy<> {
+    while (true) {
+      co_await Yield{};
+      ++count;
+    }
+  };
+  std::binary_semaphore sem(0);
+  Try<void> result;
+  spin().SetStopToken(source.get_token()).Via(&executor).Start([&](Try<void> &&t) {
+    result = std::move(t);
+    sem.release();
+  });
+  ASSERT_TRUE(WaitFor([&] { return count > 100; }, 5s));
+  source.request_stop();
+  sem.acquire();
+  EXPECT_TRUE(result.HasException());
+
+  auto schedule = [&]() -> Lazy<> {
+    co_await static_cast<Executor &>(executor).Schedule();
+  };
+  EXPECT_THROW(SyncAwait(schedule().SetStopToken(source.get_token()).Via(&executor)),
+               OperationCancelled);
+}
+
+TEST_F(CancellationTest, TestPropagation) {
+  executors::SimpleExecutor executor(2);
+  std::stop_source source;
+  std::atomic<bool> inner_started{false};
+  auto inner = [&]() -> Lazy<int> {
+    auto token = co_await CurrentStopToken{};
+    EXPECT_TRUE(token.stop_possible());
+    inner_started = true;
+    co_await sleep(10s);
+    co_return 1;
+  };
+  auto middle = [&]() -> Lazy<int> {
+    co_return co_await inner() + 1;
+  };
+  auto outer = [&]() -> Lazy<int> {
+    co_return co_await middle() + 1;
+  };
+  std::binary_semaphore sem(0);
+  Try<int> result;
+  auto start = std::chrono::steady_clock::now();
+  outer().SetStopToken(source.get_token()).Via(&executor).Start([&](Try<int> &&t) {
+    result = std::move(t);
+    sem.release();
+  });
+  ASSERT_TRUE(WaitFor([&] { return inner_started.load(); }, 5s));
+  source.request_stop();
+  sem.acquire();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+  EXPECT_THROW(result.Value(), OperationCancelled);
+
+  // 子协程单独设置的token不会被覆盖
+  std::stop_source own;
+  auto child_token = [&]() -> Lazy<bool> {
+    auto token = co_await CurrentStopToken{};
+    co_return token == own.get_token();
+  };
+  auto parent = [&]() -> Lazy<bool> {
+    co_return co_await child_token().SetStopToken(own.get_token());
+  };
+  EXPECT_TRUE(SyncAwait(parent().SetStopToken(source.get_token()).Via(&executor)));
+
+  // CollectAll的子任务继承父协程的token
+  auto collect = [&]() -> Lazy<std::size_t> {
+    std::vector<Lazy<int>> input;
+    input.push_back(inner());
+    input.push_back(inner());
+    auto out = co_await CollectAll(std::move(input));
+    std::size_t cancelled = 0;
+    for (auto &t : out) {
+      cancelled += t.HasException();
+    }
+    co_return cancelled;
+  };
+  EXPECT_EQ(2u, SyncAwait(collect().SetStopToken(source.get_token()).Via(&executor)));
+
+  // RescheduleLazy的子任务同样继承
+  auto collect_para = [&]() -> Lazy<std::size_t> {
+    std::vector<RescheduleLazy<int>> input;
+    input.push_back(inner().Via(&executor));
+    input.push_back(inner().Via(&executor));
+    auto out = co_await CollectAllWindowedPara(1, false, std::move(input));
+    co_return out[0].HasException() + out[1].HasException();
+  };
+  EXPECT_EQ(2u, SyncAwait(collect_para().SetStopToken(source.get_token()).Via(&executor)));
+}
+
+TEST_F(CancellationTest, TestCollectAny) {
+  executors::SimpleExecutor executor(4);
+  constexpr int kLosers = 8;
+  std::atomic<int> losers_done{0};
+  auto winner = []() -> Lazy<int> {
+    co_await sleep(10ms);
+    co_return 0;
+  };
+  auto loser = [&](int i) -> Lazy<int> {
+    try {
+      co_await sleep(10s);
+    } catch (...) {
+      ++losers_done;
+      throw;
+    }
+    co_return i;
+  };
+  auto hedged = [&]() -> Lazy<std::size_t> {
+    std::vector<Lazy<int>> input;
+    input.push_back(winner());
+    for (int i = 1; i <= kLosers; ++i) {
+      input.push_back(loser(i));
+    }
+    auto out = co_await CollectAny(std::move(input));
+    co_return out.index;
+  };
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(0u, SyncAwait(hedged().Via(&executor)));
+  // 失败的一方在winner完成后很快被回收，而不是等到10s之后
+  ASSERT_TRUE(WaitFor([&] { return losers_done == kLosers; }, 1s));
+  auto reclaim = std::chrono::steady_clock::now() - start;
+  std::cout << "hedged request reclaim: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(reclaim).count() << " us" << std::endl;
+
+  // 父协程的取消请求转发给所有的任务
+  std::stop_source source;
+  auto all_losers = [&]() -> Lazy<std::size_t> {
+    std::vector<Lazy<int>> input;
+    for (int i = 1; i <= kLosers; ++i) {
+      input.push_back(loser(i));
+    }
+    auto out = co_await CollectAny(std::move(input));
+    EXPECT_TRUE(out.value.HasException());
+    co_return out.index;
+  };
+  losers_done = 0;
+  std::binary_semaphore sem(0);
+  all_losers().SetStopToken(source.get_token()).Via(&executor).Start([&](Try<std::size_t> &&) {
+    sem.release();
+  });
+  std::this_thread::sleep_for(10ms);
+  source.request_stop();
+  sem.acquire();
+  ASSERT_TRUE(WaitFor([&] { return losers_done == kLosers; }, 1s));
+}
+
+TEST_F(CancellationTest, TestAsyncIO) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  std::stop_source source;
+  source.request_stop();
+  auto read = [&]() -> Lazy<int64_t> {
+    char buffer[16];
+    // 管道中没有数据，提交的话会一直阻塞
+    co_return co_await AsyncRead(fds[0], buffer, sizeof(buffer), 0);
+  };
+  EXPECT_EQ(-ECANCELED, SyncAwait(read().SetStopToken(source.get_token())));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST_F(CancellationTest, TestOverheadBench) {
+  constexpr int kLoop = 100000;
+  auto chain = []() -> Lazy<int> { co_return 1; };
+  auto task = [&]() -> Lazy<int> { co_return co_await chain(); };
+  {
+    ScopedBench bench("lazy without stop token", kLoop);
+    for (int i = 0; i < kLoop; ++i) {
+      SyncAwait(task());
+    }
+  }
+  std::stop_source source;
+  {
+    ScopedBench bench("lazy with stop token", kLoop);
+    for (int i = 0; i < kLoop; ++i) {
+      SyncAwait(task().SetStopToken(source.get_token()));
+    }
+  }
+}
+
+} // namespace async_simple::coro
@@ -0,0 +1,213 @@
+#include <async_simple/coro/channel.hpp>
+
+#include "async_simple_test.hpp"
+#include "common.hpp"
+#include "scoped_bench.hpp"
+
+#include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace async_simple::coro {
+
+class ChannelTest : public testing::Test {};
+
+TEST_F(ChannelTest, TestTrySendRecv) {
+  Channel<std::unique_ptr<int>> channel(3);
+  EXPECT_EQ(3u, channel.Capacity());
+  EXPECT_FALSE(channel.TryRecv());
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(channel.TrySend(std::make_unique<int>(i)));
+  }
+  EXPECT_EQ(3u, channel.SizeHint());
+  // 失败时不会移动参数
+  auto extra = std::make_unique<int>(3);
+  EXPECT_FALSE(channel.TrySend(std::move(extra)));
+  ASSERT_TRUE(extra);
+
+  // 多绕几圈，检查环形缓冲区的序号
+  for (int i = 0; i < 10; ++i) {
+    auto value = channel.TryRecv();
+    ASSERT_TRUE(value);
+    EXPECT_EQ(i, **value);
+    ASSERT_TRUE(channel.TrySend(std::make_unique<int>(i + 3)));
+  }
+  channel.Close();
+  EXPECT_TRUE(channel.IsClosed());
+  EXPECT_FALSE(channel.TrySend(std::make_unique<int>(0)));
+  for (int i = 10; i < 13; ++i) {
+    auto value = channel.TryRecv();
+    ASSERT_TRUE(value);
+    EXPECT_EQ(i, **value);
+  }
+  EXPECT_FALSE(channel.TryRecv());
+
+  // 析构时销毁缓冲区中剩余的元素
+  int state = 0;
+  {
+    Channel<Dummy> dummies(2);
+    ASSERT_TRUE(dummies.TrySend(Dummy(&state)));
+    EXPECT_EQ(CONSTRUCTED, state);
+  }
+  EXPECT_EQ(CONSTRUCTED | DESTRUCTED, state);
+}
+
+TEST_F(ChannelTest, TestBackpressure) {
+  // 没有Executor时等待者在对端的操作中直接恢复
+  Channel<int> channel(1);
+  std::vector<int> sent;
+  auto producer = [&]() -> Lazy<> {
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_TRUE(co_await channel.Send(i));
+      sent.push_back(i);
+    }
+  };
+  producer().Start([](Try<void> &&) {});
+  // 第一个元素写入缓冲区，第二个元素挂起等待
+  EXPECT_EQ(std::vector<int>{0}, sent);
+  EXPECT_EQ(0, channel.TryRecv().value());
+  // 接收之后挂起的发送者把元素写入缓冲区，然后又因为第三个元素挂起
+  EXPECT_EQ((std::vector<int>{0, 1}), sent);
+  EXPECT_EQ(1, channel.TryRecv().value());
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), sent);
+  EXPECT_EQ(2, channel.TryRecv().value());
+
+  std::vector<int> received;
+  auto consumer = [&]() -> Lazy<> {
+    while (auto value = co_await channel.Recv()) {
+      received.push_back(*value);
+    }
+  };
+  consumer().Start([](Try<void> &&) {});
+  EXPECT_TRUE(received.empty());
+  // 元素直接交给等待的接收者
+  ASSERT_TRUE(channel.TrySend(5));
+  EXPECT_EQ(std::vector<int>{5}, received);
+  EXPECT_EQ(0u, channel.SizeHint());
+  channel.Close();
+  EXPECT_EQ(std::vector<int>{5}, received);
+}
+
+TEST_F(ChannelTest, TestClose) {
+  Channel<std::string> channel(1);
+  ASSERT_TRUE(channel.TrySend("a"));
+  int failed_senders = 0;
+  int finished_receivers = 0;
+  auto sender = [&]() -> Lazy<> {
+    if (!co_await channel.Send("b")) {
+      ++failed_senders;
+    }
+  };
+  auto receiver = [&]() -> Lazy<> {
+    EXPECT_FALSE(co_await channel.Recv());
+    ++finished_receivers;
+  };
+  sender().Start([](Try<void> &&) {});
+  sender().Start([](Try<void> &&) {});
+  EXPECT_EQ(0, failed_senders);
+  channel.Close();
+  EXPECT_EQ(2, failed_senders);
+  // 关闭之后仍然可以取出剩余的元素
+  auto drain = [&]() -> Lazy<std::optional<std::string>> { co_return co_await channel.Recv(); };
+  EXPECT_EQ("a", SyncAwait(drain()).value());
+
+  Channel<std::string> empty(1);
+  auto wait_empty = [&]() -> Lazy<> {
+    EXPECT_FALSE(co_await empty.Recv());
+    ++finished_receivers;
+  };
+  wait_empty().Start([](Try<void> &&) {});
+  wait_empty().Start([](Try<void> &&) {});
+  EXPECT_EQ(0, finished_receivers);
+  empty.Close();
+  EXPECT_EQ(2, finished_receivers);
+  receiver().Start([](Try<void> &&) {});
+  EXPECT_EQ(3, finished_receivers);
+}
+
+TEST_F(ChannelTest, TestMultiProducerConsumer) {
+  constexpr int kProducerNum = 8;
+  constexpr int kConsumerNum = 8;
+  constexpr int kLoop = 2000;
+  executors::SimpleExecutor executor(4);
+  Channel<int> channel(16);
+  std::atomic<long> sum{0};
+  std::atomic<int> count{0};
+  std::atomic<int> running{kProducerNum};
+  auto producer = [&](int id) -> Lazy<> {
+    for (int i = 0; i < kLoop; ++i) {
+      EXPECT_TRUE(co_await channel.Send(id * kLoop + i));
+    }
+    if (--running == 0) {
+      channel.Close();
+    }
+  };
+  auto consumer = [&]() -> Lazy<> {
+    while (auto value = co_await channel.Recv()) {
+      sum += *value;
+      ++count;
+    }
+  };
+  auto test = [&]() -> Lazy<> {
+    std::vector<Lazy<>> input;
+    for (int i = 0; i < kConsumerNum; ++i) {
+      input.push_back(consumer());
+    }
+    for (int i = 0; i < kProducerNum; ++i) {
+      input.push_back(producer(i));
+    }
+    co_await CollectAllPara(std::move(input));
+  };
+  SyncAwait(test().Via(&executor));
+  constexpr long kTotal = kProducerNum * kLoop;
+  EXPECT_EQ(kTotal, count.load());
+  EXPECT_EQ(kTotal * (kTotal - 1) / 2, sum.load());
+  EXPECT_FALSE(channel.TryRecv());
+}
+
+TEST_F(ChannelTest, TestBench) {
+  constexpr int kMessageNum = 100000;
+  constexpr std::size_t kCapacity = 256;
+  executors::SimpleExecutor executor(4);
+  // 输出的是每条消息的平均耗时，倒数即每秒的消息数
+  for (int n : {1, 2, 4, 8}) {
+    Channel<int> channel(kCapacity);
+    std::atomic<int> running{n};
+    std::atomic<int> count{0};
+    auto producer = [&](int num) -> Lazy<> {
+      for (int i = 0; i < num; ++i) {
+        co_await channel.Send(i);
+      }
+      if (--running == 0) {
+        channel.Close();
+      }
+    };
+    auto consumer = [&]() -> Lazy<> {
+      int local = 0;
+      while (co_await channel.Recv()) {
+        ++local;
+      }
+      count += local;
+    };
+    auto test = [&]() -> Lazy<> {
+      std::vector<Lazy<>> input;
+      for (int i = 0; i < n; ++i) {
+        input.push_back(consumer());
+        input.push_back(producer(kMessageNum / n));
+      }
+      co_await CollectAllPara(std::move(input));
+    };
+    {
+      ScopedBench bench("Channel " + std::to_string(n) + "P" + std::to_string(n) + "C", kMessageNum);
+      SyncAwait(test().Via(&executor));
+    }
+    EXPECT_EQ(kMessageNum / n * n, count.load());
+  }
+}
+
+} // namespace async_simple::coro
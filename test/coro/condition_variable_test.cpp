@@ -0,0 +1,100 @@
+#include <async_simple/coro/condition_variable.hpp>
+
+#include "async_simple_test.hpp"
+
+#include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <deque>
+#include <vector>
+
+namespace async_simple::coro {
+
+class ConditionVariableTest : public testing::Test {};
+
+TEST_F(ConditionVariableTest, TestProducerConsumer) {
+  constexpr int kProducers = 4;
+  constexpr int kConsumers = 4;
+  constexpr int kItems = 1000;
+  executors::SimpleExecutor executor(4);
+  Mutex mutex;
+  ConditionVariable not_empty;
+  std::deque<int> queue;
+  int done = 0;
+  long sum = 0;
+  auto producer = [&](int base) -> Lazy<> {
+    for (int i = 0; i < kItems; ++i) {
+      auto lock = co_await mutex.CoScopedLock();
+      queue.push_back(base + i);
+      not_empty.NotifyOne();
+    }
+    auto lock = co_await mutex.CoScopedLock();
+    ++done;
+    not_empty.NotifyAll();
+  };
+  auto consumer = [&]() -> Lazy<> {
+    while (true) {
+      auto lock = co_await mutex.CoScopedLock();
+      co_await not_empty.Wait(mutex, [&] { return !queue.empty() || done == kProducers; });
+      if (queue.empty()) {
+        break;
+      }
+      sum += queue.front();
+      queue.pop_front();
+    }
+  };
+  auto test = [&]() -> Lazy<> {
+    std::vector<Lazy<>> input;
+    for (int i = 0; i < kConsumers; ++i) {
+      input.push_back(consumer());
+    }
+    for (int i = 0; i < kProducers; ++i) {
+      input.push_back(producer(i * kItems));
+    }
+    co_await CollectAllPara(std::move(input));
+  };
+  SyncAwait(test().Via(&executor));
+  long total = kProducers * kItems;
+  EXPECT_EQ(total * (total - 1) / 2, sum);
+}
+
+TEST_F(ConditionVariableTest, TestNotifyAll) {
+  constexpr int kWaiters = 16;
+  executors::SimpleExecutor executor(4);
+  Mutex mutex;
+  ConditionVariable cv;
+  bool ready = false;
+  int waiting = 0;
+  int woken = 0;
+  auto waiter = [&]() -> Lazy<> {
+    auto lock = co_await mutex.CoScopedLock();
+    ++waiting;
+    co_await cv.Wait(mutex, [&] { return ready; });
+    ++woken;
+  };
+  auto notifier = [&]() -> Lazy<> {
+    while (true) {
+      auto lock = co_await mutex.CoScopedLock();
+      if (waiting == kWaiters) {
+        ready = true;
+        cv.NotifyAll();
+        break;
+      }
+      lock.Unlock();
+      co_await Yield{};
+    }
+  };
+  auto test = [&]() -> Lazy<> {
+    std::vector<Lazy<>> input;
+    for (int i = 0; i < kWaiters; ++i) {
+      input.push_back(waiter());
+    }
+    input.push_back(notifier());
+    co_await CollectAllPara(std::move(input));
+  };
+  SyncAwait(test().Via(&executor));
+  EXPECT_EQ(kWaiters, woken);
+}
+
+} // namespace async_simple::coro
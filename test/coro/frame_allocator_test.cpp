@@ -0,0 +1,165 @@
+#include <async_simple/coro/frame_allocator.hpp>
+
+#include "async_simple_test.hpp"
+#include "scoped_bench.hpp"
+
+#include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <memory_resource>
+#include <vector>
+
+namespace async_simple::coro {
+
+ASYNC_SIMPLE_FRAME_ALLOC_WARNINGS_PUSH
+
+namespace {
+
+struct AllocStat {
+  std::size_t allocs{0};
+  std::size_t frees{0};
+  std::size_t bytes{0};
+};
+
+/// 统计分配次数的分配器
+template<typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(AllocStat *s) : stat(s) {}
+  template<typename U>
+  CountingAllocator(const CountingAllocator<U> &other) : stat(other.stat) {}
+
+  T *allocate(std::size_t n) {
+    ++stat->allocs;
+    stat->bytes += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T *p, std::size_t n) {
+    ++stat->frees;
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  AllocStat *stat;
+};
+
+template<typename Alloc>
+Lazy<int> Add(std::allocator_arg_t, Alloc, int a, int b) {
+  co_return a + b;
+}
+
+template<typename Alloc>
+Lazy<int> Chain(std::allocator_arg_t, Alloc alloc, int depth) {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return depth + co_await Chain(std::allocator_arg, alloc, depth - 1);
+}
+
+struct Calculator {
+  template<typename Alloc>
+  Lazy<int> Mul(std::allocator_arg_t, Alloc, int a) {
+    co_return a * factor;
+  }
+  int factor{3};
+};
+
+} // namespace
+
+class FrameAllocatorTest : public testing::Test {};
+
+TEST_F(FrameAllocatorTest, TestAllocatorArg) {
+  AllocStat stat;
+  CountingAllocator<char> alloc(&stat);
+  ASSERT_EQ(3, SyncAwait(Add(std::allocator_arg, alloc, 1, 2)));
+  EXPECT_EQ(1u, stat.allocs);
+  EXPECT_EQ(1u, stat.frees);
+
+  ASSERT_EQ(55, SyncAwait(Chain(std::allocator_arg, alloc, 10)));
+  EXPECT_EQ(12u, stat.allocs);
+  EXPECT_EQ(12u, stat.frees);
+
+  // 成员函数和lambda的第一个参数是对象本身
+  Calculator calculator;
+  ASSERT_EQ(6, SyncAwait(calculator.Mul(std::allocator_arg, alloc, 2)));
+  EXPECT_EQ(13u, stat.allocs);
+  auto lambda = [](std::allocator_arg_t, CountingAllocator<char>, int v) -> Lazy<int> {
+    co_return v;
+  };
+  ASSERT_EQ(7, SyncAwait(lambda(std::allocator_arg, alloc, 7)));
+  EXPECT_EQ(14u, stat.allocs);
+  EXPECT_EQ(14u, stat.frees);
+
+  // std::allocator使用默认的内存池
+  auto before = util::FramePool::GetStats();
+  ASSERT_EQ(3, SyncAwait(Add(std::allocator_arg, std::allocator<char>(), 1, 2)));
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+  EXPECT_LT(before.allocs, util::FramePool::GetStats().allocs);
+#endif
+}
+
+TEST_F(FrameAllocatorTest, TestPmr) {
+  // 上游是null_memory_resource，所有的帧都必须来自buffer
+  std::vector<std::byte> buffer(64 * 1024);
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                            std::pmr::null_memory_resource());
+  std::pmr::polymorphic_allocator<> alloc(&arena);
+  ASSERT_EQ(5050, SyncAwait(Chain(std::allocator_arg, alloc, 100)));
+
+  executors::SimpleExecutor executor(2);
+  auto before = util::FramePool::GetStats();
+  auto request = [&]() -> Lazy<int> {
+    std::pmr::vector<Lazy<int>> input(alloc);
+    for (int i = 0; i < 10; ++i) {
+      input.push_back(Chain(std::allocator_arg, alloc, i));
+    }
+    auto out = co_await CollectAll(std::allocator_arg, alloc, std::move(input),
+                                   std::pmr::polymorphic_allocator<Try<int>>(&arena));
+    int total = 0;
+    for (auto &v : out) {
+      total += v.Value();
+    }
+    co_return total;
+  };
+  ASSERT_EQ(165, SyncAwait(request().Via(&executor)));
+  auto after = util::FramePool::GetStats();
+  // 来自内存池的只有request自身和CollectAll启动每个子任务时的DetachedCoroutine
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+  EXPECT_EQ(1u + 10u, after.allocs - before.allocs);
+#endif
+
+  auto windowed = [&]() -> Lazy<std::size_t> {
+    std::pmr::vector<Lazy<int>> input(alloc);
+    for (int i = 0; i < 10; ++i) {
+      input.push_back(Add(std::allocator_arg, alloc, i, 1));
+    }
+    auto out = co_await CollectAllWindowedPara(std::allocator_arg, alloc, 3, false, std::move(input),
+                                               std::pmr::polymorphic_allocator<Try<int>>(&arena));
+    co_return out.size();
+  };
+  ASSERT_EQ(10u, SyncAwait(windowed().Via(&executor)));
+}
+
+TEST_F(FrameAllocatorTest, TestArenaBench) {
+  constexpr int kLoop = 10000;
+  {
+    ScopedBench bench("chain 30 (frame pool)", kLoop);
+    for (int i = 0; i < kLoop; ++i) {
+      SyncAwait(Chain(std::allocator_arg, std::allocator<char>(), 30));
+    }
+  }
+  std::vector<std::byte> buffer(64 * 1024);
+  {
+    ScopedBench bench("chain 30 (monotonic arena)", kLoop);
+    for (int i = 0; i < kLoop; ++i) {
+      // 每个请求一个arena，结束时一次性释放
+      std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+      SyncAwait(Chain(std::allocator_arg, std::pmr::polymorphic_allocator<>(&arena), 30));
+    }
+  }
+}
+
+ASYNC_SIMPLE_FRAME_ALLOC_WARNINGS_POP
+
+} // namespace async_simple::coro
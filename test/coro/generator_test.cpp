@@ -0,0 +1,198 @@
+#include <async_simple/coro/generator.hpp>
+
+#include "async_simple_test.hpp"
+#include "alloc_counter.hpp"
+#include "common.hpp"
+#include "scoped_bench.hpp"
+
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace async_simple::coro {
+
+class AsyncGeneratorTest : public testing::Test {};
+
+namespace {
+
+AsyncGenerator<int> Range(int n, bool *started = nullptr) {
+  if (started) {
+    *started = true;
+  }
+  for (int i = 0; i < n; ++i) {
+    co_yield i;
+  }
+}
+
+} // namespace
+
+TEST_F(AsyncGeneratorTest, TestNext) {
+  bool started = false;
+  auto gen = Range(5, &started);
+  // 和Lazy一样，第一次Next之前不会执行
+  EXPECT_FALSE(started);
+  auto test = [&]() -> Lazy<std::vector<int>> {
+    std::vector<int> result;
+    while (auto value = co_await gen.Next()) {
+      result.push_back(*value);
+    }
+    // 结束之后继续Next返回std::nullopt
+    EXPECT_FALSE(co_await gen.Next());
+    co_return result;
+  };
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), SyncAwait(test()));
+  EXPECT_TRUE(started);
+  EXPECT_TRUE(gen.IsDone());
+
+  // 只能移动的类型，co_yield移动的局部变量和临时对象
+  auto unique = []() -> AsyncGenerator<std::unique_ptr<int>> {
+    auto p = std::make_unique<int>(1);
+    co_yield std::move(p);
+    co_yield std::make_unique<int>(2);
+  };
+  auto take = [&]() -> Lazy<int> {
+    int sum = 0;
+    auto g = unique();
+    while (auto p = co_await g.Next()) {
+      sum += **p;
+    }
+    co_return sum;
+  };
+  EXPECT_EQ(3, SyncAwait(take()));
+
+  // co_yield左值时复制，生成器之后读到的仍然是原来的值
+  auto named = []() -> AsyncGenerator<std::string> {
+    std::string s = "hello";
+    const std::string suffix = "!";
+    co_yield s;
+    EXPECT_EQ("hello", s);
+    s += " world";
+    co_yield s;
+    co_yield suffix;
+    co_yield s + suffix;
+  };
+  auto collect = [&]() -> Lazy<std::vector<std::string>> {
+    std::vector<std::string> result;
+    auto g = named();
+    while (auto value = co_await g.Next()) {
+      result.push_back(std::move(*value));
+    }
+    co_return result;
+  };
+  EXPECT_EQ((std::vector<std::string>{"hello", "hello world", "!", "hello world!"}), SyncAwait(collect()));
+}
+
+TEST_F(AsyncGeneratorTest, TestExecutor) {
+  executors::SimpleExecutor executor(2);
+  auto get_value = [](int v) -> Lazy<int> {
+    co_await Yield{};
+    co_return v;
+  };
+  // 生成器内部可以co_await，并且使用调用方的Executor
+  auto gen = [&](int n) -> AsyncGenerator<int> {
+    for (int i = 0; i < n; ++i) {
+      auto current = co_await CurrentExecutor{};
+      EXPECT_EQ(&executor, current);
+      EXPECT_TRUE(executor.CurrentThreadInExecutor());
+      co_yield co_await get_value(i);
+    }
+  };
+  auto test = [&]() -> Lazy<int> {
+    int sum = 0;
+    co_await gen(100).ForEach([&](int v) { sum += v; });
+    co_await gen(10).ForEach([&](int v) -> Lazy<> {
+      co_await Yield{};
+      sum += v;
+    });
+    co_return sum;
+  };
+  EXPECT_EQ(4950 + 45, SyncAwait(test().Via(&executor)));
+}
+
+TEST_F(AsyncGeneratorTest, TestExceptionAndDestroy) {
+  auto throwing = []() -> AsyncGenerator<int> {
+    co_yield 1;
+    throw std::runtime_error("scan failed");
+  };
+  auto test = [&]() -> Lazy<> {
+    auto gen = throwing();
+    EXPECT_EQ(1, *co_await gen.Next());
+    bool caught = false;
+    try {
+      co_await gen.Next();
+    } catch (const std::runtime_error &) {
+      caught = true;
+    }
+    EXPECT_TRUE(caught);
+    EXPECT_FALSE(co_await gen.Next());
+  };
+  SyncAwait(test());
+
+  // 提前销毁挂起的生成器时会析构帧中的局部变量
+  int state = 0;
+  auto endless = [&]() -> AsyncGenerator<int> {
+    Dummy dummy(&state);
+    for (int i = 0;; ++i) {
+      co_yield i;
+    }
+  };
+  auto take_three = [&]() -> Lazy<> {
+    auto gen = endless();
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(i, *co_await gen.Next());
+    }
+    EXPECT_EQ(CONSTRUCTED, state);
+  };
+  SyncAwait(take_three());
+  EXPECT_EQ(CONSTRUCTED | DESTRUCTED, state);
+}
+
+TEST_F(AsyncGeneratorTest, TestStreamingMemory) {
+  constexpr int kRows = 10000;
+  auto collect = [&]() -> Lazy<std::vector<int>> {
+    std::vector<int> rows;
+    for (int i = 0; i < kRows; ++i) {
+      rows.push_back(i);
+    }
+    co_return rows;
+  };
+  auto sum_vector = [&]() -> Lazy<long> {
+    long sum = 0;
+    for (auto v : co_await collect()) {
+      sum += v;
+    }
+    co_return sum;
+  };
+  auto sum_stream = [&]() -> Lazy<long> {
+    long sum = 0;
+    auto gen = Range(kRows);
+    while (auto v = co_await gen.Next()) {
+      sum += *v;
+    }
+    co_return sum;
+  };
+  constexpr long kExpected = static_cast<long>(kRows) * (kRows - 1) / 2;
+  EXPECT_EQ(kExpected, SyncAwait(sum_vector()));
+  EXPECT_EQ(kExpected, SyncAwait(sum_stream()));
+
+  // 流式读取时分配次数和行数无关
+  auto before = AllocCount();
+  SyncAwait(sum_stream());
+  auto streaming_allocs = AllocCount() - before;
+  EXPECT_LT(streaming_allocs, 10u);
+
+  {
+    ScopedBench bench("vector<int> " + std::to_string(kRows), kRows);
+    SyncAwait(sum_vector());
+  }
+  {
+    ScopedBench bench("AsyncGenerator<int> " + std::to_string(kRows), kRows);
+    SyncAwait(sum_stream());
+  }
+}
+
+} // namespace async_simple::coro
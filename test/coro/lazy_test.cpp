@@ -1,10 +1,12 @@
 #include <async_simple/coro/lazy.hpp>
 
 #include "async_simple_test.hpp"
+#include "alloc_counter.hpp"
 #include "scoped_bench.hpp"
 
 #include <async_simple/executor/simple_executor.hpp>
 #include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/sleep.hpp>
 
 using namespace std::chrono_literals;
 
@@ -760,6 +762,111 @@ TEST_F(LazyTest, TestCollectAllBatched) {
   }
 }
 
+TEST_F(LazyTest, TestCollectAllWindowedSliding) {
+  constexpr int kTaskNum = 100;
+  constexpr std::size_t kWindow = 8;
+  executors::SimpleExecutor e1(4);
+  std::atomic<std::size_t> inflight{0};
+  std::atomic<std::size_t> max_inflight{0};
+  auto task = [&](int i) -> Lazy<int> {
+    auto now = inflight.fetch_add(1) + 1;
+    auto prev = max_inflight.load();
+    while (prev < now && !max_inflight.compare_exchange_weak(prev, now)) {}
+    co_await coro::sleep(std::chrono::microseconds(i % 7 * 300));
+    inflight.fetch_sub(1);
+    co_return i;
+  };
+  for (bool yield : {false, true}) {
+    max_inflight = 0;
+    auto test = [&]() -> Lazy<> {
+      std::vector<Lazy<int>> input;
+      for (int i = 0; i < kTaskNum; ++i) {
+        input.push_back(task(i));
+      }
+      auto out = co_await CollectAllWindowed(kWindow, yield, std::move(input));
+      EXPECT_EQ(kTaskNum, out.size());
+      for (int i = 0; i < kTaskNum; ++i) {
+        EXPECT_EQ(i, out[i].Value());
+      }
+    };
+    SyncAwait(test().Via(&e1));
+    EXPECT_EQ(kWindow, max_inflight.load());
+  }
+
+  // RescheduleLazy和Para
+  auto test_para = [&]() -> Lazy<> {
+    std::vector<RescheduleLazy<int>> input;
+    for (int i = 0; i < kTaskNum; ++i) {
+      input.push_back(task(i).Via(&e1));
+    }
+    auto out = co_await CollectAllWindowedPara(kWindow, false, std::move(input));
+    for (int i = 0; i < kTaskNum; ++i) {
+      EXPECT_EQ(i, out[i].Value());
+    }
+  };
+  max_inflight = 0;
+  SyncAwait(test_para().Via(&e1));
+  EXPECT_EQ(kWindow, max_inflight.load());
+
+  // 同步完成的任务不会递归启动下一个任务
+  auto test_sync = []() -> Lazy<> {
+    constexpr int kNum = 200000;
+    std::vector<Lazy<int>> input;
+    for (int i = 0; i < kNum; ++i) {
+      input.push_back([](int v) -> Lazy<int> { co_return v; }(i));
+    }
+    auto out = co_await CollectAllWindowed(4, false, std::move(input));
+    EXPECT_EQ(kNum - 1, out.back().Value());
+  };
+  SyncAwait(test_sync());
+}
+
+namespace detail {
+/// 改成滑动窗口之前的实现：每次等一组任务全部完成再启动下一组
+template<typename T>
+Lazy<std::vector<Try<T>>> CollectAllLockStep(std::size_t max_concurrency, std::vector<Lazy<T>> input) {
+  std::vector<Try<T>> output;
+  for (std::size_t start = 0; start < input.size(); start += max_concurrency) {
+    std::vector<Lazy<T>> group;
+    for (auto i = start; i < std::min(input.size(), start + max_concurrency); ++i) {
+      group.push_back(std::move(input[i]));
+    }
+    for (auto &t : co_await CollectAll(std::move(group))) {
+      output.push_back(std::move(t));
+    }
+  }
+  co_return std::move(output);
+}
+} // namespace detail
+
+TEST_F(LazyTest, TestCollectAllWindowedBench) {
+  // 长尾分布：每10个任务中有一个20ms，其余1ms
+  constexpr int kTaskNum = 200;
+  constexpr std::size_t kWindow = 16;
+  executors::SimpleExecutor e1(4);
+  auto task = [](int i) -> Lazy<int> {
+    co_await coro::sleep(i % 10 == 0 ? 20ms : 1ms);
+    co_return i;
+  };
+  auto make_input = [&]() {
+    std::vector<Lazy<int>> input;
+    for (int i = 0; i < kTaskNum; ++i) {
+      input.push_back(task(i));
+    }
+    return input;
+  };
+  {
+    ScopedBench bench("windowed lock-step batches", 1);
+    auto out = SyncAwait(detail::CollectAllLockStep(kWindow, make_input()).Via(&e1));
+    EXPECT_EQ(kTaskNum, out.size());
+  }
+  {
+    ScopedBench bench("windowed sliding", 1);
+    auto out = SyncAwait(CollectAllWindowed(kWindow, false, make_input()).Via(&e1));
+    EXPECT_EQ(kTaskNum, out.size());
+  }
+}
+
 TEST_F(LazyTest, TestCollectAllWithAllocator) {
   executors::SimpleExecutor e1(5);
   executors::SimpleExecutor e2(5);
@@ -1173,6 +1280,50 @@ TEST_F(LazyTest, TestLazyPerf) {
   EXPECT_EQ(total, 4650);
 }
 
+TEST_F(LazyTest, TestFramePool) {
+  constexpr int kLoop = 10000;
+  SyncAwait(detail::lazy_fn<30>());  // 预热线程缓存
+
+  auto before = util::FramePool::GetStats();
+  std::size_t allocs = 0;
+  {
+    ScopedBench bench("lazy 30 chain call (SyncAwait)", kLoop);
+    auto before_allocs = AllocCount();
+    for (int i = 0; i < kLoop; ++i) {
+      EXPECT_EQ(465, SyncAwait(detail::lazy_fn<30>()));
+    }
+    allocs = AllocCount() - before_allocs;
+  }
+  auto after = util::FramePool::GetStats();
+  std::cout << "frames: " << after.allocs - before.allocs
+            << ", cache hits: " << after.cache_hits - before.cache_hits
+            << ", operator new: " << allocs << std::endl;
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+  // SyncAwait直接驱动协程，不再有额外的DetachedCoroutine帧
+  EXPECT_EQ(31u * kLoop, after.allocs - before.allocs);
+  EXPECT_EQ(31u * kLoop, after.cache_hits - before.cache_hits);
+  EXPECT_EQ(0u, allocs);
+#endif
+
+  // 在一个线程上创建，在其他线程上销毁的帧会回到创建线程的缓存
+  executors::SimpleExecutor executor(2);
+  auto remote = [&]() -> Lazy<int> {
+    std::vector<RescheduleLazy<int>> input;
+    for (int i = 0; i < 100; ++i) {
+      input.push_back(detail::lazy_fn<1>().Via(&executor));
+    }
+    auto out = co_await CollectAllPara(std::move(input));
+    int total = 0;
+    for (auto &v : out) {
+      total += v.Value();
+    }
+    co_return total;
+  };
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(100, SyncAwait(remote().Via(&executor)));
+  }
+}
+
 TEST_F(LazyTest, TestCollectAllParallel) {
   executors::SimpleExecutor e1(10);
   auto test1 = [this]() -> Lazy<> {
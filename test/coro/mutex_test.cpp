@@ -0,0 +1,129 @@
+#include <async_simple/coro/mutex.hpp>
+
+#include "async_simple_test.hpp"
+#include "scoped_bench.hpp"
+
+#include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <mutex>
+#include <vector>
+
+namespace async_simple::coro {
+
+class MutexTest : public testing::Test {};
+
+TEST_F(MutexTest, TestTryLock) {
+  Mutex mutex;
+  ASSERT_TRUE(mutex.TryLock());
+  ASSERT_FALSE(mutex.TryLock());
+  mutex.Unlock();
+  ASSERT_TRUE(mutex.TryLock());
+  mutex.Unlock();
+
+  // 没有Executor时等待者在Unlock中直接恢复
+  int step = 0;
+  auto task = [&]() -> Lazy<> {
+    auto lock = co_await mutex.CoScopedLock();
+    step = 2;
+  };
+  ASSERT_TRUE(mutex.TryLock());
+  step = 1;
+  task().Start([](Try<void> &&) {});
+  EXPECT_EQ(1, step);
+  mutex.Unlock();
+  EXPECT_EQ(2, step);
+  EXPECT_TRUE(mutex.TryLock());
+  mutex.Unlock();
+}
+
+TEST_F(MutexTest, TestContention) {
+  constexpr int kTaskNum = 64;
+  constexpr int kLoop = 500;
+  executors::SimpleExecutor executor(4);
+  Mutex mutex;
+  int counter = 0;
+  bool inside = false;
+  auto worker = [&]() -> Lazy<> {
+    for (int i = 0; i < kLoop; ++i) {
+      auto lock = co_await mutex.CoScopedLock();
+      EXPECT_FALSE(inside);
+      inside = true;
+      if (i % 50 == 0) {
+        // 持有锁时挂起，其他协程只能等待
+        co_await Yield{};
+      }
+      ++counter;
+      inside = false;
+    }
+  };
+  auto test = [&]() -> Lazy<> {
+    std::vector<Lazy<>> input;
+    for (int i = 0; i < kTaskNum; ++i) {
+      input.push_back(worker());
+    }
+    co_await CollectAllPara(std::move(input));
+  };
+  SyncAwait(test().Via(&executor));
+  EXPECT_EQ(kTaskNum * kLoop, counter);
+  EXPECT_TRUE(mutex.TryLock());
+  mutex.Unlock();
+}
+
+TEST_F(MutexTest, TestBench) {
+  constexpr int kTaskNum = 64;
+  constexpr int kLoop = 1000;
+  executors::SimpleExecutor executor(4);
+  auto run = [&](auto &&worker) {
+    auto test = [&]() -> Lazy<> {
+      std::vector<Lazy<>> input;
+      for (int i = 0; i < kTaskNum; ++i) {
+        input.push_back(worker());
+      }
+      co_await CollectAllPara(std::move(input));
+    };
+    SyncAwait(test().Via(&executor));
+  };
+
+  std::vector<int> data(64);
+  std::mutex std_mutex;
+  {
+    ScopedBench bench("std::mutex", kTaskNum * kLoop);
+    run([&]() -> Lazy<> {
+      for (int i = 0; i < kLoop; ++i) {
+        std::lock_guard lg(std_mutex);
+        for (auto &v : data) {
+          ++v;
+        }
+      }
+      co_return;
+    });
+  }
+  Mutex mutex;
+  {
+    ScopedBench bench("coro::Mutex", kTaskNum * kLoop);
+    run([&]() -> Lazy<> {
+      for (int i = 0; i < kLoop; ++i) {
+        auto lock = co_await mutex.CoScopedLock();
+        for (auto &v : data) {
+          ++v;
+        }
+      }
+    });
+  }
+  EXPECT_EQ(2 * kTaskNum * kLoop, data[0]);
+
+  // 临界区中有挂起点时std::mutex会阻塞整个工作线程，这里只测coro::Mutex
+  {
+    ScopedBench bench("coro::Mutex (yield inside)", kTaskNum * kLoop / 10);
+    run([&]() -> Lazy<> {
+      for (int i = 0; i < kLoop / 10; ++i) {
+        auto lock = co_await mutex.CoScopedLock();
+        co_await Yield{};
+      }
+    });
+  }
+}
+
+} // namespace async_simple::coro
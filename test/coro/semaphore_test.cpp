@@ -0,0 +1,71 @@
+#include <async_simple/coro/semaphore.hpp>
+
+#include "async_simple_test.hpp"
+
+#include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/coro/sleep.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace async_simple::coro {
+
+class SemaphoreTest : public testing::Test {};
+
+TEST_F(SemaphoreTest, TestTryAcquire) {
+  CountingSemaphore<2> semaphore(2);
+  ASSERT_TRUE(semaphore.TryAcquire());
+  ASSERT_TRUE(semaphore.TryAcquire());
+  ASSERT_FALSE(semaphore.TryAcquire());
+  semaphore.Release(2);
+  ASSERT_TRUE(semaphore.TryAcquire());
+  semaphore.Release();
+
+  // 许可直接交给等待者
+  BinarySemaphore binary(0);
+  bool acquired = false;
+  auto task = [&]() -> Lazy<> {
+    co_await binary.CoAcquire();
+    acquired = true;
+  };
+  task().Start([](Try<void> &&) {});
+  EXPECT_FALSE(acquired);
+  binary.Release();
+  EXPECT_TRUE(acquired);
+  EXPECT_FALSE(binary.TryAcquire());
+}
+
+TEST_F(SemaphoreTest, TestLimitConcurrency) {
+  constexpr int kTaskNum = 100;
+  constexpr int kLimit = 4;
+  executors::SimpleExecutor executor(4);
+  CountingSemaphore<> semaphore(kLimit);
+  std::atomic<int> inflight{0};
+  std::atomic<int> max_inflight{0};
+  auto task = [&]() -> Lazy<> {
+    co_await semaphore.CoAcquire();
+    auto now = ++inflight;
+    auto prev = max_inflight.load();
+    while (prev < now && !max_inflight.compare_exchange_weak(prev, now)) {}
+    co_await sleep(std::chrono::microseconds(200));
+    --inflight;
+    semaphore.Release();
+  };
+  auto test = [&]() -> Lazy<> {
+    std::vector<Lazy<>> input;
+    for (int i = 0; i < kTaskNum; ++i) {
+      input.push_back(task());
+    }
+    co_await CollectAllPara(std::move(input));
+  };
+  SyncAwait(test().Via(&executor));
+  EXPECT_EQ(kLimit, max_inflight.load());
+  for (int i = 0; i < kLimit; ++i) {
+    EXPECT_TRUE(semaphore.TryAcquire());
+  }
+  EXPECT_FALSE(semaphore.TryAcquire());
+}
+
+} // namespace async_simple::coro
@@ -0,0 +1,77 @@
+#include <async_simple/coro/shared_mutex.hpp>
+
+#include "async_simple_test.hpp"
+
+#include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/coro/sleep.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace async_simple::coro {
+
+class SharedMutexTest : public testing::Test {};
+
+TEST_F(SharedMutexTest, TestTryLock) {
+  SharedMutex mutex;
+  ASSERT_TRUE(mutex.TryLockShared());
+  ASSERT_TRUE(mutex.TryLockShared());
+  ASSERT_FALSE(mutex.TryLock());
+  mutex.UnlockShared();
+  mutex.UnlockShared();
+  ASSERT_TRUE(mutex.TryLock());
+  ASSERT_FALSE(mutex.TryLockShared());
+  mutex.Unlock();
+}
+
+TEST_F(SharedMutexTest, TestReadersAndWriters) {
+  constexpr int kReaders = 32;
+  constexpr int kWriters = 8;
+  constexpr int kLoop = 20;
+  executors::SimpleExecutor executor(4);
+  SharedMutex mutex;
+  std::atomic<int> readers{0};
+  std::atomic<int> max_readers{0};
+  std::atomic<int> writers{0};
+  int value = 0;
+  auto reader = [&]() -> Lazy<> {
+    for (int i = 0; i < kLoop; ++i) {
+      auto lock = co_await mutex.CoScopedLockShared();
+      EXPECT_EQ(0, writers.load());
+      auto now = ++readers;
+      auto prev = max_readers.load();
+      while (prev < now && !max_readers.compare_exchange_weak(prev, now)) {}
+      co_await sleep(std::chrono::microseconds(100));
+      --readers;
+    }
+  };
+  auto writer = [&]() -> Lazy<> {
+    for (int i = 0; i < kLoop; ++i) {
+      co_await mutex.CoLock();
+      EXPECT_EQ(0, readers.load());
+      EXPECT_EQ(1, ++writers);
+      ++value;
+      co_await Yield{};
+      --writers;
+      mutex.Unlock();
+    }
+  };
+  auto test = [&]() -> Lazy<> {
+    std::vector<Lazy<>> input;
+    for (int i = 0; i < kReaders; ++i) {
+      input.push_back(reader());
+      if (i % (kReaders / kWriters) == 0) {
+        input.push_back(writer());
+      }
+    }
+    co_await CollectAllPara(std::move(input));
+  };
+  SyncAwait(test().Via(&executor));
+  EXPECT_EQ(kWriters * kLoop, value);
+  // 读者之间可以并发
+  EXPECT_GT(max_readers.load(), 1);
+}
+
+} // namespace async_simple::coro
@@ -4,7 +4,11 @@
 
 #include <async_simple/executor/simple_executor.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <semaphore>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -49,4 +53,34 @@ TEST_F(SleepTest, TestSleep) {
   SyncAwait(sleep_task2().Via(&e1));
 }
 
+TEST_F(SleepTest, TestConcurrentSleep) {
+  // 所有的sleep共用SimpleExecutor中的一个定时器线程，按到期时间依次唤醒
+  // 大规模并发sleep的性能见bench/sleep_bench.cpp
+  constexpr int kSleepNum = 1000;
+  executors::SimpleExecutor e1(1);
+  std::vector<int> order;
+  std::atomic<int> count{0};
+  std::binary_semaphore sem(0);
+  // 参数复制到协程帧中，lambda本身要活到所有协程结束
+  auto task = [&order](int i, std::chrono::microseconds duration) -> Lazy<> {
+    auto start_time = std::chrono::steady_clock::now();
+    co_await coro::sleep(duration);
+    EXPECT_GE(std::chrono::steady_clock::now() - start_time, duration);
+    // 只有一个工作线程，不需要加锁
+    order.push_back(i);
+  };
+  for (int i = 0; i < kSleepNum; ++i) {
+    // 后提交的sleep时间更长，到期时间严格递增
+    task(i, 5ms + std::chrono::microseconds(i * 20)).Via(&e1).Start([&](Try<void> &&) {
+      if (++count == kSleepNum) {
+        sem.release();
+      }
+    });
+  }
+  sem.acquire();
+  EXPECT_EQ(count.load(), kSleepNum);
+  ASSERT_EQ(static_cast<std::size_t>(kSleepNum), order.size());
+  EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+}
+
 } // namespace async_simple::coro
@@ -0,0 +1,161 @@
+#include <async_simple/coro/timeout.hpp>
+
+#include "async_simple_test.hpp"
+#include "scoped_bench.hpp"
+
+#include <async_simple/coro/collect.hpp>
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/coro/sleep.hpp>
+#include <async_simple/executor/simple_executor.hpp>
+#include <async_simple/util/frame_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace async_simple::coro {
+
+namespace {
+
+/// 不提供TimerService的Executor，WithTimeout退回到sleep
+class NoTimerExecutor : public executors::SimpleExecutor {
+ public:
+  using SimpleExecutor::SimpleExecutor;
+  util::TimerService *GetTimerService() override { return nullptr; }
+};
+
+Lazy<int> Slow(std::chrono::microseconds duration, int value) {
+  co_await sleep(duration);
+  co_return value;
+}
+
+Lazy<int> Add(int a, int b) { co_return a + b; }
+
+bool IsTimeout(Try<int> &result) {
+  if (!result.HasException()) {
+    return false;
+  }
+  try {
+    std::rethrow_exception(result.GetException());
+  } catch (const TimeoutError &) {
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
+} // namespace
+
+class TimeoutTest : public testing::Test {};
+
+TEST_F(TimeoutTest, TestWithTimeout) {
+  executors::SimpleExecutor executor(2);
+  NoTimerExecutor no_timer(2);
+  for (Executor *ex : std::initializer_list<Executor *>{&executor, &no_timer}) {
+    auto task = [&]() -> Lazy<> {
+      auto in_time = co_await WithTimeout(Slow(1ms, 1), 1s);
+      EXPECT_EQ(1, in_time.Value());
+
+      // 超时后子任务被取消，不需要等到10s
+      auto start = std::chrono::steady_clock::now();
+      auto timeout = co_await WithTimeout(Slow(10s, 2), 20ms);
+      EXPECT_TRUE(IsTimeout(timeout));
+      EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+
+      auto deadline = co_await WithDeadline(Slow(10s, 3), std::chrono::steady_clock::now() + 10ms);
+      EXPECT_TRUE(IsTimeout(deadline));
+
+      // 已经过期的期限
+      auto expired = co_await WithTimeout(Slow(10s, 4), -1ms);
+      EXPECT_TRUE(IsTimeout(expired));
+
+      // 子任务本身的异常原样返回
+      auto error = co_await WithTimeout([]() -> Lazy<int> {
+        throw std::runtime_error("error");
+        co_return 0;
+      }(), 1s);
+      EXPECT_THROW(error.Value(), std::runtime_error);
+
+      auto void_result = co_await WithTimeout(sleep(1ms), 1s);
+      EXPECT_FALSE(void_result.HasException());
+    };
+    SyncAwait(task().Via(ex));
+  }
+
+  // 没有Executor时不设置超时
+  EXPECT_EQ(3, SyncAwait([]() -> Lazy<int> {
+    auto r = co_await WithTimeout(Add(1, 2), 0ms);
+    co_return r.Value();
+  }()));
+}
+
+TEST_F(TimeoutTest, TestParentCancel) {
+  executors::SimpleExecutor executor(2);
+  std::stop_source source;
+  auto task = [&]() -> Lazy<int> {
+    auto r = co_await WithTimeout(Slow(10s, 1), 10s);
+    co_return r.Value();
+  };
+  std::binary_semaphore sem(0);
+  Try<int> result;
+  task().SetStopToken(source.get_token()).Via(&executor).Start([&](Try<int> &&t) {
+    result = std::move(t);
+    sem.release();
+  });
+  std::this_thread::sleep_for(10ms);
+  source.request_stop();
+  sem.acquire();
+  EXPECT_THROW(result.Value(), OperationCancelled);
+}
+
+TEST_F(TimeoutTest, TestNoExtraFrame) {
+  constexpr int kLoop = 1000;
+  executors::SimpleExecutor executor(1);
+  auto plain = [&]() -> Lazy<int> {
+    co_return co_await Add(1, 2);
+  };
+  auto with_timeout = [&]() -> Lazy<int> {
+    co_return (co_await WithTimeout(Add(1, 2), 1s)).Value();
+  };
+  auto frames = [&](auto &&task) {
+    auto before = util::FramePool::GetStats().allocs;
+    for (int i = 0; i < kLoop; ++i) {
+      SyncAwait(task().Via(&executor));
+    }
+    return util::FramePool::GetStats().allocs - before;
+  };
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+  EXPECT_EQ(frames(plain), frames(with_timeout));
+#endif
+}
+
+TEST_F(TimeoutTest, TestBench) {
+  constexpr int kLoop = 10000;
+  executors::SimpleExecutor executor(2);
+  auto with_timeout = [&]() -> Lazy<> {
+    co_await WithTimeout(Add(1, 2), 1s);
+  };
+  // 改用WithTimeout之前的写法：和一个sleep做CollectAny
+  auto collect_any = [&]() -> Lazy<> {
+    std::vector<Lazy<int>> input;
+    input.push_back(Add(1, 2));
+    input.push_back(Slow(1s, 0));
+    co_await CollectAny(std::move(input));
+  };
+  {
+    ScopedBench bench("WithTimeout (in time)", kLoop);
+    for (int i = 0; i < kLoop; ++i) {
+      SyncAwait(with_timeout().Via(&executor));
+    }
+  }
+  {
+    ScopedBench bench("CollectAny with sleep (in time)", kLoop);
+    for (int i = 0; i < kLoop; ++i) {
+      SyncAwait(collect_any().Via(&executor));
+    }
+  }
+}
+
+} // namespace async_simple::coro
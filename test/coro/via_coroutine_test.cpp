@@ -23,7 +23,7 @@ class TrackedSimpleExecutor : public executors::SimpleExecutor {
       return false;
     }
     check--;
-    return SimpleExecutor::Checkin(func, ctx, opts);
+    return SimpleExecutor::Checkin(std::move(func), ctx, opts);
   }
 };
 
@@ -0,0 +1,269 @@
+#include <async_simple/executor/io_uring_io_executor.hpp>
+
+#include "async_simple_test.hpp"
+#include "scoped_bench.hpp"
+
+#include <async_simple/executor/simple_executor.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <semaphore>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAS_IO_URING
+
+namespace async_simple::executors {
+
+class IoUringIOExecutorTest : public testing::Test {
+ public:
+  void SetUp() override {
+    char path[] = "/tmp/io_uring_io_executor_test_XXXXXX";
+    fd_ = mkstemp(path);
+    ASSERT_GE(fd_, 0);
+    unlink(path);
+  }
+  void TearDown() override { close(fd_); }
+
+  /// 同步地提交一个IO，返回io_event_t::res
+  static int64_t SyncIO(IOExecutor *io, int fd, iocb_cmd cmd, void *buffer, size_t len, off_t offset) {
+    std::binary_semaphore sem(0);
+    int64_t res = 0;
+    io->SubmitIO(fd, cmd, buffer, len, offset, [&](io_event_t &event) {
+      res = static_cast<int64_t>(event.res);
+      sem.release();
+    });
+    sem.acquire();
+    return res;
+  }
+  static int64_t SyncIOV(IOExecutor *io, int fd, iocb_cmd cmd, const iovec_t *iov, size_t count, off_t offset) {
+    std::binary_semaphore sem(0);
+    int64_t res = 0;
+    io->SubmitIOV(fd, cmd, iov, count, offset, [&](io_event_t &event) {
+      res = static_cast<int64_t>(event.res);
+      sem.release();
+    });
+    sem.acquire();
+    return res;
+  }
+
+  int fd_{-1};
+};
+
+TEST_F(IoUringIOExecutorTest, TestReadWrite) {
+  IoUringIOExecutor io;
+  ASSERT_TRUE(io.Init());
+
+  std::string data = "hello io_uring";
+  ASSERT_EQ(data.size(), SyncIO(&io, fd_, IOCB_CMD_PWRITE, data.data(), data.size(), 100));
+  ASSERT_EQ(0, SyncIO(&io, fd_, IOCB_CMD_FSYNC, nullptr, 0, 0));
+  ASSERT_EQ(0, SyncIO(&io, fd_, IOCB_CMD_FDSYNC, nullptr, 0, 0));
+
+  std::string buffer(data.size(), '\0');
+  ASSERT_EQ(data.size(), SyncIO(&io, fd_, IOCB_CMD_PREAD, buffer.data(), buffer.size(), 100));
+  ASSERT_EQ(data, buffer);
+
+  char part1[6] = {};
+  char part2[8] = {};
+  iovec_t iov[] = {{part1, 5}, {part2, 7}};
+  ASSERT_EQ(12, SyncIOV(&io, fd_, IOCB_CMD_PREADV, iov, 2, 102));
+  ASSERT_STREQ("llo i", part1);
+  ASSERT_STREQ("o_uring", part2);
+
+  iovec_t wiov[] = {{data.data(), 5}, {data.data(), 5}};
+  ASSERT_EQ(10, SyncIOV(&io, fd_, IOCB_CMD_PWRITEV, wiov, 2, 0));
+  ASSERT_EQ(10, SyncIO(&io, fd_, IOCB_CMD_PREAD, buffer.data(), 10, 0));
+  ASSERT_EQ("hellohello", buffer.substr(0, 10));
+
+  ASSERT_EQ(-EINVAL, SyncIOV(&io, fd_, IOCB_CMD_FSYNC, iov, 2, 0));
+  ASSERT_EQ(-EBADF, SyncIO(&io, -1, IOCB_CMD_PREAD, buffer.data(), buffer.size(), 0));
+}
+
+TEST_F(IoUringIOExecutorTest, TestRegistered) {
+  constexpr size_t kSize = 4096;
+  auto buffer = static_cast<char *>(std::aligned_alloc(4096, kSize * 2));
+  IoUringIOExecutor::Options options;
+  options.files = {fd_};
+  options.buffers = {{buffer, kSize * 2}};
+  IoUringIOExecutor io;
+  ASSERT_TRUE(io.Init(options));
+
+  memset(buffer, 'a', kSize);
+  ASSERT_EQ(kSize, SyncIO(&io, fd_, IOCB_CMD_PWRITE, buffer, kSize, 0));
+  ASSERT_EQ(kSize, SyncIO(&io, fd_, IOCB_CMD_PREAD, buffer + kSize, kSize, 0));
+  ASSERT_EQ(0, memcmp(buffer, buffer + kSize, kSize));
+  io.Destroy();
+  std::free(buffer);
+}
+
+TEST_F(IoUringIOExecutorTest, TestSqpoll) {
+  IoUringIOExecutor::Options options;
+  options.sqpoll = true;
+  options.sqpoll_idle_ms = 1;
+  IoUringIOExecutor io;
+  if (!io.Init(options)) {
+    GTEST_SKIP() << "SQPOLL is not permitted";
+  }
+  std::string data = "sqpoll";
+  for (int i = 0; i < 10; ++i) {
+    // 每次都间隔一段时间，让内核线程休眠，验证唤醒逻辑
+    usleep(3000);
+    ASSERT_EQ(data.size(), SyncIO(&io, fd_, IOCB_CMD_PWRITE, data.data(), data.size(), i));
+  }
+}
+
+TEST_F(IoUringIOExecutorTest, TestConcurrentSubmit) {
+  constexpr int kThreadNum = 4;
+  constexpr int kLoop = 2000;
+  IoUringIOExecutor::Options options;
+  options.entries = 8;  // 让SQ经常被填满
+  IoUringIOExecutor io;
+  ASSERT_TRUE(io.Init(options));
+  std::vector<char> data(kThreadNum * kLoop, 'x');
+  ASSERT_EQ(data.size(), pwrite(fd_, data.data(), data.size(), 0));
+
+  std::atomic<int> done{0};
+  std::counting_semaphore<> sem(0);
+  std::vector<std::thread> threads;
+  std::vector<char> buffer(data.size());
+  for (int t = 0; t < kThreadNum; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kLoop; ++i) {
+        auto offset = t * kLoop + i;
+        io.SubmitIO(fd_, IOCB_CMD_PREAD, &buffer[offset], 1, offset, [&](io_event_t &event) {
+          EXPECT_EQ(1, event.res);
+          if (done.fetch_add(1) + 1 == kThreadNum * kLoop) {
+            sem.release();
+          }
+        });
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  sem.acquire();
+  ASSERT_EQ(data, buffer);
+}
+
+TEST_F(IoUringIOExecutorTest, TestSimpleExecutorBackend) {
+  SimpleExecutor executor(2, false, IOBackend::kIoUring);
+  auto io = executor.GetIOExecutor();
+  ASSERT_NE(nullptr, dynamic_cast<IoUringIOExecutor *>(io));
+  std::string data = "simple executor";
+  ASSERT_EQ(data.size(), SyncIO(io, fd_, IOCB_CMD_PWRITE, data.data(), data.size(), 0));
+}
+
+namespace {
+
+/// 保持depth个4K随机读在途，每个读完成后在回调中提交下一个
+class RandomReader {
+ public:
+  static constexpr size_t kBlock = 4096;
+
+  RandomReader(IOExecutor *io, int fd, char *buffer, const std::vector<off_t> &offsets)
+      : io_(io), fd_(fd), buffer_(buffer), offsets_(offsets) {}
+
+  void Run(int depth) {
+    for (int slot = 0; slot < depth; ++slot) {
+      Submit(slot);
+    }
+    done_.acquire();
+  }
+
+ private:
+  void Submit(int slot) {
+    auto i = next_.fetch_add(1, std::memory_order_relaxed);
+    if (i >= offsets_.size()) return;
+    io_->SubmitIO(fd_, IOCB_CMD_PREAD, buffer_ + slot * kBlock, kBlock, offsets_[i],
+                  [this, slot](io_event_t &event) {
+                    EXPECT_EQ(kBlock, event.res);
+                    if (completed_.fetch_add(1, std::memory_order_relaxed) + 1 == offsets_.size()) {
+                      done_.release();
+                    } else {
+                      Submit(slot);
+                    }
+                  });
+  }
+
+  IOExecutor *io_;
+  int fd_;
+  char *buffer_;
+  const std::vector<off_t> &offsets_;
+  std::atomic<size_t> next_{0};
+  std::atomic<size_t> completed_{0};
+  std::binary_semaphore done_{0};
+};
+
+} // namespace
+
+TEST_F(IoUringIOExecutorTest, TestRandomReadBench) {
+  constexpr size_t kFileSize = 64 << 20;
+  constexpr int kReadNum = 200000;
+  constexpr int kDepth = 64;
+  constexpr auto kBlock = RandomReader::kBlock;
+
+  std::vector<char> data(1 << 20, 'r');
+  for (size_t offset = 0; offset < kFileSize; offset += data.size()) {
+    ASSERT_EQ(data.size(), pwrite(fd_, data.data(), data.size(), offset));
+  }
+  std::mt19937_64 rng(42);
+  std::vector<off_t> offsets(kReadNum);
+  for (auto &offset : offsets) {
+    offset = static_cast<off_t>(rng() % (kFileSize / kBlock) * kBlock);
+  }
+  auto buffer = static_cast<char *>(std::aligned_alloc(4096, kBlock * kDepth));
+
+  {
+    ScopedBench bench("pread (sync)", kReadNum);
+    for (auto offset : offsets) {
+      ASSERT_EQ(kBlock, pread(fd_, buffer, kBlock, offset));
+    }
+  }
+#ifdef HAS_AIO
+  {
+    SimpleIOExecutor io;
+    ASSERT_TRUE(io.Init());
+    RandomReader reader(&io, fd_, buffer, offsets);
+    ScopedBench bench("libaio", kReadNum);
+    reader.Run(kDepth);
+  }
+#endif
+  {
+    IoUringIOExecutor io;
+    ASSERT_TRUE(io.Init());
+    RandomReader reader(&io, fd_, buffer, offsets);
+    ScopedBench bench("io_uring", kReadNum);
+    reader.Run(kDepth);
+  }
+  {
+    IoUringIOExecutor::Options options;
+    options.files = {fd_};
+    options.buffers = {{buffer, kBlock * kDepth}};
+    IoUringIOExecutor io;
+    ASSERT_TRUE(io.Init(options));
+    RandomReader reader(&io, fd_, buffer, offsets);
+    ScopedBench bench("io_uring (registered)", kReadNum);
+    reader.Run(kDepth);
+  }
+  {
+    IoUringIOExecutor::Options options;
+    options.sqpoll = true;
+    IoUringIOExecutor io;
+    if (io.Init(options)) {
+      RandomReader reader(&io, fd_, buffer, offsets);
+      ScopedBench bench("io_uring (sqpoll)", kReadNum);
+      reader.Run(kDepth);
+    }
+  }
+  std::free(buffer);
+}
+
+} // namespace async_simple::executors
+
+#endif
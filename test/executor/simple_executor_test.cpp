@@ -0,0 +1,156 @@
+#include <async_simple/executor/simple_executor.hpp>
+
+#include "async_simple_test.hpp"
+#include "alloc_counter.hpp"
+#include "scoped_bench.hpp"
+
+#include <async_simple/coro/lazy.hpp>
+#include <async_simple/sync/future.hpp>
+
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <semaphore>
+
+namespace async_simple::executors {
+
+class SimpleExecutorTest : public testing::Test {
+ public:
+  static void Report(const char *name, std::size_t allocs, int loop) {
+    std::cout << std::right << std::setw(40) << name << ": "
+              << static_cast<double>(allocs) / loop << " allocs/op" << std::endl;
+  }
+};
+
+TEST_F(SimpleExecutorTest, TestScheduleAllocation) {
+  constexpr int kLoop = 100000;
+  for (bool work_steal : {false, true}) {
+    SimpleExecutor executor(1, work_steal);
+
+    // 每次Yield都会通过Schedule提交一个恢复coroutine_handle的任务
+    auto yield_loop = []() -> coro::Lazy<> {
+      for (int i = 0; i < kLoop; ++i) {
+        co_await coro::Yield{};
+      }
+    };
+    auto before = AllocCount();
+    coro::SyncAwait(yield_loop().Via(&executor));
+    Report(work_steal ? "resume coroutine (work steal)" : "resume coroutine",
+           AllocCount() - before, kLoop);
+
+    // 捕获了40字节的任务
+    std::counting_semaphore<> sem(0);
+    std::array<int64_t, 4> payload{};
+    before = AllocCount();
+    for (int i = 0; i < kLoop; ++i) {
+      executor.Schedule([payload, &sem]() {
+        (void) payload;
+        sem.release();
+      });
+      sem.acquire();
+    }
+    Report(work_steal ? "40 bytes capture (work steal)" : "40 bytes capture",
+           AllocCount() - before, kLoop);
+
+    // Future的continuation，FutureState本身的分配也计算在内
+    before = AllocCount();
+    for (int i = 0; i < kLoop; ++i) {
+      Promise<int> p;
+      auto f = p.GetFuture().Via(&executor).ThenValue([&sem](int v) {
+        sem.release();
+        return v;
+      });
+      p.SetValue(i);
+      sem.acquire();
+    }
+    Report(work_steal ? "future continuation (work steal)" : "future continuation",
+           AllocCount() - before, kLoop);
+  }
+}
+
+TEST_F(SimpleExecutorTest, TestStat) {
+  constexpr int kTaskNum = 10000;
+  SimpleExecutor executor(4, true);
+  std::counting_semaphore<> sem(0);
+  for (int i = 0; i < kTaskNum; ++i) {
+    executor.Schedule([&sem]() { sem.release(); });
+  }
+  for (int i = 0; i < kTaskNum; ++i) {
+    sem.acquire();
+  }
+  // 等所有线程都空闲下来
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  auto stat = executor.Stat();
+  ASSERT_EQ(4u, stat.workers.size());
+  EXPECT_EQ(0u, stat.pending_task_count);
+  uint64_t executed = 0;
+  uint64_t samples = 0;
+  uint64_t parks = 0;
+  for (auto &worker : stat.workers) {
+    EXPECT_EQ(0u, worker.pending_task_count);
+    EXPECT_TRUE(worker.parked);
+    EXPECT_LE(worker.queue_wait_time.count() / std::max<uint64_t>(worker.queue_wait_samples, 1),
+              worker.max_queue_wait_time.count());
+    executed += worker.executed_task_count;
+    samples += worker.queue_wait_samples;
+    parks += worker.park_count;
+  }
+  EXPECT_EQ(static_cast<uint64_t>(kTaskNum), executed);
+  EXPECT_GE(samples, kTaskNum / util::ThreadPool::kQueueWaitSampleInterval);
+  EXPECT_GT(parks, 0u);
+
+  // 快照只读取计数器，可以频繁调用
+  constexpr int kLoop = 10000;
+  ScopedBench bench("Stat() snapshot", kLoop);
+  for (int i = 0; i < kLoop; ++i) {
+    stat = executor.Stat();
+  }
+}
+
+#ifndef ASYNC_SIMPLE_DISABLE_LATENCY_HISTOGRAM
+TEST_F(SimpleExecutorTest, TestLatencyStat) {
+  constexpr int kTaskNum = 1000;
+  SimpleExecutor executor(2);
+  std::counting_semaphore<> sem(0);
+  for (int i = 0; i < kTaskNum; ++i) {
+    executor.Schedule([&sem]() {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      sem.release();
+    });
+  }
+  for (int i = 0; i < kTaskNum; ++i) {
+    Promise<int> p;
+    auto f = p.GetFuture().Via(&executor).ThenValue([&sem](int v) {
+      sem.release();
+      return v;
+    });
+    p.SetValue(i);
+  }
+  for (int i = 0; i < 2 * kTaskNum; ++i) {
+    sem.acquire();
+  }
+  // 最后一个任务执行完之后才会记录它的执行时间
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  auto stat = executor.LatencyStat();
+  auto check = [](const LatencyPercentiles &p) {
+    EXPECT_GT(p.count, 0u);
+    EXPECT_LE(p.p50, p.p99);
+    EXPECT_LE(p.p99, p.p999);
+    EXPECT_LE(p.p999, p.max);
+  };
+  check(stat.queue_wait);
+  check(stat.run_time);
+  check(stat.continuation_delay);
+  EXPECT_GE(stat.queue_wait.count, 2u * kTaskNum / util::LatencySampler::kInterval);
+  // 只有sleep的任务会超过100us
+  EXPECT_GE(stat.run_time.max, std::chrono::microseconds(100));
+  std::cout << "queue wait p50/p99/p999: " << stat.queue_wait.p50.count() << "/"
+            << stat.queue_wait.p99.count() << "/" << stat.queue_wait.p999.count() << " ns" << std::endl;
+  std::cout << "run time   p50/p99/p999: " << stat.run_time.p50.count() << "/"
+            << stat.run_time.p99.count() << "/" << stat.run_time.p999.count() << " ns" << std::endl;
+}
+#endif
+
+} // namespace async_simple::executors
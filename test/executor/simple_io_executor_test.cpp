@@ -0,0 +1,180 @@
+#include <async_simple/executor/simple_io_executor.hpp>
+
+#include "async_simple_test.hpp"
+#include "scoped_bench.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <random>
+#include <semaphore>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAS_AIO
+
+namespace async_simple::executors {
+
+class SimpleIOExecutorTest : public testing::Test {
+ public:
+  void SetUp() override {
+    char path[] = "/tmp/simple_io_executor_test_XXXXXX";
+    fd_ = mkstemp(path);
+    ASSERT_GE(fd_, 0);
+    unlink(path);
+  }
+  void TearDown() override { close(fd_); }
+
+  static int64_t SyncIO(IOExecutor *io, int fd, iocb_cmd cmd, void *buffer, size_t len, off_t offset) {
+    std::binary_semaphore sem(0);
+    int64_t res = 0;
+    io->SubmitIO(fd, cmd, buffer, len, offset, [&](io_event_t &event) {
+      res = static_cast<int64_t>(event.res);
+      sem.release();
+    });
+    sem.acquire();
+    return res;
+  }
+
+  int fd_{-1};
+};
+
+TEST_F(SimpleIOExecutorTest, TestReadWrite) {
+  SimpleIOExecutor io;
+  ASSERT_TRUE(io.Init());
+
+  std::string data = "hello libaio";
+  ASSERT_EQ(data.size(), SyncIO(&io, fd_, IOCB_CMD_PWRITE, data.data(), data.size(), 100));
+  std::string buffer(data.size(), '\0');
+  ASSERT_EQ(data.size(), SyncIO(&io, fd_, IOCB_CMD_PREAD, buffer.data(), buffer.size(), 100));
+  ASSERT_EQ(data, buffer);
+
+  char part1[6] = {};
+  char part2[7] = {};
+  iovec_t iov[] = {{part1, 5}, {part2, 6}};
+  std::binary_semaphore sem(0);
+  io.SubmitIOV(fd_, IOCB_CMD_PREADV, iov, 2, 100, [&](io_event_t &event) {
+    EXPECT_EQ(11u, event.res);
+    sem.release();
+  });
+  sem.acquire();
+  ASSERT_STREQ("hello", part1);
+  ASSERT_STREQ(" libai", part2);
+}
+
+TEST_F(SimpleIOExecutorTest, TestDepth) {
+  SimpleIOExecutor::Options options;
+  options.depth = 4;
+  options.batch_size = 64;  // 超过depth时会被限制为depth
+  SimpleIOExecutor io;
+  ASSERT_TRUE(io.Init(options));
+
+  char buffer[8];
+  std::atomic<int> ok{0};
+  std::atomic<int> again{0};
+  std::counting_semaphore<> sem(0);
+  for (int i = 0; i < 8; ++i) {
+    io.SubmitIO(fd_, IOCB_CMD_PREAD, buffer + i, 1, 0, [&](io_event_t &event) {
+      if (static_cast<int64_t>(event.res) == -EAGAIN) {
+        ++again;
+      } else {
+        ++ok;
+      }
+      sem.release();
+    });
+  }
+  for (int i = 0; i < 8; ++i) {
+    sem.acquire();
+  }
+  EXPECT_EQ(8, ok + again);
+  EXPECT_GE(ok.load(), 4);
+
+  // slab归还之后可以继续提交
+  ASSERT_EQ(0, SyncIO(&io, fd_, IOCB_CMD_PREAD, buffer, 1, 0));
+}
+
+TEST_F(SimpleIOExecutorTest, TestTickEndFlush) {
+  std::string data(64, 'x');
+  ASSERT_EQ(data.size(), pwrite(fd_, data.data(), data.size(), 0));
+  SimpleIOExecutor io;
+  ASSERT_TRUE(io.Init());
+  util::ThreadPool pool(1);
+
+  // 在工作线程中提交的IO会在任务结束时一起提交
+  std::string buffer(data.size(), '\0');
+  std::atomic<int> done{0};
+  std::binary_semaphore sem(0);
+  pool.ScheduleById([&]() {
+    for (size_t i = 0; i < buffer.size(); ++i) {
+      io.SubmitIO(fd_, IOCB_CMD_PREAD, &buffer[i], 1, i, [&](io_event_t &event) {
+        EXPECT_EQ(1u, event.res);
+        if (++done == static_cast<int>(buffer.size())) {
+          sem.release();
+        }
+      });
+    }
+  });
+  sem.acquire();
+  ASSERT_EQ(data, buffer);
+
+  // 提交之后在同一个任务中阻塞等待，由完成线程兜底提交
+  pool.ScheduleById([&]() {
+    EXPECT_EQ(1, SyncIO(&io, fd_, IOCB_CMD_PREAD, &buffer[0], 1, 0));
+    sem.release();
+  });
+  sem.acquire();
+}
+
+TEST_F(SimpleIOExecutorTest, TestBatchBench) {
+  constexpr size_t kFileSize = 64 << 20;
+  constexpr size_t kBlock = 4096;
+  constexpr int kRound = 200;
+
+  std::vector<char> data(1 << 20, 'r');
+  for (size_t offset = 0; offset < kFileSize; offset += data.size()) {
+    ASSERT_EQ(data.size(), pwrite(fd_, data.data(), data.size(), offset));
+  }
+  std::mt19937_64 rng(42);
+
+  for (unsigned depth : {128u, 1024u}) {
+    auto buffer = static_cast<char *>(std::aligned_alloc(4096, kBlock * depth));
+    std::vector<off_t> offsets(depth);
+    for (unsigned batch_size : {1u, 32u, depth}) {
+      SimpleIOExecutor::Options options;
+      options.depth = depth;
+      options.batch_size = batch_size;
+      SimpleIOExecutor io;
+      ASSERT_TRUE(io.Init(options));
+      util::ThreadPool pool(1);
+      std::binary_semaphore sem(0);
+      std::atomic<unsigned> done{0};
+      auto name = "depth " + std::to_string(depth) + " batch " + std::to_string(batch_size);
+      ScopedBench bench(name, kRound * depth);
+      for (int round = 0; round < kRound; ++round) {
+        for (auto &offset : offsets) {
+          offset = static_cast<off_t>(rng() % (kFileSize / kBlock) * kBlock);
+        }
+        done = 0;
+        // 一个任务中突发提交depth个4K随机读
+        pool.ScheduleById([&]() {
+          for (unsigned i = 0; i < depth; ++i) {
+            io.SubmitIO(fd_, IOCB_CMD_PREAD, buffer + i * kBlock, kBlock, offsets[i], [&](io_event_t &event) {
+              EXPECT_EQ(kBlock, event.res);
+              if (++done == depth) {
+                sem.release();
+              }
+            });
+          }
+        });
+        sem.acquire();
+      }
+    }
+    std::free(buffer);
+  }
+}
+
+} // namespace async_simple::executors
+
+#endif
@@ -1,10 +1,14 @@
 #include <async_simple/sync/future.hpp>
 
 #include "async_simple_test.hpp"
+#include "alloc_counter.hpp"
 
 #include <async_simple/executor/simple_executor.hpp>
 #include <async_simple/sync/future_helper.hpp>
 
+#include <deque>
+#include <memory>
+
 using namespace async_simple::executors;
 using namespace std::chrono_literals;
 
@@ -400,6 +404,212 @@ TEST_F(FutureTest, TestCollectReadyFutures) {
   EXPECT_TRUE(executed);
 }
 
+TEST_F(FutureTest, TestCollectAllVariadic) {
+  SimpleExecutor executor(4);
+  Promise<int> p1;
+  Promise<std::string> p2;
+  auto f = CollectAll(p1.GetFuture().Via(&executor),
+                      p2.GetFuture().Via(&executor),
+                      MakeReadyFuture(1.5));
+  std::thread t([&p1, &p2]() {
+    p2.SetValue(std::string("hello"));
+    p1.SetException(std::make_exception_ptr(std::runtime_error("error")));
+  });
+  auto [a, b, c] = std::move(f).Get();
+  t.join();
+  EXPECT_TRUE(a.HasException());
+  EXPECT_EQ("hello", b.Value());
+  EXPECT_EQ(1.5, c.Value());
+}
+
+TEST_F(FutureTest, TestCollectAny) {
+  std::vector<Promise<Dummy>> promises(3);
+  std::vector<Future<Dummy>> futures;
+  for (auto &p : promises) {
+    futures.push_back(p.GetFuture());
+  }
+  auto f = CollectAny(futures.begin(), futures.end());
+  int state = 0;
+  promises[1].SetValue(Dummy(&state));
+  ASSERT_TRUE(f.HasResult());
+  EXPECT_EQ(1u, f.Value().first);
+  EXPECT_EQ(CONSTRUCTED, state);
+  // 结果确定之后完成的Future不会影响结果，它们的值随FutureState一起析构
+  int late = 0;
+  promises[0].SetValue(Dummy(&late));
+  promises[2].SetException(std::make_exception_ptr(std::runtime_error("error")));
+  EXPECT_EQ(1u, f.Value().first);
+  futures.clear();
+  promises.clear();
+  EXPECT_EQ(CONSTRUCTED | DESTRUCTED, late);
+
+  // 已经有结果的Future直接成为结果
+  std::vector<Future<int>> ready;
+  Promise<int> pending;
+  ready.push_back(pending.GetFuture());
+  ready.push_back(MakeReadyFuture(7));
+  auto r = CollectAny(ready.begin(), ready.end()).Get();
+  EXPECT_EQ(1u, r.first);
+  EXPECT_EQ(7, r.second.Value());
+
+  std::vector<Future<int>> empty;
+  EXPECT_THROW(CollectAny(empty.begin(), empty.end()), std::logic_error);
+}
+
+TEST_F(FutureTest, TestCollectN) {
+  constexpr std::size_t kNum = 5;
+  std::vector<Promise<int>> promises(kNum);
+  std::vector<Future<int>> futures;
+  for (auto &p : promises) {
+    futures.push_back(p.GetFuture());
+  }
+  auto f = CollectN(futures.begin(), futures.end(), 2);
+  promises[3].SetValue(3);
+  EXPECT_FALSE(f.HasResult());
+  promises[0].SetValue(0);
+  ASSERT_TRUE(f.HasResult());
+  auto &results = f.Value();
+  ASSERT_EQ(2u, results.size());
+  EXPECT_EQ(3u, results[0].first);
+  EXPECT_EQ(3, results[0].second.Value());
+  EXPECT_EQ(0u, results[1].first);
+  EXPECT_EQ(0, results[1].second.Value());
+  for (auto i : {1, 2, 4}) {
+    promises[i].SetValue(static_cast<int>(i));
+  }
+
+  EXPECT_TRUE(CollectN(futures.begin(), futures.end(), 0).Value().empty());
+  EXPECT_THROW(CollectN(futures.begin(), futures.end(), kNum + 1), std::logic_error);
+
+  // 多个线程同时完成时只保留最先完成的n个
+  SimpleExecutor executor(4);
+  for (int round = 0; round < 100; ++round) {
+    std::vector<Promise<int>> ps(kNum);
+    std::vector<Future<int>> fs;
+    for (auto &p : ps) {
+      fs.push_back(p.GetFuture());
+    }
+    auto collected = CollectN(fs.begin(), fs.end(), 3);
+    for (std::size_t i = 0; i < kNum; ++i) {
+      executor.Schedule([p = std::move(ps[i]), i]() mutable { p.SetValue(static_cast<int>(i)); });
+    }
+    auto out = std::move(collected).Get();
+    ASSERT_EQ(3u, out.size());
+    for (auto &[index, value] : out) {
+      EXPECT_EQ(static_cast<int>(index), value.Value());
+    }
+  }
+}
+
+TEST_F(FutureTest, TestCollectAllWindowed) {
+  constexpr std::size_t kNum = 20;
+  constexpr std::size_t kWindow = 3;
+  // 在调用方线程上按启动顺序逐个完成，检查同时等待的Future不超过窗口大小
+  std::deque<std::pair<std::size_t, Promise<int>>> in_flight;
+  std::size_t max_in_flight = 0;
+  auto f = CollectAllWindowed(kWindow, kNum, [&](std::size_t i) {
+    if (i % 4 == 0) {
+      return MakeReadyFuture(static_cast<int>(i));
+    }
+    in_flight.emplace_back(i, Promise<int>());
+    max_in_flight = std::max(max_in_flight, in_flight.size());
+    return in_flight.back().second.GetFuture();
+  });
+  while (!in_flight.empty()) {
+    auto [i, p] = std::move(in_flight.front());
+    in_flight.pop_front();
+    p.SetValue(static_cast<int>(i));
+  }
+  ASSERT_TRUE(f.HasResult());
+  EXPECT_LE(max_in_flight, kWindow);
+  auto &results = f.Value();
+  ASSERT_EQ(kNum, results.size());
+  for (std::size_t i = 0; i < kNum; ++i) {
+    EXPECT_EQ(static_cast<int>(i), results[i].Value());
+  }
+
+  // 全部立即完成时不会递归
+  auto ready = CollectAllWindowed(2, 100000, [](std::size_t i) {
+    return MakeReadyFuture(static_cast<int>(i));
+  });
+  EXPECT_EQ(99999, ready.Value().back().Value());
+  EXPECT_TRUE(CollectAllWindowed(2, 0, [](std::size_t i) {
+    return MakeReadyFuture(static_cast<int>(i));
+  }).Value().empty());
+
+  // 在线程池中完成
+  SimpleExecutor executor(4);
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  auto para = CollectAllWindowed(kWindow, kNum, [&](std::size_t i) {
+    Promise<int> p;
+    auto future = p.GetFuture();
+    auto now = running.fetch_add(1) + 1;
+    int expected = max_running.load();
+    while (now > expected && !max_running.compare_exchange_weak(expected, now)) {}
+    executor.Schedule([&running, p = std::move(p), i]() mutable {
+      running.fetch_sub(1);
+      p.SetValue(static_cast<int>(i));
+    });
+    return future;
+  });
+  auto out = std::move(para).Get();
+  EXPECT_LE(max_running.load(), static_cast<int>(kWindow));
+  for (std::size_t i = 0; i < kNum; ++i) {
+    EXPECT_EQ(static_cast<int>(i), out[i].Value());
+  }
+}
+
+TEST_F(FutureTest, TestCollectAllWindowedThrow) {
+  constexpr std::size_t kNum = 10;
+  constexpr std::size_t kWindow = 3;
+  // 第一个窗口内(1)和由其他输入的continuation启动时(5, 9)抛出异常
+  auto throws = [](std::size_t i) { return i == 1 || i == 5 || i == 9; };
+  std::deque<std::pair<std::size_t, Promise<int>>> in_flight;
+  auto f = CollectAllWindowed(kWindow, kNum, [&](std::size_t i) {
+    if (throws(i)) {
+      throw std::runtime_error("factory");
+    }
+    in_flight.emplace_back(i, Promise<int>());
+    return in_flight.back().second.GetFuture();
+  });
+  while (!in_flight.empty()) {
+    auto [i, p] = std::move(in_flight.front());
+    in_flight.pop_front();
+    p.SetValue(static_cast<int>(i));
+  }
+  ASSERT_TRUE(f.HasResult());
+  auto &results = f.Value();
+  ASSERT_EQ(kNum, results.size());
+  for (std::size_t i = 0; i < kNum; ++i) {
+    if (throws(i)) {
+      EXPECT_THROW(results[i].Value(), std::runtime_error);
+    } else {
+      EXPECT_EQ(static_cast<int>(i), results[i].Value());
+    }
+  }
+
+  // 在线程池的任务中启动的输入抛出异常
+  SimpleExecutor executor(2);
+  auto para = CollectAllWindowed(kWindow, kNum, [&](std::size_t i) {
+    if (throws(i)) {
+      throw std::runtime_error("factory");
+    }
+    Promise<int> p;
+    auto future = p.GetFuture();
+    executor.Schedule([p = std::move(p), i]() mutable { p.SetValue(static_cast<int>(i)); });
+    return future;
+  });
+  auto out = std::move(para).Get();
+  for (std::size_t i = 0; i < kNum; ++i) {
+    if (throws(i)) {
+      EXPECT_THROW(out[i].Value(), std::runtime_error);
+    } else {
+      EXPECT_EQ(static_cast<int>(i), out[i].Value());
+    }
+  }
+}
+
 TEST_F(FutureTest, TestPromiseBroken) {
   Promise<Dummy> p;
   auto f = p.GetFuture();
@@ -432,6 +642,29 @@ TEST_F(FutureTest, TestViaAfterWait) {
   t.join();
 }
 
+TEST_F(FutureTest, TestWaitWithoutAllocation) {
+  Promise<int> promise;
+  auto future = promise.GetFuture();
+  std::atomic<bool> started{false};
+  auto t = std::thread([&started, p = std::move(promise)]() mutable {
+    while (!started.load()) {
+      std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(10ms);
+    p.SetValue(100);
+  });
+
+  // Wait直接阻塞在FutureState上，不再创建新的Promise和FutureState
+  auto before = AllocCount();
+  auto frames = util::FramePool::GetStats().allocs;
+  started = true;
+  future.Wait();
+  EXPECT_EQ(0u, AllocCount() - before);
+  EXPECT_EQ(0u, util::FramePool::GetStats().allocs - frames);
+  EXPECT_EQ(100, future.Value());
+  t.join();
+}
+
 TEST_F(FutureTest, TestReadyFuture) {
   auto future = MakeReadyFuture(3);
   future.Wait();
@@ -455,5 +688,183 @@ TEST_F(FutureTest, TestPromiseCopy) {
   EXPECT_EQ(0, promise3.GetFuture().Value());
 }
 
+TEST_F(FutureTest, TestPromiseMoveAssign) {
+  Promise<int> p;
+  auto future = p.GetFuture();
+  // 被覆盖的Promise需要释放原来的状态，否则future永远等不到结果
+  p = Promise<int>();
+  ASSERT_THROW(future.Value(), std::runtime_error);
+  p.SetValue(1);
+  EXPECT_EQ(1, p.GetFuture().Value());
+}
+
+TEST_F(FutureTest, TestThenChainAllocation) {
+  static constexpr std::size_t kDepth = 100;
+  // 连续的ThenValue合并成一条链，阶段放在链自带的内存中，不再每一级分配一个FutureState
+  auto chain = []() {
+    Promise<int> p;
+    auto future = p.GetFuture();
+    auto before = AllocCount();
+    auto frames = util::FramePool::GetStats().allocs;
+    for (std::size_t i = 0; i < kDepth; ++i) {
+      future = std::move(future).ThenValue([](int x) { return x + 1; });
+    }
+    auto allocs = AllocCount() - before;
+    EXPECT_GE(kDepth / 16, util::FramePool::GetStats().allocs - frames);
+    p.SetValue(0);
+    EXPECT_EQ(static_cast<int>(kDepth), future.Value());
+    return allocs;
+  };
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+  EXPECT_GE(kDepth / 16, chain());
+  // 链和它的内存块回到线程缓存中，第二次不再调用operator new
+  EXPECT_EQ(0u, chain());
+#else
+  EXPECT_GE(kDepth / 16, chain());
+#endif
 }
 
+TEST_F(FutureTest, TestThenChainFusion) {
+  SimpleExecutor executor1(2);
+  SimpleExecutor executor2(2);
+
+  // 同一个executor上的阶段依次执行，只有Via换了executor的地方才重新调度
+  Promise<int> p;
+  auto f = p.GetFuture()
+      .Via(&executor1)
+      .ThenValue([&executor1](int x) {
+        EXPECT_TRUE(executor1.CurrentThreadInExecutor());
+        return x + 1;
+      })
+      .ThenTry([&executor1](Try<int> &&t) {
+        EXPECT_TRUE(executor1.CurrentThreadInExecutor());
+        return std::to_string(t.Value());
+      })
+      .Via(&executor1)
+      .ThenValue([&executor1](std::string &&s) {
+        EXPECT_TRUE(executor1.CurrentThreadInExecutor());
+        return s + "!";
+      })
+      .Via(&executor2)
+      .ThenValue([&executor2](std::string &&s) {
+        EXPECT_TRUE(executor2.CurrentThreadInExecutor());
+        return s.size();
+      });
+  EXPECT_EQ(&executor2, f.GetExecutor());
+  p.SetValue(99);
+  EXPECT_EQ(4u, std::move(f).Get());
+
+  // 链已经执行完之后追加的阶段在当前线程上立即执行
+  Promise<int> ready;
+  auto g = ready.GetFuture().ThenValue([](int x) { return x * 2; });
+  ready.SetValue(21);
+  EXPECT_TRUE(g.HasResult());
+  EXPECT_EQ(42, g.Value());
+  auto tid = std::this_thread::get_id();
+  g = std::move(g).ThenValue([tid](int x) {
+    EXPECT_EQ(tid, std::this_thread::get_id());
+    return x + 1;
+  });
+  EXPECT_TRUE(g.HasResult());
+  EXPECT_EQ(43, std::move(g).Get());
+
+  // 异常跳过后面的ThenValue，直到ThenTry
+  Promise<int> failed;
+  bool called = false;
+  auto h = failed.GetFuture()
+      .ThenValue([&called](int x) {
+        called = true;
+        return x;
+      })
+      .ThenTry([](Try<int> &&t) { return t.HasException() ? -1 : t.Value(); });
+  failed.SetException(std::make_exception_ptr(std::runtime_error("failed")));
+  EXPECT_FALSE(called);
+  EXPECT_EQ(-1, std::move(h).Get());
+
+  // 丢弃链上的Future之后，已经追加的阶段仍然会执行
+  int side_effect = 0;
+  Promise<int> dropped;
+  dropped.GetFuture()
+      .ThenValue([&side_effect](int x) { side_effect = x; return x; })
+      .ThenValue([&side_effect](int x) { side_effect += x; });
+  dropped.SetValue(5);
+  EXPECT_EQ(10, side_effect);
+
+  // Promise被丢弃时链上的Future得到异常
+  auto broken = Promise<int>().GetFuture().ThenValue([](int x) { return x; });
+  EXPECT_THROW(std::move(broken).Get(), std::runtime_error);
+}
+
+TEST_F(FutureTest, TestThenChainReleaseCaptures) {
+  // 阶段执行之后立即析构捕获的对象，不需要等链上的Future被丢弃
+  auto resource = std::make_shared<int>(1);
+  std::weak_ptr<int> weak = resource;
+  Promise<int> p;
+  auto f = p.GetFuture()
+      .ThenValue([resource = std::move(resource)](int x) { return x + *resource; })
+      .ThenValue([](int x) { return x * 2; });
+  EXPECT_FALSE(weak.expired());
+  p.SetValue(1);
+  ASSERT_TRUE(f.HasResult());
+  EXPECT_TRUE(weak.expired());
+  EXPECT_EQ(4, f.Value());
+
+  // 因为异常被跳过的阶段也一样
+  resource = std::make_shared<int>(1);
+  weak = resource;
+  Promise<int> failed;
+  auto g = failed.GetFuture()
+      .ThenValue([resource = std::move(resource)](int x) { return x + *resource; })
+      .ThenTry([](Try<int> &&t) { return t.HasException(); });
+  failed.SetException(std::make_exception_ptr(std::runtime_error("failed")));
+  ASSERT_TRUE(g.HasResult());
+  EXPECT_TRUE(weak.expired());
+  EXPECT_TRUE(g.Value());
+}
+
+TEST_F(FutureTest, TestThenChainRace) {
+  // 另一个线程设置结果的同时继续追加阶段，每一级恰好执行一次
+  static constexpr int kDepth = 64;
+  for (int round = 0; round < 200; ++round) {
+    Promise<int> p;
+    auto future = p.GetFuture();
+    std::thread t([&p]() { p.SetValue(0); });
+    for (int i = 0; i < kDepth; ++i) {
+      future = std::move(future).ThenValue([](int x) { return x + 1; });
+    }
+    EXPECT_EQ(kDepth, std::move(future).Get());
+    t.join();
+  }
+}
+
+TEST_F(FutureTest, TestCollectAllAllocation) {
+  static constexpr std::size_t kNum = 10;
+  auto collect = []() {
+    std::vector<Promise<int>> promises(kNum);
+    std::vector<Future<int>> futures;
+    for (auto &p : promises) {
+      futures.push_back(p.GetFuture());
+    }
+    auto before = AllocCount();
+    auto f = CollectAll(futures.begin(), futures.end());
+    auto allocs = AllocCount() - before;
+    for (std::size_t i = 0; i < kNum; ++i) {
+      promises[i].SetValue(static_cast<int>(i));
+    }
+    auto results = std::move(f).Get();
+    EXPECT_EQ(kNum, results.size());
+    for (std::size_t i = 0; i < kNum; ++i) {
+      EXPECT_EQ(static_cast<int>(i), results[i].Value());
+    }
+    return allocs;
+  };
+  collect();
+#ifndef ASYNC_SIMPLE_DISABLE_FRAME_POOL
+  // FutureState和汇总状态都来自内存池，只剩下结果vector
+  EXPECT_EQ(1u, collect());
+#else
+  EXPECT_EQ(3u, collect());
+#endif
+}
+
+}
@@ -0,0 +1,80 @@
+#include <async_simple/util/event_count.hpp>
+
+#include "async_simple_test.hpp"
+#include "scoped_bench.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace async_simple::util {
+
+class EventCountTest : public testing::Test {};
+
+TEST_F(EventCountTest, TestWaitNotify) {
+  EventCount event;
+  // 没有等待者时Notify什么也不做
+  event.Notify();
+  EXPECT_FALSE(event.HasWaiters());
+
+  // 条件已经满足时取消等待
+  auto key = event.PrepareWait();
+  EXPECT_TRUE(event.HasWaiters());
+  event.CancelWait();
+  EXPECT_FALSE(event.HasWaiters());
+
+  // PrepareWait之后的Notify不会丢失，即使发生在Wait之前
+  key = event.PrepareWait();
+  event.Notify();
+  event.Wait(key);
+  EXPECT_FALSE(event.HasWaiters());
+}
+
+TEST_F(EventCountTest, TestProducerConsumer) {
+  constexpr int kThreadNum = 4;
+  constexpr int kLoop = 10000;
+  EventCount event;
+  std::atomic<int> available{0};
+  std::atomic<int> consumed{0};
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < kThreadNum; ++i) {
+    consumers.emplace_back([&]() {
+      while (consumed.load() < kLoop) {
+        auto n = available.load();
+        if (n > 0) {
+          if (available.compare_exchange_weak(n, n - 1)) {
+            consumed.fetch_add(1);
+          }
+          continue;
+        }
+        auto key = event.PrepareWait();
+        if (available.load() > 0 || consumed.load() >= kLoop) {
+          event.CancelWait();
+          continue;
+        }
+        event.Wait(key);
+      }
+      event.NotifyAll();
+    });
+  }
+  for (int i = 0; i < kLoop; ++i) {
+    available.fetch_add(1);
+    event.Notify();
+  }
+  for (auto &consumer : consumers) {
+    consumer.join();
+  }
+  EXPECT_EQ(kLoop, consumed.load());
+  EXPECT_EQ(0, available.load());
+}
+
+TEST_F(EventCountTest, TestNotifyBench) {
+  constexpr int kLoop = 1000000;
+  EventCount event;
+  ScopedBench bench("EventCount::Notify no waiter", kLoop);
+  for (int i = 0; i < kLoop; ++i) {
+    event.Notify();
+  }
+}
+
+} // namespace async_simple::util
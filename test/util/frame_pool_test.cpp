@@ -0,0 +1,96 @@
+#include <async_simple/util/frame_pool.hpp>
+
+#include "async_simple_test.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace async_simple::util {
+
+class FramePoolTest : public testing::Test {};
+
+TEST_F(FramePoolTest, TestReuse) {
+  auto before = FramePool::GetStats();
+  void *p1 = FramePool::Allocate(100);
+  ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(p1) % __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+  FramePool::Deallocate(p1);
+  // 同一个size class的内存会被复用
+  void *p2 = FramePool::Allocate(90);
+  ASSERT_EQ(p1, p2);
+  FramePool::Deallocate(p2);
+
+  void *big = FramePool::Allocate(FramePool::kClassSize * FramePool::kNumClasses);
+  FramePool::Deallocate(big);
+
+  auto after = FramePool::GetStats();
+  EXPECT_EQ(3u, after.allocs - before.allocs);
+  EXPECT_EQ(3u, after.frees - before.frees);
+  EXPECT_LE(1u, after.cache_hits - before.cache_hits);
+  EXPECT_EQ(1u, after.oversize - before.oversize);
+}
+
+TEST_F(FramePoolTest, TestRemoteFree) {
+  constexpr int kNum = 100;
+  std::vector<void *> frames;
+  for (int i = 0; i < kNum; ++i) {
+    frames.push_back(FramePool::Allocate(200));
+  }
+  auto before = FramePool::GetStats();
+  std::thread([&]() {
+    for (auto frame : frames) {
+      FramePool::Deallocate(frame);
+    }
+  }).join();
+  auto after = FramePool::GetStats();
+  EXPECT_EQ(static_cast<uint64_t>(kNum), after.remote_frees - before.remote_frees);
+
+  // 其他线程释放的内存回到分配线程的缓存中
+  std::vector<void *> again;
+  for (int i = 0; i < kNum; ++i) {
+    again.push_back(FramePool::Allocate(200));
+  }
+  std::sort(frames.begin(), frames.end());
+  std::sort(again.begin(), again.end());
+  EXPECT_EQ(frames, again);
+  for (auto frame : again) {
+    FramePool::Deallocate(frame);
+  }
+}
+
+TEST_F(FramePoolTest, TestThreadExit) {
+  // 分配线程退出之后再释放
+  std::vector<void *> frames;
+  std::thread([&]() {
+    for (int i = 0; i < 10; ++i) {
+      frames.push_back(FramePool::Allocate(64 * i));
+    }
+    FramePool::Deallocate(frames.back());
+    frames.pop_back();
+  }).join();
+  for (auto frame : frames) {
+    FramePool::Deallocate(frame);
+  }
+
+  // 分配线程退出时释放和退出并发进行
+  for (int round = 0; round < 100; ++round) {
+    std::vector<void *> shared(16);
+    std::atomic<bool> ready{false};
+    std::thread owner([&]() {
+      for (auto &frame : shared) {
+        frame = FramePool::Allocate(128);
+      }
+      ready = true;
+    });
+    while (!ready) {
+      std::this_thread::yield();
+    }
+    for (auto frame : shared) {
+      FramePool::Deallocate(frame);
+    }
+    owner.join();
+  }
+}
+
+} // namespace async_simple::util
@@ -0,0 +1,124 @@
+#include <async_simple/util/latency_histogram.hpp>
+
+#include "async_simple_test.hpp"
+#include "scoped_bench.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace async_simple::util {
+
+class LatencyHistogramTest : public testing::Test {};
+
+TEST_F(LatencyHistogramTest, TestBuckets) {
+  EXPECT_EQ(0u, LatencyHistogram::BucketIndex(0));
+  EXPECT_EQ(LatencyHistogram::kBucketCount - 1, LatencyHistogram::BucketIndex(LatencyHistogram::kMaxValue));
+  EXPECT_EQ(LatencyHistogram::kBucketCount - 1, LatencyHistogram::BucketIndex(~uint64_t{0}));
+
+  // 桶是连续的，每个值都落在所属桶的上下界之间，相对误差不超过1/16
+  std::size_t prev = 0;
+  for (uint64_t v = 1; v < (uint64_t{1} << 36); v += v / 7 + 1) {
+    auto index = LatencyHistogram::BucketIndex(v);
+    EXPECT_LE(prev, index);
+    prev = index;
+    auto lower = LatencyHistogram::BucketLowerBound(index);
+    auto upper = LatencyHistogram::BucketUpperBound(index);
+    ASSERT_LE(lower, v);
+    ASSERT_GE(upper, v);
+    ASSERT_LE(upper - lower, lower / 16);
+  }
+  for (std::size_t i = 0; i + 1 < LatencyHistogram::kBucketCount; ++i) {
+    ASSERT_EQ(LatencyHistogram::BucketUpperBound(i) + 1, LatencyHistogram::BucketLowerBound(i + 1));
+    ASSERT_EQ(i, LatencyHistogram::BucketIndex(LatencyHistogram::BucketLowerBound(i)));
+  }
+}
+
+TEST_F(LatencyHistogramTest, TestPercentile) {
+  LatencyHistogram::Snapshot empty;
+  EXPECT_EQ(0u, empty.Percentile(0.99));
+
+  auto histogram = std::make_unique<LatencyHistogram>();
+  for (uint64_t v = 1; v <= 100000; ++v) {
+    histogram->Record(v * 10);
+  }
+  LatencyHistogram::Snapshot snapshot;
+  histogram->AddTo(snapshot);
+  EXPECT_EQ(100000u, snapshot.Count());
+  EXPECT_EQ(1000000u, snapshot.Max());
+  auto near = [](uint64_t expected, uint64_t actual) {
+    return actual >= expected && actual <= expected + expected / 16;
+  };
+  EXPECT_TRUE(near(500000, snapshot.Percentile(0.5))) << snapshot.Percentile(0.5);
+  EXPECT_TRUE(near(990000, snapshot.Percentile(0.99))) << snapshot.Percentile(0.99);
+  EXPECT_TRUE(near(999000, snapshot.Percentile(0.999))) << snapshot.Percentile(0.999);
+  EXPECT_EQ(1000000u, snapshot.Percentile(1));
+  EXPECT_EQ(10u, snapshot.Percentile(0));
+}
+
+TEST_F(LatencyHistogramTest, TestMerge) {
+  constexpr int kThreadNum = 4;
+  constexpr int kLoop = 10000;
+  std::vector<std::unique_ptr<LatencyHistogram>> histograms;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadNum; ++i) {
+    histograms.push_back(std::make_unique<LatencyHistogram>());
+  }
+  for (int i = 0; i < kThreadNum; ++i) {
+    // 每个线程只写自己的直方图，主线程同时读取
+    threads.emplace_back([&histogram = *histograms[i], i]() {
+      for (int j = 0; j < kLoop; ++j) {
+        histogram.Record((i + 1) * 1000);
+      }
+    });
+  }
+  LatencyHistogram::Snapshot partial;
+  for (auto &histogram : histograms) {
+    histogram->AddTo(partial);
+  }
+  EXPECT_LE(partial.Count(), static_cast<uint64_t>(kThreadNum * kLoop));
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  LatencyHistogram::Snapshot merged;
+  for (auto &histogram : histograms) {
+    LatencyHistogram::Snapshot one;
+    histogram->AddTo(one);
+    merged.Merge(one);
+  }
+  EXPECT_EQ(static_cast<uint64_t>(kThreadNum * kLoop), merged.Count());
+  EXPECT_EQ(4000u, merged.Max());
+  EXPECT_GE(merged.Percentile(0.25), 1000u);
+  EXPECT_LT(merged.Percentile(0.25), 2000u);
+  EXPECT_EQ(4000u, merged.Percentile(0.999));
+}
+
+TEST_F(LatencyHistogramTest, TestRecordBench) {
+  constexpr int kLoop = 1000000;
+  auto histogram = std::make_unique<LatencyHistogram>();
+  {
+    ScopedBench bench("LatencyHistogram::Record", kLoop);
+    for (int i = 0; i < kLoop; ++i) {
+      histogram->Record(i);
+    }
+  }
+  {
+    ScopedBench bench("LatencySampler::Sample", kLoop);
+    int64_t sum = 0;
+    for (int i = 0; i < kLoop; ++i) {
+      sum += LatencySampler::Sample();
+    }
+    EXPECT_GT(sum, 0);
+  }
+  {
+    ScopedBench bench("LatencyHistogram snapshot", 1000);
+    for (int i = 0; i < 1000; ++i) {
+      LatencyHistogram::Snapshot snapshot;
+      histogram->AddTo(snapshot);
+      EXPECT_EQ(static_cast<uint64_t>(kLoop), snapshot.Count());
+    }
+  }
+}
+
+} // namespace async_simple::util
@@ -0,0 +1,188 @@
+#include <async_simple/util/thread_pool.hpp>
+
+#include "async_simple_test.hpp"
+
+#include <atomic>
+#include <functional>
+#include <semaphore>
+#include <set>
+#include <vector>
+
+namespace async_simple::util {
+
+class ThreadPoolTest : public testing::Test {};
+
+TEST_F(ThreadPoolTest, TestScheduleById) {
+  ThreadPool pool(4, true);
+  EXPECT_EQ(pool.ScheduleById(nullptr), ThreadPool::kErrorPoolItemIsNull);
+  EXPECT_EQ(pool.GetCurrentId(), -1);
+
+  std::atomic<int> wrong_thread{0};
+  std::counting_semaphore<> sem(0);
+  for (int i = 0; i < 100; ++i) {
+    for (int id = 0; id < 4; ++id) {
+      pool.ScheduleById([&, id]() {
+        if (pool.GetCurrentId() != id) {
+          wrong_thread++;
+        }
+        sem.release();
+      }, id);
+    }
+  }
+  for (int i = 0; i < 400; ++i) {
+    sem.acquire();
+  }
+  EXPECT_EQ(wrong_thread.load(), 0);
+}
+
+TEST_F(ThreadPoolTest, TestPlacement) {
+  ThreadPool pool(4);
+  // 外部线程提交的任务分散到多个线程上
+  std::mutex mtx;
+  std::set<int32_t> ids;
+  std::counting_semaphore<> sem(0);
+  for (int i = 0; i < 400; ++i) {
+    pool.ScheduleById([&]() {
+      {
+        std::lock_guard lg(mtx);
+        ids.insert(pool.GetCurrentId());
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      sem.release();
+    });
+  }
+  for (int i = 0; i < 400; ++i) {
+    sem.acquire();
+  }
+  EXPECT_GT(ids.size(), 1u);
+
+  // 工作线程自己的队列为空时，提交的任务留在当前线程
+  std::atomic<int32_t> id{-1};
+  pool.ScheduleById([&]() {
+    pool.ScheduleById([&]() {
+      id = pool.GetCurrentId();
+      sem.release();
+    });
+  }, 2);
+  sem.acquire();
+  EXPECT_EQ(2, id.load());
+}
+
+TEST_F(ThreadPoolTest, TestWorkSteal) {
+  constexpr int kTaskNum = 10000;
+  ThreadPool pool(4, true);
+  std::atomic<int> count{0};
+  std::mutex mtx;
+  std::set<int32_t> ids;
+  std::binary_semaphore sem(0);
+  // 所有任务都由一个工作线程提交到它自己的队列中，其他线程只能通过窃取拿到任务
+  pool.ScheduleById([&]() {
+    for (int i = 0; i < kTaskNum; ++i) {
+      pool.ScheduleById([&]() {
+        {
+          std::lock_guard lg(mtx);
+          ids.insert(pool.GetCurrentId());
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+        if (++count == kTaskNum) {
+          sem.release();
+        }
+      });
+    }
+  }, 0);
+  sem.acquire();
+  EXPECT_EQ(count.load(), kTaskNum);
+  EXPECT_GT(ids.size(), 1u);
+
+  // 其他线程执行的任务都是窃取来的
+  uint64_t executed = 0;
+  uint64_t steals = 0;
+  for (auto &stat : pool.GetWorkerStats()) {
+    executed += stat.executed;
+    steals += stat.steals;
+  }
+  EXPECT_EQ(executed, kTaskNum + 1u);
+  EXPECT_GT(steals, 0u);
+}
+
+TEST_F(ThreadPoolTest, TestScheduleNext) {
+  for (bool work_steal : {false, true}) {
+    ThreadPool pool(1, work_steal);
+    // 不在工作线程中时和ScheduleById相同
+    EXPECT_EQ(pool.ScheduleNext(nullptr), ThreadPool::kErrorPoolItemIsNull);
+
+    std::vector<int> order;
+    std::binary_semaphore sem(0);
+    pool.ScheduleById([&]() {
+      pool.ScheduleById([&]() { order.push_back(3); });
+      pool.ScheduleNext([&]() { order.push_back(1); });
+      // 新的任务把LIFO槽中原有的任务挤到队尾
+      pool.ScheduleNext([&]() { order.push_back(2); });
+      pool.ScheduleById([&]() {
+        order.push_back(4);
+        sem.release();
+      });
+    });
+    sem.acquire();
+    EXPECT_EQ(order, (std::vector<int>{2, 3, 1, 4}));
+    EXPECT_EQ(pool.GetWorkerStats()[0].lifo_executed, 1u);
+  }
+}
+
+TEST_F(ThreadPoolTest, TestScheduleNextFairness) {
+  constexpr int kRounds = 1000;
+  ThreadPool pool(1);
+  std::atomic<int> ping_pong{0};
+  std::atomic<int> seen_by_other{-1};
+  std::binary_semaphore sem(0);
+  // 两个任务通过ScheduleNext互相唤醒，队列中的其他任务也要能在有限的轮数内执行
+  std::function<void()> bounce = [&]() {
+    if (++ping_pong < kRounds) {
+      pool.ScheduleNext(bounce);
+    } else {
+      sem.release();
+    }
+  };
+  pool.ScheduleById([&]() {
+    pool.ScheduleNext(bounce);
+    pool.ScheduleById([&]() { seen_by_other = ping_pong.load(); });
+  });
+  sem.acquire();
+  EXPECT_GE(seen_by_other.load(), 0);
+  EXPECT_LE(seen_by_other.load(), static_cast<int>(ThreadPool::kMaxLifoRuns));
+}
+
+TEST_F(ThreadPoolTest, TestDrainOnDestroy) {
+  std::atomic<int> count{0};
+  {
+    ThreadPool pool(2, true);
+    for (int i = 0; i < 1000; ++i) {
+      pool.ScheduleById([&]() { count++; });
+    }
+  }
+  EXPECT_EQ(count.load(), 1000);
+}
+
+TEST_F(ThreadPoolTest, TestDeferToTickEnd) {
+  ThreadPool pool(2);
+  int key = 0;
+  EXPECT_FALSE(ThreadPool::DeferToTickEnd(&key, []() {}));
+
+  std::vector<int> order;
+  std::binary_semaphore sem(0);
+  pool.ScheduleById([&]() {
+    order.push_back(1);
+    // 同一个key只会执行一次
+    EXPECT_TRUE(ThreadPool::DeferToTickEnd(&key, [&]() { order.push_back(3); }));
+    EXPECT_TRUE(ThreadPool::DeferToTickEnd(&key, [&]() { order.push_back(4); }));
+    order.push_back(2);
+  }, 0);
+  pool.ScheduleById([&]() {
+    order.push_back(5);
+    sem.release();
+  }, 0);
+  sem.acquire();
+  EXPECT_EQ(order, (std::vector<int>{1, 2, 3, 5}));
+}
+
+} // namespace async_simple::util
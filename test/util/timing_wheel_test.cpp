@@ -0,0 +1,108 @@
+#include <async_simple/util/timing_wheel.hpp>
+
+#include "async_simple_test.hpp"
+
+#include <async_simple/util/timer_service.hpp>
+
+#include <atomic>
+#include <random>
+#include <semaphore>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace async_simple::util {
+
+class TimingWheelTest : public testing::Test {};
+
+TEST_F(TimingWheelTest, TestInsertRemove) {
+  TimingWheel wheel(100);
+  TimingWheel::Entry e0, e1, e2;
+  e0.deadline = 100;
+  EXPECT_FALSE(wheel.Insert(&e0));
+  EXPECT_TRUE(wheel.Empty());
+
+  e1.deadline = 150;
+  e2.deadline = 100 + 5000;
+  EXPECT_TRUE(wheel.Insert(&e1));
+  EXPECT_TRUE(wheel.Insert(&e2));
+  // 下一个时间点可能是高层的槽下沉的时间
+  EXPECT_LE(*wheel.NextDeadline(), 150u);
+
+  wheel.Remove(&e1);
+  EXPECT_FALSE(e1.Linked());
+  EXPECT_TRUE(e2.Linked());
+  EXPECT_EQ(wheel.Advance(5099), nullptr);
+  EXPECT_EQ(wheel.Advance(5100), &e2);
+  EXPECT_EQ(e2.next, nullptr);
+  EXPECT_TRUE(wheel.Empty());
+  EXPECT_FALSE(wheel.NextDeadline());
+}
+
+TEST_F(TimingWheelTest, TestRandomDeadline) {
+  constexpr int kEntryNum = 20000;
+  std::mt19937_64 rng(42);
+  uint64_t start = rng() % (uint64_t(1) << 40);
+  TimingWheel wheel(start);
+  std::vector<TimingWheel::Entry> entries(kEntryNum);
+  for (int i = 0; i < kEntryNum; ++i) {
+    // 覆盖所有的层，以及超出最大跨度的情况
+    auto bits = rng() % 46 + 1;
+    entries[i].deadline = start + 1 + rng() % (uint64_t(1) << bits);
+    ASSERT_TRUE(wheel.Insert(&entries[i]));
+  }
+  // 随机删除一部分
+  std::vector<bool> removed(kEntryNum, false);
+  for (int i = 0; i < kEntryNum; i += 7) {
+    wheel.Remove(&entries[i]);
+    removed[i] = true;
+  }
+
+  std::vector<int> fired(kEntryNum, 0);
+  uint64_t now = start;
+  while (!wheel.Empty()) {
+    auto next = *wheel.NextDeadline();
+    ASSERT_GT(next, now);
+    auto prev = now;
+    now = next + rng() % 3;
+    for (auto entry = wheel.Advance(now); entry; entry = entry->next) {
+      auto index = entry - entries.data();
+      ASSERT_GT(entry->deadline, prev);
+      ASSERT_LE(entry->deadline, now);
+      fired[index]++;
+    }
+  }
+  for (int i = 0; i < kEntryNum; ++i) {
+    ASSERT_EQ(fired[i], removed[i] ? 0 : 1) << "entry " << i;
+  }
+}
+
+TEST_F(TimingWheelTest, TestTimerService) {
+  TimerService timer;
+  std::atomic<int> count{0};
+  std::counting_semaphore<> sem(0);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 100; ++i) {
+    timer.Schedule([&]() {
+      count++;
+      sem.release();
+    }, std::chrono::microseconds(i * 100));
+  }
+
+  TimingWheel::Entry entry;
+  bool cancelled_fired = false;
+  entry.callback = [&]() { cancelled_fired = true; };
+  timer.Add(&entry, 50ms);
+  EXPECT_TRUE(timer.Cancel(&entry));
+  EXPECT_FALSE(timer.Cancel(&entry));
+
+  for (int i = 0; i < 100; ++i) {
+    sem.acquire();
+  }
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 9900us);
+  EXPECT_EQ(count.load(), 100);
+  std::this_thread::sleep_for(100ms);
+  EXPECT_FALSE(cancelled_fired);
+}
+
+} // namespace async_simple::util